@@ -30,10 +30,13 @@ add_executable(test_runtime
         test/TestFormatException.cpp
         test/TestFormatstring.cpp
         test/TestQuickformat.cpp
+        test/TestScan.cpp
         test/TestToString.cpp
         test/TestVariables.cpp
+        test/stringify/TestBigIntToString.cpp
         test/stringify/TestBoolToString.cpp
         test/stringify/TestCollectionToString.cpp
+        test/stringify/TestDecimalToString.cpp
         test/stringify/TestFloatToString.cpp
         test/stringify/TestFormatHelper.cpp
         test/stringify/TestIntToString.cpp
@@ -49,3 +52,9 @@ add_test(NAME Runtime_Test
 
 add_executable(raw_test test/RawTest.cpp)
 target_link_libraries(raw_test formatstring)
+
+add_executable(float_benchmark test/FloatBenchmark.cpp)
+target_link_libraries(float_benchmark formatstring)
+
+add_executable(float_exhaustive test/FloatExhaustive.cpp)
+target_link_libraries(float_exhaustive formatstring)
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "formatstring/util/PointerUtil.h"
+#include "formatstring/detail/FormatParser.h"
 #include "formatstring/detail/Variable.h"
 
 
@@ -124,16 +125,8 @@ public:
 	}
 	
 private:
-	enum class SegmentType {
-		Substring, Variable
-	};
-	
-	struct Segment {
-		SegmentType type;
-		size_t variable;
-		size_t begin;
-		size_t end;
-	};
+	using SegmentType = detail::SegmentType;
+	using Segment = detail::Segment;
 	
 	void parseFormat();
 	
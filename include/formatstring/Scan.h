@@ -0,0 +1,123 @@
+/** @file formatstring/Scan.h
+ *
+ * The scan() function reads values back from text that was written with a
+ * format string, e.g. the output of fs::format().
+ */
+
+#ifndef FORMATSTRING_SCAN_H
+#define FORMATSTRING_SCAN_H
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+
+namespace fs {
+
+namespace detail {
+
+/** A type erased reference to a variable that scan() assigns to. */
+struct ScanArg {
+	enum class Type {
+		None, Signed, Unsigned, Float, Double, LongDouble, Bool, Char, String
+	};
+	
+	Type type;
+	void* target;
+	size_t size;
+};
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value,
+		ScanArg>::type makeScanArg(T& value)
+{
+	static_assert(sizeof(T) <= 8, "scan() supports integers of up to 64 bits");
+	return {ScanArg::Type::Signed, &value, sizeof(T)};
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value,
+		ScanArg>::type makeScanArg(T& value)
+{
+	static_assert(sizeof(T) <= 8, "scan() supports integers of up to 64 bits");
+	return {ScanArg::Type::Unsigned, &value, sizeof(T)};
+}
+
+inline ScanArg makeScanArg(bool& value) { return {ScanArg::Type::Bool, &value, 1}; }
+inline ScanArg makeScanArg(char& value) { return {ScanArg::Type::Char, &value, 1}; }
+
+inline ScanArg makeScanArg(float& value)
+{
+	return {ScanArg::Type::Float, &value, sizeof(value)};
+}
+
+inline ScanArg makeScanArg(double& value)
+{
+	return {ScanArg::Type::Double, &value, sizeof(value)};
+}
+
+inline ScanArg makeScanArg(long double& value)
+{
+	return {ScanArg::Type::LongDouble, &value, sizeof(value)};
+}
+
+inline ScanArg makeScanArg(std::string& value)
+{
+	return {ScanArg::Type::String, &value, sizeof(value)};
+}
+
+/** Reads the fields of input into the count args. See scan(). */
+size_t scanArgs(const std::string& input, const std::string& format,
+		const ScanArg* args, size_t count);
+
+} // namespace detail
+
+
+/**
+ * Reads values from input, which is expected to look like the output of the
+ * format with the given variables, and assigns them to the variables. Returns
+ * the number of assigned fields. Like sscanf(), it stops at the first field or
+ * literal text that doesn't match the input, so a result less than the number
+ * of fields in format means that the input was malformed.
+ *
+ * The format string syntax is the same as for formatting, with variable IDs
+ * and the format specifiers of the variable's type:
+ *
+ *     int id;
+ *     double x;
+ *     std::string name;
+ *     fs::scan("#002a: 1,234.5 (point)", "#{:04x}: {:,} ({})", id, x, name);
+ *
+ * Fields are read as follows:
+ * - Integers are read in the base of their type, with an optional sign and
+ *   base prefix (e.g. 0x) and the grouping character between digits. Values
+ *   out of range of the variable don't match. The types "si" and "bi" can't be
+ *   read.
+ * - Floating point values are read in any notation, including "Inf" and
+ *   "NaN", and rounded correctly to the variable's type. SI prefixes are read
+ *   with the type "si".
+ * - Bools are read as "true" and "false" or the names from the format.
+ * - A char is a single character.
+ * - Strings are read up to the literal text that follows the field in the
+ *   format, up to the next whitespace if a field follows immediately, or to
+ *   the end of the input.
+ * Fill characters around a field are skipped if the format has an alignment
+ * and a width, as long as the field isn't wider than the width. Numbers and
+ * bools may always be preceded by fill characters.
+ *
+ * Numeric fields are parsed without allocating memory and independent of the
+ * locale.
+ *
+ * @throws FormatException if the format is malformed or refers to more
+ *     variables than given
+ */
+template <typename... Args>
+inline size_t scan(const std::string& input, const std::string& format, Args&... args)
+{
+	const detail::ScanArg scan_args[] = {detail::makeScanArg(args)..., {}};
+	return detail::scanArgs(input, format, scan_args, sizeof...(Args));
+}
+
+} // namespace fs
+
+#endif //FORMATSTRING_SCAN_H
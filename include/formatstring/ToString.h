@@ -13,6 +13,8 @@
 // Include all standard toString implementations:
 #include "formatstring/stringify/BoolToString.h"
 #include "formatstring/stringify/IntToString.h"
+#include "formatstring/stringify/BigIntToString.h"
+#include "formatstring/stringify/DecimalToString.h"
 #include "formatstring/stringify/FloatToString.h"
 #include "formatstring/stringify/StringToString.h"
 #include "formatstring/stringify/CollectionToString.h"
@@ -59,6 +61,16 @@ inline std::string toString(const T& object)
 	return ::fs::toStringHandler(object, {});
 }
 
+/**
+ * Appends the string representation of the object to out. Strings are copied
+ * straight into out instead of being returned first, which saves a copy.
+ */
+template <typename T>
+inline void appendToString(std::string& out, const T& object, const std::string& format)
+{
+	::fs::appendToStringHandler(out, object, format);
+}
+
 } // namespace fs
 
 
@@ -0,0 +1,64 @@
+/** @file formatstring/detail/FormatParser.h
+ *
+ * The FormatParser splits a format string like "a{}b{2:x}" into literal text
+ * and variables. It is shared by Formatstring and scan().
+ */
+
+#ifndef FORMATSTRING_FORMATPARSER_H
+#define FORMATSTRING_FORMATPARSER_H
+
+#include <string>
+
+
+namespace fs {
+namespace detail {
+
+enum class SegmentType {
+	Substring, Variable
+};
+
+/**
+ * A part of the format string. Substrings are literal text with escaped braces
+ * already reduced to one, variables have their index and the range of their
+ * format specifier, which may still contain escaped closing braces.
+ */
+struct Segment {
+	SegmentType type;
+	size_t variable;
+	size_t begin;
+	size_t end;
+};
+
+/**
+ * Reads the segments of a format string one after the other, without storing
+ * them. The format must outlive the parser.
+ */
+class FormatParser
+{
+public:
+	explicit FormatParser(const std::string& format);
+	
+	/**
+	 * Reads the next segment. Returns false at the end of the format.
+	 *
+	 * @throws FormatException if the format is malformed
+	 */
+	bool next(Segment& segment);
+
+private:
+	const std::string& format_;
+	size_t position_;
+	size_t substring_begin_;
+	size_t var_counter_;
+};
+
+/**
+ * Returns the format specifier of a variable segment with escaped closing
+ * braces reduced to one.
+ */
+std::string specifier(const std::string& format, const Segment& segment);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_FORMATPARSER_H
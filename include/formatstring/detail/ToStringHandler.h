@@ -6,6 +6,7 @@
 #ifndef FORMATSTRING_TOSTRINGHANDLER_H
 #define FORMATSTRING_TOSTRINGHANDLER_H
 
+#include <cstring>
 #include <string>
 #include <sstream>
 
@@ -138,6 +139,42 @@ inline std::string toStringHandler(const std::string& object, const std::string&
 	return str_string(object, format);
 }
 
+#if __cplusplus >= 201703l
+inline std::string toStringHandler(std::string_view object, const std::string& format)
+{
+	return str_string_view(object, format);
+}
+#endif
+
+//==============================================================================
+// appendToStringHandler, which appends to an existing string instead
+
+template <typename T> inline
+void appendToStringHandler(std::string& out, const T& object, const std::string& format)
+{
+	out += toStringHandler(object, format);
+}
+
+inline void appendToStringHandler(std::string& out, const std::string& object,
+		const std::string& format)
+{
+	appendString(out, object.data(), object.length(), format);
+}
+
+inline void appendToStringHandler(std::string& out, const char* object,
+		const std::string& format)
+{
+	appendString(out, object, std::strlen(object), format);
+}
+
+#if __cplusplus >= 201703l
+inline void appendToStringHandler(std::string& out, std::string_view object,
+		const std::string& format)
+{
+	appendString(out, object.data(), object.length(), format);
+}
+#endif
+
 } // namespace fs
 
 #endif //FORMATSTRING_TOSTRINGHANDLER_H
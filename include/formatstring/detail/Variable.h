@@ -24,6 +24,12 @@ public:
 	
 	virtual std::string toString(const std::string& format) const = 0;
 	virtual U<Variable> clone() const = 0;
+	
+	/** Appends the formatted value to out, by default using toString(). */
+	virtual void appendTo(std::string& out, const std::string& format) const
+	{
+		out += toString(format);
+	}
 };
 
 
@@ -38,6 +44,11 @@ public:
 		return fs::toString(value_, format);
 	}
 	
+	void appendTo(std::string& out, const std::string& format) const override
+	{
+		fs::appendToString(out, value_, format);
+	}
+	
 	U<Variable> clone() const override
 	{
 		return mkU<VariableCopy>(value_);
@@ -63,6 +74,15 @@ public:
 			return "nullptr";
 	}
 	
+	void appendTo(std::string& out, const std::string& format) const override
+	{
+		S<const T> ptr = reference_.lock();
+		if (ptr)
+			fs::appendToString(out, *ptr, format);
+		else
+			out += "nullptr";
+	}
+	
 	U<Variable> clone() const override
 	{
 		return mkU<VariableReference>(reference_);
@@ -87,6 +107,14 @@ public:
 			return "nullptr";
 	}
 	
+	void appendTo(std::string& out, const std::string& format) const override
+	{
+		if (reference_)
+			fs::appendToString(out, *reference_, format);
+		else
+			out += "nullptr";
+	}
+	
 	U<Variable> clone() const override
 	{
 		return mkU<VariableRawReference>(reference_);
@@ -108,6 +136,11 @@ public:
 		return var_->toString(format_);
 	}
 	
+	void appendTo(std::string& out, const std::string&) const override
+	{
+		var_->appendTo(out, format_);
+	}
+	
 	U<Variable> clone() const override
 	{
 		return mkU<VariableFormat>(var_->clone(), format_);
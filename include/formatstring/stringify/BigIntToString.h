@@ -0,0 +1,66 @@
+/** @file formatstring/stringify/BigIntToString.h
+ *
+ * This header provides the BigIntView type and its str() method, so that
+ * integers of arbitrary size can be used in toString().
+ */
+
+#ifndef FORMATSTRING_BIGINTTOSTRING_H
+#define FORMATSTRING_BIGINTTOSTRING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace fs {
+
+/**
+ * Non-owning view of an integer of arbitrary size. The magnitude is stored as
+ * 64-bit limbs with the least significant limb first, the sign separately.
+ * The limbs must outlive the view.
+ */
+class BigIntView
+{
+public:
+	/** Creates a view of size limbs starting at limbs. */
+	BigIntView(const uint64_t* limbs, size_t size, bool negative = false)
+			: limbs_(limbs), size_(size), negative_(negative)
+	{}
+	
+	/** Creates a view of all limbs in the vector. */
+	explicit BigIntView(const std::vector<uint64_t>& limbs, bool negative = false)
+			: limbs_(limbs.data()), size_(limbs.size()), negative_(negative)
+	{}
+	
+	/** Returns the limbs, least significant first. */
+	const uint64_t* getLimbs() const { return limbs_; }
+	
+	/** Returns the number of limbs. */
+	size_t getSize() const { return size_; }
+	
+	/** Returns whether the value is negative. Zero is printed without sign. */
+	bool isNegative() const { return negative_; }
+
+private:
+	const uint64_t* limbs_;
+	size_t size_;
+	bool negative_;
+};
+
+/**
+ * Formats the integer with the same format syntax as the built-in integers,
+ * see IntToString.h.
+ *
+ *     [format_specifier] := [[fill]align][sign][#][0][width][grouping][type]
+ *     [grouping]         := ("," | "_") [group_size]
+ *     [type]             := "d" | "b" | "o" | "x" | "X"
+ *
+ * Binary, octal and hexadecimal output takes linear time. Decimal output
+ * splits the value recursively by cached powers of ten, which takes
+ * subquadratic time.
+ */
+std::string str(const BigIntView& value, const std::string& format);
+
+} // namespace fs
+
+#endif //FORMATSTRING_BIGINTTOSTRING_H
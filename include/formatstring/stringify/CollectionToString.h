@@ -7,7 +7,9 @@
 #define FORMATSTRING_COLLECTIONTOSTRING_H
 
 #include "formatstring/err/FormatException.h"
+#include "formatstring/stringify/FloatToString.h"
 #include "formatstring/stringify/FormatHelper.h"
+#include "formatstring/stringify/IntToString.h"
 #include "formatstring/util/Metafunctions.h"
 
 
@@ -28,6 +30,111 @@ GENERATE_EXIST_METAFUNCTION(has_const_end, std::declval<const T>().end(), typena
 GENERATE_EXIST_METAFUNCTION(has_begin, std::declval<const T>().begin(), typename T::iterator, T);
 GENERATE_EXIST_METAFUNCTION(has_end, std::declval<const T>().end(), typename T::iterator, T);
 GENERATE_EXIST_METAFUNCTION(has_empty, std::declval<const T>().empty(), bool, T);
+GENERATE_EXIST_METAFUNCTION(has_size, std::declval<const T>().size(), size_t, T);
+
+namespace detail {
+
+/** Integral types that are formatted as numbers by IntToString. */
+template <typename T>
+struct is_formatted_integer: std::integral_constant<bool,
+		std::is_integral<T>::value
+		&& !std::is_same<T, bool>::value
+		&& !std::is_same<T, char>::value
+		&& !std::is_same<T, wchar_t>::value
+		&& !std::is_same<T, char16_t>::value
+		&& !std::is_same<T, char32_t>::value> {};
+
+/**
+ * Once the first value has been written, reserves enough space for the
+ * remaining values assuming they have a similar length.
+ */
+template <typename T>
+inline typename std::enable_if<has_size<T>::value>::type
+reserveForValues(std::string& out, const T& collection, size_t value_length)
+{
+	out.reserve(out.length() + (collection.size() - 1) * value_length);
+}
+
+template <typename T>
+inline typename std::enable_if<!has_size<T>::value>::type
+reserveForValues(std::string&, const T&, size_t)
+{}
+
+/** Appends all values of the collection to out, separated by the divider. */
+template <typename T, typename Writer>
+inline void appendValues(std::string& out, const T& collection,
+		const std::string& divider, Writer write)
+{
+	bool first = true;
+	for (const typename T::value_type& value: collection) {
+		if (first) {
+			size_t begin = out.length();
+			write(out, value);
+			reserveForValues(out, collection, out.length() - begin + divider.length());
+			first = false;
+		} else {
+			out += divider;
+			write(out, value);
+		}
+	}
+}
+
+/**
+ * Appends all values of a collection of integers. The forwarded format is only
+ * parsed once and each value is written directly into the output.
+ */
+template <typename T>
+inline typename std::enable_if<
+		is_formatted_integer<typename T::value_type>::value>::type
+appendCollection(std::string& out, const T& collection,
+		const std::string& divider, const std::string& format)
+{
+	using V = typename T::value_type;
+	// Widen to the 64-bit types, larger ones have their own overloads
+	using WV = typename std::conditional<(sizeof(V) > sizeof(long long)), V,
+			typename std::conditional<std::is_signed<V>::value,
+			long long, unsigned long long>::type>::type;
+	
+	Numformat nf = parseIntformat(format);
+	appendValues(out, collection, divider, [&nf](std::string& o, const V& value) {
+		appendInt(o, static_cast<WV>(value), nf);
+	});
+}
+
+/**
+ * Appends all values of a collection of floating point values. The forwarded
+ * format is only parsed once.
+ */
+template <typename T>
+inline typename std::enable_if<
+		std::is_floating_point<typename T::value_type>::value>::type
+appendCollection(std::string& out, const T& collection,
+		const std::string& divider, const std::string& format)
+{
+	using V = typename T::value_type;
+	
+	Numformat nf = parseFloatformat(format);
+	appendValues(out, collection, divider, [&nf](std::string& o, const V& value) {
+		appendFloat(o, value, nf);
+	});
+}
+
+/** Appends all values of any other collection using toString(). */
+template <typename T>
+inline typename std::enable_if<
+		!is_formatted_integer<typename T::value_type>::value
+		&& !std::is_floating_point<typename T::value_type>::value>::type
+appendCollection(std::string& out, const T& collection,
+		const std::string& divider, const std::string& format)
+{
+	using V = typename T::value_type;
+	
+	appendValues(out, collection, divider, [&format](std::string& o, const V& value) {
+		o += fs::toString(value, format);
+	});
+}
+
+} // namespace detail
 
 /**
  * This template of the str() function can format a linear collection of values.
@@ -166,15 +273,7 @@ str(const T& collection, const std::string& fmt)
 		out = empty;
 	} else {
 		out = prefix;
-		bool first = true;
-		
-		for (const typename T::value_type& value: collection) {
-			if (first)
-				first = false;
-			else
-				out += divider;
-			out += fs::toString(value, forwarded_format);
-		}
+		detail::appendCollection(out, collection, divider, forwarded_format);
 		out += suffix;
 	}
 	
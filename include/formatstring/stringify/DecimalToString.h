@@ -0,0 +1,99 @@
+/** @file formatstring/stringify/DecimalToString.h
+ *
+ * This header provides fixed-point decimal types and their str() methods, so
+ * that scaled integers like amounts of money can be used in toString().
+ */
+
+#ifndef FORMATSTRING_DECIMALTOSTRING_H
+#define FORMATSTRING_DECIMALTOSTRING_H
+
+#include <cstdint>
+#include <string>
+
+#include "formatstring/stringify/FormatHelper.h"
+
+
+namespace fs {
+
+/**
+ * A fixed-point decimal number with a scale known at run time. Its value is
+ * units * 10^-scale, e.g. 12345 units with scale 2 are 123.45. The scale can
+ * be at most 19.
+ */
+class ScaledDecimal
+{
+public:
+	ScaledDecimal(int64_t units, unsigned scale): units_(units), scale_(scale) {}
+	
+	/** Returns the value in units of 10^-scale. */
+	int64_t getUnits() const { return units_; }
+	
+	/** Returns the number of decimal digits of a unit. */
+	unsigned getScale() const { return scale_; }
+
+private:
+	int64_t units_;
+	unsigned scale_;
+};
+
+/**
+ * A fixed-point decimal number with Scale decimal digits, e.g. Decimal<4> for
+ * amounts stored in ten-thousandths.
+ */
+template <unsigned Scale>
+class Decimal
+{
+public:
+	static_assert(Scale <= 19, "The scale of a Decimal can be at most 19");
+	
+	explicit Decimal(int64_t units = 0): units_(units) {}
+	
+	/** Returns the value in units of 10^-Scale. */
+	int64_t getUnits() const { return units_; }
+	
+	operator ScaledDecimal() const { return ScaledDecimal(units_, Scale); }
+
+private:
+	int64_t units_;
+};
+
+/**
+ * Formats a fixed-point decimal exactly, using integer arithmetic only. The
+ * format syntax is the one of the fixed-point float format, see
+ * FloatToString.h:
+ *
+ *     [format_specifier] := [[fill]align][sign][#][0][width][grouping]["." precision]["f"]
+ *     [precision]        := exact_precision | min_precision "-" max_precision
+ *
+ * The precision is the number of decimal digits, all digits of the scale by
+ * default. Values with more digits are rounded to the nearest value, ties to
+ * even (e.g. 0.125 is printed as 0.12 and 0.375 as 0.38 with ".2"). With a
+ * range, trailing zeros are removed down to the minimum precision. Zero
+ * padding is grouped like for integers (e.g. 000,012.50).
+ *
+ * @throws FormatException if the format is invalid or the scale is above 19
+ */
+std::string str(const ScaledDecimal& value, const std::string& format);
+
+template <unsigned Scale>
+inline std::string str(const Decimal<Scale>& value, const std::string& format)
+{
+	return str(static_cast<ScaledDecimal>(value), format);
+}
+
+
+namespace detail {
+
+/**
+ * Parses and validates a decimal format string once, so that it can be
+ * reused for many values with appendDecimal().
+ */
+Numformat parseDecimalformat(const std::string& format);
+
+/** Appends the value formatted according to a parsed decimal format to out. */
+void appendDecimal(std::string& out, const ScaledDecimal& value, const Numformat& nf);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_DECIMALTOSTRING_H
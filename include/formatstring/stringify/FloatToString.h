@@ -7,7 +7,12 @@
 #ifndef FORMATSTRING_FLOATTOSTRING_H
 #define FORMATSTRING_FLOATTOSTRING_H
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
+
+#include "formatstring/stringify/FormatHelper.h"
 
 
 namespace fs {
@@ -18,16 +23,18 @@ namespace fs {
  * Format string syntax
  * --------------------
  *
- *     [format_specifier] := [[fill]align][sign][#][0][width]["." precision][type]
+ *     [format_specifier] := [[fill]align][sign][#][0][width][grouping]["." precision][type]
  *     [fill]             := <any character>
  *     [align]            := "<" | ">" | "^" | "="
  *     [sign]             := "+" | "-" | " "
  *     [width]            := integer
+ *     [grouping]         := ("," | "_") [group_size]
+ *     [group_size]       := integer
  *     [precision]        := exact_precision | min_precision "-" max_precision
  *     [exact_precision]  := integer
  *     [min_precision]    := integer
  *     [max_precision]    := integer
- *     [type]             := "g" | "G" | "e" | "E" | "ee" | "EE" | "si" |  "f"
+ *     [type]             := "g" | "G" | "e" | "E" | "ee" | "EE" | "si" |  "f" | "w" | "W"
  *
  * align/fill
  * ----------
@@ -67,6 +74,13 @@ namespace fs {
  * shorter, it will be padded to the width with the fill char. If the number is
  * longer, nothing happens and the output exceeds the  width.
  *
+ * grouping
+ * --------
+ * If "," or "_" is given, that character is inserted between groups of 3 digits
+ * of the integer part (e.g. 1,234.5) or of the group size from 1 to 99 if one
+ * is specified.
+ * In scientific notation this only affects the integer part of the mantissa.
+ *
  * precision
  * ---------
  * The precision value determines the number or range of significant digits to
@@ -93,21 +107,74 @@ namespace fs {
  * - "si" Similar to "ee" but uses SI prefixes instead of an exponent (e.g. 12k
  *       instead of 12e3).
  * - "f" Fixed notation. Displays the number as a fixed-point number.
+ * - "w" Width fit. Displays the number with as many significant digits as fit
+ *       into the width, which is required, but not more than the shortest
+ *       ones (e.g. 3.142 or 1.23e-7 with width 7). Fixed notation is used
+ *       unless scientific notation shows more digits. If the number doesn't
+ *       fit at all, it exceeds the width with a single significant digit.
+ *       There is no precision for this type.
+ * - "W" Similar to "w" but uses "E" for the exponent.
  *
  * special values
  * --------------
  * Infinity is displayed as "+/-inf" or "+/-Inf" in uppercase mode.
  * NaN is displayed as "nan" or "NaN" respectively.
+ *
+ * long double
+ * -----------
+ * 80-bit x87 long doubles are printed with their full 64-bit significand.
+ * Other long double formats are printed with the precision of a double.
  */
 std::string str(float value, const std::string& format);
 std::string str(double value, const std::string& format);
 std::string str(long double value, const std::string& format);
 
+/**
+ * Receives formatted text piece by piece, in order. The data is only valid
+ * during the call.
+ */
+using Sink = std::function<void(const char* data, size_t length)>;
+
+/**
+ * Formats count doubles with the same float format, separated by separator,
+ * and passes the text to the sink in pieces, e.g. to write a CSV column. The
+ * format is parsed once and the digits are generated block by block. With
+ * threads other than 1, large arrays are split into segments that are
+ * formatted in parallel, 0 uses one thread per core. The output is the same
+ * in any case. An exception thrown by the sink is passed on once all threads
+ * have stopped.
+ *
+ * @throws FormatException if the format is invalid, before the sink is called
+ */
+void formatDoubles(const double* values, size_t count, const std::string& format,
+		const Sink& sink, const std::string& separator = ",", unsigned threads = 1);
+
+/** Formats all values like formatDoubles() above and returns the text. */
+std::string formatDoubles(const std::vector<double>& values, const std::string& format,
+		const std::string& separator = ",", unsigned threads = 1);
+
 
 namespace detail {
 
+/**
+ * Parses and validates a floating point format string once, so that it can be
+ * reused for many values with appendFloat().
+ */
+Numformat parseFloatformat(const std::string& format);
+
+/** Appends the value formatted according to a parsed float format to out. */
+void appendFloat(std::string& out, float value, const Numformat& nf);
+void appendFloat(std::string& out, double value, const Numformat& nf);
+void appendFloat(std::string& out, long double value, const Numformat& nf);
+
+/**
+ * The value digits * 10^exponent, with length significant digits. The buffer
+ * holds the up to 21 digits of an 80-bit long double with room to spare, so
+ * that no digit generation or rounding step allocates.
+ */
 struct decimal {
-	std::string digits;
+	char digits[32];
+	int length;
 	int exponent;
 };
 
@@ -116,8 +183,29 @@ struct fp {
 	int32_t e;
 };
 
+/**
+ * Grisu2 by Florian Loitsch. Fast, but the digits are not always the shortest
+ * ones. Doubles only use it if FORMATSTRING_GRISU2 is defined, floats never.
+ */
 decimal grisu2(fp v);
 
+/**
+ * Ryu by Ulf Adams. Returns the shortest digits that read back as the double
+ * v, the ones closest to v if there are several.
+ */
+decimal ryu(fp v);
+
+/** Ryu for floats, v must come from a float. */
+decimal ryuFloat(fp v);
+
+/**
+ * Dragon4 with exact big integers. Returns the same digits as Ryu for any
+ * significand of up to 64 bits, but takes microseconds. The smallest exponent
+ * of normal numbers marks where the gap below powers of two stops shrinking.
+ * Used for 80-bit long doubles.
+ */
+decimal dragon4(fp v, int significand_bits, int32_t min_exponent);
+
 } // namespace detail
 } // namespace fs
 
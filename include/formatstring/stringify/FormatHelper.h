@@ -29,6 +29,8 @@ struct Numformat: Alignformat
 	std::string type {};
 	bool alternate {false};
 	bool zero {false};
+	char grouping {'\0'};
+	int group_size {-1};
 	size_t parsed_until {0};
 };
 
@@ -45,10 +47,46 @@ std::string readSingleQuotedString(const std::string& fmt, size_t& i);
  * Inserts padding characters around the given string to bring it up to the
  * specified width. The center parameter determines at which point padding chars
  * could be inserted into the string, e.g. for sign aware padding (+____4.3).
+ * The width of UTF-8 text is measured in display columns, so that East Asian
+ * wide characters count twice and combining marks not at all.
  */
 std::string padStringToWidth(const std::string& source, const Alignformat& af,
 		size_t center = 0, char default_align = '<');
 
+/**
+ * Same as padStringToWidth(), but pads the UTF-8 text from begin to the end of
+ * out in place instead of creating a new string. The "=" alignment isn't
+ * supported.
+ */
+void padToWidth(std::string& out, size_t begin, const Alignformat& af,
+		char default_align = '<');
+
+/**
+ * Same as padStringToWidth(), but appends the padded source of the given
+ * length to out instead of creating a new string. The source is measured in
+ * bytes, which is only right for ASCII text like formatted numbers.
+ */
+void appendPadded(std::string& out, const char* source, size_t length,
+		const Alignformat& af, size_t center = 0, char default_align = '<');
+
+/** Returns the length of count digits with a separator every group digits. */
+size_t groupedLength(size_t count, size_t group);
+
+/**
+ * Inserts a separator every group digits, counted from the right, into the
+ * count digits in place. The buffer must hold groupedLength(count, group)
+ * characters. Returns the new length.
+ */
+size_t groupDigits(char* digits, size_t count, char separator, size_t group);
+
+/**
+ * Appends count digits to out with a separator every group digits, counted
+ * from the right. Leading zeros are added and grouped as well until the output
+ * is at least min_length characters long (e.g. 0,001,234).
+ */
+void appendGrouped(std::string& out, const char* digits, size_t count,
+		char separator, size_t group, size_t min_length = 0);
+
 } // namespace fs
 
 #endif //FORMATSTRING_FORMATHELPER_H
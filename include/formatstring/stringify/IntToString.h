@@ -7,8 +7,11 @@
 #ifndef FORMATSTRING_INTTOSTRING_H
 #define FORMATSTRING_INTTOSTRING_H
 
+#include <cstdint>
 #include <string>
 
+#include "formatstring/stringify/FormatHelper.h"
+
 namespace fs {
 
 /**
@@ -17,12 +20,15 @@ namespace fs {
  * Format string syntax
  * --------------------
  *
- *     [format_specifier] := [[fill]align][sign][#][0][width][type]
+ *     [format_specifier] := [[fill]align][sign][#][0][width][grouping]["." precision][type]
  *     [fill]             := any character
  *     [align]            := "<" | ">" | "^" | "="
  *     [sign]             := "+" | "-" | " "
  *     [width]            := integer
- *     [type]             := "d" | "b" | "o" | "x" | "X"
+ *     [grouping]         := ("," | "_") [group_size]
+ *     [group_size]       := integer
+ *     [precision]        := integer | integer "-" integer
+ *     [type]             := "d" | "b" | "o" | "x" | "X" | "si" | "bi"
  *
  * align/fill
  * ----------
@@ -62,6 +68,18 @@ namespace fs {
  * This value defines the width that the number should fill. The number may take
  * more space if required.
  *
+ * grouping
+ * --------
+ * If "," or "_" is given, that character is inserted between groups of digits
+ * (e.g. 1,234,567). Groups have 3 digits for decimal and 4 for all other
+ * bases, unless a group size from 1 to 99 is specified (e.g. "_8b"). Zero
+ * padding is grouped as well.
+ *
+ * precision
+ * ---------
+ * Only used by "si" and "bi", where it sets the number or range of significant
+ * digits like for floating point values. Values are rounded half to even.
+ *
  * type
  * ----
  * This option specifies the type of output. The following values are allowed:
@@ -70,6 +88,11 @@ namespace fs {
  * - "o" Octal output.
  * - "x" Hexadecimal output with lowercase characters.
  * - "X" Hexadecimal output with uppercase characters.
+ * - "si" Decimal output scaled by an SI prefix (e.g. 1.5k, 12.3M). Without
+ *       precision the value is printed exactly.
+ * - "bi" Decimal output scaled by a binary prefix of powers of 1024 (e.g.
+ *       1.5Ki, 12.3Mi). Without precision up to 4 significant digits are
+ *       printed.
  */
 std::string str(int, const std::string&);
 
@@ -86,6 +109,74 @@ std::string str(unsigned int 		value, const std::string& format);
 std::string str(unsigned long 		value, const std::string& format);
 std::string str(unsigned long long 	value, const std::string& format);
 
+#ifdef __SIZEOF_INT128__
+// Native 128-bit integers of GCC and Clang
+std::string str(__int128 			value, const std::string& format);
+std::string str(unsigned __int128 	value, const std::string& format);
+#endif
+
+
+namespace detail {
+
+/**
+ * Parses and validates an integer format string once, so that it can be
+ * reused for many values with appendInt().
+ */
+Numformat parseIntformat(const std::string& format);
+
+/** Appends the value formatted according to a parsed integer format to out. */
+void appendInt(std::string& out, long long value, const Numformat& nf);
+void appendInt(std::string& out, unsigned long long value, const Numformat& nf);
+#ifdef __SIZEOF_INT128__
+void appendInt(std::string& out, __int128 value, const Numformat& nf);
+void appendInt(std::string& out, unsigned __int128 value, const Numformat& nf);
+#endif
+
+/**
+ * Digit kernels for the supported bases 2, 8, 10 and 16. Each one writes the
+ * significant digits of value (at least a single "0") to out and returns their
+ * number. The buffer must hold maxDigits<Base>() characters. Only hexadecimal
+ * output uses the uppercase flag.
+ */
+template <unsigned Base>
+size_t writeDigits(uint64_t value, char* out, bool uppercase = false);
+
+template <> size_t writeDigits<2>(uint64_t value, char* out, bool uppercase);
+template <> size_t writeDigits<8>(uint64_t value, char* out, bool uppercase);
+template <> size_t writeDigits<10>(uint64_t value, char* out, bool uppercase);
+template <> size_t writeDigits<16>(uint64_t value, char* out, bool uppercase);
+
+#ifdef __SIZEOF_INT128__
+/**
+ * 128-bit variants of the digit kernels. The value is split into chunks that
+ * fit the 64-bit kernels, decimal values by dividing by 10^19. The buffer must
+ * hold 2 * maxDigits<Base>() characters.
+ */
+template <unsigned Base>
+size_t writeDigits(unsigned __int128 value, char* out, bool uppercase = false);
+#endif
+
+/** Returns the number of significant bits in value, at least 1. */
+inline int significantBits(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return value == 0 ? 1 : 64 - __builtin_clzll(value);
+#else
+	int bits = 1;
+	while (value >>= 1)
+		++bits;
+	return bits;
+#endif
 }
 
+/** Maximum number of digits of a 64-bit value in the given base. */
+template <unsigned Base>
+constexpr size_t maxDigits()
+{
+	return Base == 2 ? 64 : Base == 8 ? 22 : Base == 10 ? 20 : 16;
+}
+
+} // namespace detail
+} // namespace fs
+
 #endif //FORMATSTRING_INTTOSTRING_H
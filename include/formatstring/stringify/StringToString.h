@@ -7,7 +7,11 @@
 #ifndef FORMATSTRING_STRINGTOSTRING_H
 #define FORMATSTRING_STRINGTOSTRING_H
 
+#include <cstddef>
 #include <string>
+#if __cplusplus >= 201703l
+#include <string_view>
+#endif
 
 namespace fs {
 
@@ -17,13 +21,15 @@ namespace fs {
  * Format string syntax
  * --------------------
  *
- *     [format_specifier] := [[fill]align][#][width][substring][replace]
+ *     [format_specifier] := [[fill]align][#][width][substring][transform][replace][escape]
  *     [fill]             := any character
  *     [align]            := "<" | ">" | "^"
  *     [width]            := integer
  *     [substring]        := "s" integer "-" integer
- *     [replace]          := ( "r" replace_target "-" replace_target )*
+ *     [transform]        := ("t" | "u" | "l")*
+ *     [replace]          := ["m"] ( "r" replace_target "-" replace_target )*
  *     [replace_target]   := any character | "'" string "'"
+ *     [escape]           := "e" ("j" | "J" | "c" | "C" | "h")
  *
  * align/fill
  * ----------
@@ -48,6 +54,12 @@ namespace fs {
  * longer, it will be rounded to the amount of visible characters. If that isn't
  * enough, it might exceed this width limit.
  *
+ * Strings are taken as UTF-8 and measured in display columns: East Asian wide
+ * characters like CJK ideographs take two columns, combining marks none and
+ * all other characters one. Truncation never cuts a character in half; if a
+ * wide character doesn't fit anymore, the rest is padded instead. ASCII text is
+ * detected with SIMD instructions and measured in bytes.
+ *
  * substring
  * ---------
  * The substring segment begins with the 's' character. It can be separated from
@@ -61,7 +73,22 @@ namespace fs {
  * - s <a> - <b>: Forward the characters from the index a to b-1 or to the
  *     end of the input, whichever comes first.
  * Unlike in this documentation, there shouldn't be any spaces between the
- * numbers and the "s" or "-".
+ * numbers and the "s" or "-". The indices count UTF-8 code points.
+ *
+ * transform
+ * ---------
+ * Any of the following flags, which may be separated by spaces:
+ * - "t": Removes the ASCII whitespace at the beginning and the end of the
+ *     (sub)string.
+ * - "u": Maps all letters to upper case.
+ * - "l": Maps all letters to lower case.
+ * If both "u" and "l" are given, the last one counts. The case is mapped after
+ * the replacements and the truncation, so that search terms match the original
+ * text. ASCII text is mapped with SIMD instructions, other characters get the
+ * simple case mapping of Unicode, e.g. "é" becomes "É", but "ß" stays as it is.
+ * Bytes that aren't valid UTF-8 are copied unchanged.
+ *
+ *     tl r' '-_  // "  Order Id " becomes "order_id"
  *
  * replacement
  * -----------
@@ -81,6 +108,34 @@ namespace fs {
  *     r'Alice'-- // Replace all occurences of "Alice" with a dash
  *     r"-'\''    // Replace all double quotes with single quotes
  *
+ * If the statements are preceded by an 'm', all replacements are made at once
+ * in a single pass instead. At each position, the longest matching search term
+ * is replaced, and replaced text isn't searched again:
+ *
+ *     ra-b rb-a      // "ab" becomes "aa"
+ *     m ra-b rb-a    // "ab" becomes "ba"
+ *
+ * The replacements of a format are compiled once per thread into a single
+ * automaton. Sequential statements use it as well if that can't change the
+ * result, e.g. if no statement matches text that an earlier one replaced.
+ *
+ * escape
+ * ------
+ * The escape segment makes the string safe to embed into other formats. It is
+ * applied after the replacements and the truncation, so that no escape
+ * sequence is cut off, while padding counts the escaped string:
+ * - "ej": The content of a JSON string: quotes, backslashes and control
+ *     characters are escaped, e.g. \n or \u001f.
+ * - "eJ": Same as "ej", but each byte that isn't valid UTF-8 is replaced by
+ *     \ufffd, so that the output is always valid JSON.
+ * - "ec": A CSV value according to RFC 4180: if the string contains a comma,
+ *     quote or line break, it is enclosed in quotes and quotes are doubled.
+ * - "eC": The content of a C string literal, e.g. \t, \" or \033.
+ * - "eh": HTML text or attribute values: & < > " and ' are replaced by
+ *     character references.
+ * The input is scanned 16 or 32 bytes at a time, so text that needs no
+ * escaping is copied almost at the speed of memcpy.
+ *
  * single characters
  * -----------------
  *
@@ -89,6 +144,16 @@ namespace fs {
  *
  *     i#x        // Formats the char as a hex integer with the 0x prefix
  *     ra-b       // Formats the char like a string and changes an "a" to a "b"
+ *
+ * passthrough
+ * -----------
+ * std::string, const char* and, from C++17 on, std::string_view values are
+ * appended to the output of a Formatstring straight from their source. If the
+ * format is empty, the text is copied exactly once.
+ *
+ * Strings longer than 64 KiB are formatted in pieces of that size, so that
+ * besides the output, the memory needed doesn't grow with their length. Once
+ * a string has been truncated to its width, the rest isn't read anymore.
  */
  
 // Specially named str() to hinder the compiler from using implicit conversions
@@ -99,6 +164,23 @@ std::string str(const char* value, const std::string& format);
 
 std::string str(char value, const std::string& format);
 
+/**
+ * Appends the length characters at value formatted like a string to out,
+ * without copying them into a temporary string first.
+ */
+void appendString(std::string& out, const char* value, size_t length,
+		const std::string& format);
+
+#if __cplusplus >= 201703l
+// Specially named like str_string(), the library itself may be built as C++11
+inline std::string str_string_view(std::string_view value, const std::string& format)
+{
+	std::string out;
+	appendString(out, value.data(), value.length(), format);
+	return out;
+}
+#endif
+
 } // namespace fs
 
 #endif //FORMATSTRING_STRINGTOSTRING_H
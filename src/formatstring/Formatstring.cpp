@@ -106,29 +106,6 @@ void Formatstring::addVariable(U<Variable> var)
 	variables_.emplace_back(std::move(var));
 }
 
-std::string escapedSubstring(const std::string& s, size_t begin, size_t end)
-{
-	assertmsg(begin <= s.length() && end <= s.length() && begin <= end,
-			"Begin and end are out of range.\ns.length()=" << s.length()
-			<< ", begin=" << begin << ", end=" << end);
-	std::string out;
-	out.reserve(end - begin);
-	
-	for (size_t i = begin; i < end; ++i) {
-		char c = s[i];
-		if (c == '{') {
-			++i;
-			assertmsg(i < end && s[i] == '{', "Input string wasn't escaped\n"<<s);
-		} else if (c == '}') {
-			++i;
-			assertmsg(i < end && s[i] == '}', "Input string wasn't escaped\n"<<s);
-		}
-		out += c;
-	}
-	
-	return out;
-}
-
 std::string Formatstring::str() const
 {
 	std::string out;
@@ -137,13 +114,13 @@ std::string Formatstring::str() const
 		switch (s.type)
 		{
 		case SegmentType::Substring:
-			out += format_.substr(s.begin, s.end - s.begin);
+			out.append(format_, s.begin, s.end - s.begin);
 			break;
 			
 		case SegmentType::Variable:
 			if (s.variable >= variables_.size())
 				throw err::FormatException("Not enough variables provided", format_);
-			out += variables_[s.variable]->toString(escapedSubstring(format_, s.begin, s.end));
+			variables_[s.variable]->appendTo(out, detail::specifier(format_, s));
 			break;
 		}
 	}
@@ -182,114 +159,10 @@ void Formatstring::parseFormat()
 	segments_.clear();
 	printed_ = false;
 	
-	size_t l = format_.length();
-	size_t b = 0, i = 0;
-	size_t var_counter = 0;
-	
-	while (l > i) {
-		if (format_[i] == '{') {
-			// New variable or escaped brace
-			// 1. Emit last substring
-			if (i > b)
-				segments_.push_back({SegmentType::Substring, 0, b, i});
-			
-			// 2. Check if this is a variable or an escaped brace
-			if (++i < l) {
-				if (format_[i] == '{') {
-					// Escaped brace. Start a new substring from here so that
-					// the second brace character is included in it.
-					b = i;
-					
-				} else {
-					// Found a new variable!
-					// Check for a variable ID first...
-					size_t id;
-					if (isdigit(format_[i])) {
-						size_t begin = i;
-						id = 0;
-						while (i < l && isdigit(format_[i])) {
-							id = id * 10 + format_[i] - '0';
-							++i;
-						}
-						// IDs in formatter should start at 1, but they start at
-						// 0 in code...
-						if (id == 0)
-							throw err::FormatException("Variable IDs start at 1",
-									format_, begin);
-						--id;
-					} else {
-						id = var_counter++;
-					}
-					
-					Segment var{SegmentType::Variable, id, i, i};
-					
-					// If a colon follows, a format specifier can be expected
-					// Otherwise, a closing brace is expected
-					if (i < l && format_[i] == ':') {
-						var.begin = ++i;
-						while (i < l) {
-							if (format_[i] == '}') {
-								// Count the number of closing braces. If it is
-								// odd, end the formatter at the first one. If
-								// it is even, pass them on as formatting
-								// elements.
-								unsigned count = 1;
-								unsigned off = 1;
-								while (l > i + off && format_[i + off] == '}') {
-									++count;
-									++off;
-								}
-								if (count % 2) {
-									// Odd number: this format object ends.
-									var.end = i;
-									break;
-									
-								} else {
-									// Even number: add the escaped braces and
-									// continue
-									i += off - 1;
-								}
-							}
-							++i;
-						}
-						if (i >= l)
-							throw err::FormatException("EOF within variable specifier",
-									format_, i);
-						
-					} else {
-						if (i >= l)
-							throw err::FormatException("EOF within variable specifier",
-									format_, i);
-						else if (format_[i] != '}')
-							throw err::FormatException("Closing brace or colon expected",
-									format_, i);
-					}
-					
-					// At this point, the closing brace has been detected at the
-					// current cursor position.
-					segments_.push_back(var);
-					b = i + 1;
-				}
-				
-			} else {
-				throw err::FormatException("EOF within variable specifier", format_, i);
-			}
-			
-		} else if (format_[i] == '}') {
-			// Expecting a escaped brace
-			if (i + 1 >= l || format_[i + 1] != '}')
-				throw err::FormatException("Unexpected closing brace", format_, i);
-			// End the current substring and start the next
-			if (i > b)
-				segments_.push_back({SegmentType::Substring, 0, b, i});
-			b = ++i;
-		}
-		
-		++i;
-	}
-	
-	if (i > b)
-		segments_.push_back({SegmentType::Substring, 0, b, i});
+	detail::FormatParser parser(format_);
+	Segment segment;
+	while (parser.next(segment))
+		segments_.push_back(segment);
 }
 
 void swap(Formatstring& lhs, Formatstring& rhs)
@@ -0,0 +1,161 @@
+// formatstring/detail/FormatParser.cpp
+//
+// Implementation of the parser for format strings.
+
+#include "formatstring/detail/FormatParser.h"
+
+#include <cctype>
+
+#include "formatstring/err/FormatException.h"
+#include "formatstring/util/Assert.h"
+
+
+namespace fs {
+namespace detail {
+
+FormatParser::FormatParser(const std::string& format):
+		format_(format),
+		position_(0),
+		substring_begin_(0),
+		var_counter_(0)
+{}
+
+bool FormatParser::next(Segment& segment)
+{
+	const std::string& format = format_;
+	size_t l = format.length();
+	size_t& i = position_;
+	
+	while (l > i) {
+		if (format[i] != '{' && format[i] != '}') {
+			++i;
+			continue;
+		}
+		
+		// Emit the last substring first, the brace is handled on the next call
+		if (i > substring_begin_) {
+			segment = {SegmentType::Substring, 0, substring_begin_, i};
+			substring_begin_ = i;
+			return true;
+		}
+		
+		if (format[i] == '}') {
+			// Expecting a escaped brace
+			if (i + 1 >= l || format[i + 1] != '}')
+				throw err::FormatException("Unexpected closing brace", format, i);
+			// Start the next substring with the second brace
+			substring_begin_ = ++i;
+			++i;
+			continue;
+		}
+		
+		// New variable or escaped brace
+		if (++i >= l)
+			throw err::FormatException("EOF within variable specifier", format, i);
+		if (format[i] == '{') {
+			// Escaped brace. Start a new substring from here so that the
+			// second brace character is included in it.
+			substring_begin_ = i++;
+			continue;
+		}
+		
+		// Found a new variable!
+		// Check for a variable ID first...
+		size_t id;
+		if (isdigit(format[i])) {
+			size_t begin = i;
+			id = 0;
+			while (i < l && isdigit(format[i])) {
+				id = id * 10 + format[i] - '0';
+				++i;
+			}
+			// IDs in formatter should start at 1, but they start at 0 in
+			// code...
+			if (id == 0)
+				throw err::FormatException("Variable IDs start at 1", format, begin);
+			--id;
+		} else {
+			id = var_counter_++;
+		}
+		
+		Segment var{SegmentType::Variable, id, i, i};
+		
+		// If a colon follows, a format specifier can be expected
+		// Otherwise, a closing brace is expected
+		if (i < l && format[i] == ':') {
+			var.begin = ++i;
+			while (i < l) {
+				if (format[i] == '}') {
+					// Count the number of closing braces. If it is odd, end
+					// the formatter at the first one. If it is even, pass them
+					// on as formatting elements.
+					unsigned count = 1;
+					unsigned off = 1;
+					while (l > i + off && format[i + off] == '}') {
+						++count;
+						++off;
+					}
+					if (count % 2) {
+						// Odd number: this format object ends.
+						var.end = i;
+						break;
+					
+					} else {
+						// Even number: add the escaped braces and continue
+						i += off - 1;
+					}
+				}
+				++i;
+			}
+			if (i >= l)
+				throw err::FormatException("EOF within variable specifier", format, i);
+		
+		} else {
+			if (i >= l)
+				throw err::FormatException("EOF within variable specifier", format, i);
+			else if (format[i] != '}')
+				throw err::FormatException("Closing brace or colon expected", format, i);
+		}
+		
+		// At this point, the closing brace has been detected at the current
+		// cursor position.
+		substring_begin_ = ++i;
+		segment = var;
+		return true;
+	}
+	
+	if (i > substring_begin_) {
+		segment = {SegmentType::Substring, 0, substring_begin_, i};
+		substring_begin_ = i;
+		return true;
+	}
+	return false;
+}
+
+std::string specifier(const std::string& format, const Segment& segment)
+{
+	size_t begin = segment.begin;
+	size_t end = segment.end;
+	assertmsg(begin <= format.length() && end <= format.length() && begin <= end,
+			"Begin and end are out of range.\nformat.length()=" << format.length()
+			<< ", begin=" << begin << ", end=" << end);
+	std::string out;
+	out.reserve(end - begin);
+	
+	for (size_t i = begin; i < end; ++i) {
+		char c = format[i];
+		if (c == '{') {
+			++i;
+			assertmsg(i < end && format[i] == '{', "Input string wasn't escaped\n" << format);
+		} else if (c == '}') {
+			++i;
+			assertmsg(i < end && format[i] == '}', "Input string wasn't escaped\n" << format);
+		}
+		out += c;
+	}
+	
+	return out;
+}
+
+} // namespace detail
+} // namespace fs
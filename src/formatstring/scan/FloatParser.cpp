@@ -0,0 +1,496 @@
+// formatstring/scan/FloatParser.cpp
+//
+// Conversion of decimal text to floating point values. Most numbers take the
+// fast path of Clinger for short exact values or the algorithm of Eisel and
+// Lemire ("Number Parsing at a Gigabyte per Second", Software: Practice and
+// Experience 51(8), 2021), which is correct whenever it doesn't give up. The
+// remaining cases are decided with exact big integers.
+
+#include "formatstring/scan/FloatParser.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "formatstring/scan/EiselLemireTables.h"
+#include "formatstring/util/Bignum.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+/** Advances p past word if the text starts with it, ignoring case. */
+bool matchWord(const char*& p, const char* end, const char* word)
+{
+	size_t length = std::strlen(word);
+	if (static_cast<size_t>(end - p) < length)
+		return false;
+	for (size_t i = 0; i < length; ++i) {
+		if ((p[i] | 0x20) != word[i])
+			return false;
+	}
+	p += length;
+	return true;
+}
+
+/**
+ * Adds a digit to the first 19 significant ones. Digits that don't fit only
+ * move the exponent of integers and set the truncated flag.
+ */
+inline void addDigit(DecimalText& decimal, unsigned& count, unsigned digit,
+		bool fraction)
+{
+	if (count < 19) {
+		decimal.significand = decimal.significand * 10 + digit;
+		if (decimal.significand != 0)
+			++count;
+		if (fraction)
+			--decimal.exponent;
+	} else {
+		if (!fraction)
+			++decimal.exponent;
+		if (digit != 0)
+			decimal.truncated = true;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Eisel-Lemire
+
+/** Constants of an IEEE binary format for the Eisel-Lemire algorithm. */
+struct BinaryFormat {
+	int mantissa_bits;
+	int minimum_exponent;
+	int infinite_power;
+	int smallest_power_of_ten;
+	int largest_power_of_ten;
+	int min_exponent_round_to_even;
+	int max_exponent_round_to_even;
+};
+
+const BinaryFormat DOUBLE_FORMAT{52, -1023, 0x7ff, -342, 308, -4, 23};
+const BinaryFormat FLOAT_FORMAT{23, -127, 0xff, -64, 38, -17, 10};
+
+/** Returns the 128-bit product of a and b. */
+inline void multiply(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low)
+{
+#ifdef __SIZEOF_INT128__
+	using uint128 = unsigned __int128;
+	uint128 product = static_cast<uint128>(a) * b;
+	high = static_cast<uint64_t>(product >> 64);
+	low = static_cast<uint64_t>(product);
+#else
+	uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+	uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+	uint64_t lo_lo = a_lo * b_lo;
+	uint64_t hi_lo = a_hi * b_lo;
+	uint64_t lo_hi = a_lo * b_hi;
+	uint64_t hi_hi = a_hi * b_hi;
+	uint64_t mid = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+	high = hi_hi + (hi_lo >> 32) + (mid >> 32);
+	low = (mid << 32) | (lo_lo & 0xffffffff);
+#endif
+}
+
+inline int leadingZeros(uint64_t value)
+{
+	int count = 0;
+	while ((value & (1ull << 63)) == 0) {
+		value <<= 1;
+		++count;
+	}
+	return count;
+}
+
+/**
+ * Computes the bits of the closest value to w * 10^q without sign. Returns
+ * false if the product isn't precise enough to decide, which is very rare.
+ */
+bool eiselLemire(const BinaryFormat& format, uint64_t w, int64_t q, uint64_t& bits)
+{
+	if (w == 0 || q < format.smallest_power_of_ten) {
+		bits = 0;
+		return true;
+	}
+	if (q > format.largest_power_of_ten) {
+		bits = static_cast<uint64_t>(format.infinite_power) << format.mantissa_bits;
+		return true;
+	}
+	
+	int lz = leadingZeros(w);
+	w <<= lz;
+	
+	// w times the truncated 128-bit power of five. The second half is only
+	// needed if the bits below the mantissa and rounding bit are all set.
+	size_t index = 2 * static_cast<size_t>(q - SMALLEST_POWER_OF_FIVE);
+	uint64_t high, low;
+	multiply(w, POWERS_OF_FIVE[index], high, low);
+	uint64_t mask = ~0ull >> (format.mantissa_bits + 3);
+	if ((high & mask) == mask) {
+		uint64_t second_high, second_low;
+		multiply(w, POWERS_OF_FIVE[index + 1], second_high, second_low);
+		low += second_high;
+		if (second_high > low)
+			++high;
+		// 5^q fits into 128 bits for these exponents, otherwise the error of
+		// the truncated power could reach into the mantissa
+		if (low == ~0ull && (q < -27 || q > 55))
+			return false;
+	}
+	
+	int upperbit = static_cast<int>(high >> 63);
+	int shift = upperbit + 64 - format.mantissa_bits - 3;
+	uint64_t mantissa = high >> shift;
+	// floor(log2(10^q)) + 63 is the exponent of the product
+	int32_t power2 = static_cast<int32_t>((((152170 + 65536) * q) >> 16) + 63)
+			+ upperbit - lz - format.minimum_exponent;
+	
+	if (power2 <= 0) {
+		// Denormal, shift the mantissa into place and round
+		if (-power2 + 1 >= 64) {
+			bits = 0;
+			return true;
+		}
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		// Rounding may have carried into the smallest normal number
+		power2 = mantissa < (1ull << format.mantissa_bits) ? 0 : 1;
+		bits = (mantissa & ((1ull << format.mantissa_bits) - 1))
+				| static_cast<uint64_t>(power2) << format.mantissa_bits;
+		return true;
+	}
+	
+	// Exactly halfway between two values, which is only possible for small
+	// exponents, rounds to even instead of up
+	if (low <= 1 && q >= format.min_exponent_round_to_even
+			&& q <= format.max_exponent_round_to_even && (mantissa & 3) == 1
+			&& (mantissa << shift) == high)
+		mantissa &= ~1ull;
+	
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ull << format.mantissa_bits)) {
+		mantissa = 1ull << format.mantissa_bits;
+		++power2;
+	}
+	mantissa &= ~(1ull << format.mantissa_bits);
+	if (power2 >= format.infinite_power) {
+		bits = static_cast<uint64_t>(format.infinite_power) << format.mantissa_bits;
+		return true;
+	}
+	bits = mantissa | static_cast<uint64_t>(power2) << format.mantissa_bits;
+	return true;
+}
+
+/**
+ * Runs Eisel-Lemire for the decimal. If digits were cut off, the value lies
+ * between significand and significand + 1, and it is only decided if both
+ * bounds give the same result.
+ */
+bool eiselLemire(const BinaryFormat& format, const DecimalText& decimal, uint64_t& bits)
+{
+	if (!eiselLemire(format, decimal.significand, decimal.exponent, bits))
+		return false;
+	if (!decimal.truncated)
+		return true;
+	uint64_t upper;
+	return eiselLemire(format, decimal.significand + 1, decimal.exponent, upper)
+			&& upper == bits;
+}
+
+//------------------------------------------------------------------------------
+// Exact conversion
+
+/**
+ * More digits than this don't change the result of any supported format, the
+ * halfway points of the smallest long doubles have less than 12000 of them.
+ */
+const unsigned MAX_DIGITS = 20000;
+
+/**
+ * Converts the decimal exactly to the value with bits of precision, ties to
+ * even. Values below 2^min_exponent are denormal.
+ */
+template <typename T>
+T exactValue(const DecimalText& decimal, int bits, int32_t min_exponent)
+{
+	// Read all significant digits again, nine at a time
+	Bignum n;
+	unsigned count = 0;
+	bool sticky = false;
+	uint32_t chunk = 0;
+	unsigned chunk_digits = 0;
+	for (const char* p = decimal.begin; p != decimal.end; ++p) {
+		if (!isDigit(*p) || (count == 0 && *p == '0'))
+			continue;
+		if (count == MAX_DIGITS) {
+			sticky = sticky || *p != '0';
+			continue;
+		}
+		chunk = chunk * 10 + static_cast<uint32_t>(*p - '0');
+		++count;
+		if (++chunk_digits == 9) {
+			n.mulSmall(1000000000).addSmall(chunk);
+			chunk = 0;
+			chunk_digits = 0;
+		}
+	}
+	// A nonzero digit beyond the kept ones lies below any halfway point
+	if (sticky) {
+		chunk = chunk * 10 + 1;
+		++count;
+		++chunk_digits;
+	}
+	uint32_t scale = 1;
+	for (unsigned i = 0; i < chunk_digits; ++i)
+		scale *= 10;
+	n.mulSmall(scale).addSmall(chunk);
+	
+	if (n.isZero())
+		return 0;
+	int64_t q = decimal.exponent - (count > 19 ? count - 19 : 0);
+	if (q + count > 5000)
+		return std::numeric_limits<T>::infinity();
+	if (q + count < -5000)
+		return 0;
+	
+	// The value is num / den
+	Bignum num = n, den(1);
+	if (q >= 0)
+		num.mulPow10(static_cast<unsigned>(q));
+	else
+		den.mulPow10(static_cast<unsigned>(-q));
+	
+	// Scale by 2^k so that the quotient has exactly bits bits, or less for
+	// denormals
+	int64_t k = bits - static_cast<int64_t>(num.bitLength())
+			+ static_cast<int64_t>(den.bitLength());
+	if (k > -static_cast<int64_t>(min_exponent))
+		k = -static_cast<int64_t>(min_exponent);
+	Bignum quotient, remainder;
+	for (;;) {
+		Bignum shifted_num = num, shifted_den = den;
+		if (k >= 0)
+			shifted_num.shiftLeft(static_cast<size_t>(k));
+		else
+			shifted_den.shiftLeft(static_cast<size_t>(-k));
+		Bignum::divMod(shifted_num, shifted_den, quotient, remainder);
+		if (quotient.bitLength() <= static_cast<size_t>(bits)) {
+			den = shifted_den;
+			break;
+		}
+		--k;
+	}
+	
+	// Round to nearest, ties to even
+	remainder.shiftLeft(1);
+	int cmp = Bignum::compare(remainder, den);
+	if (cmp > 0 || (cmp == 0 && quotient.isOdd()))
+		quotient.addSmall(1);
+	if (quotient.bitLength() > static_cast<size_t>(bits)) {
+		// Carried into a power of two, which loses no bits
+		quotient = Bignum(1);
+		quotient.shiftLeft(static_cast<size_t>(bits - 1));
+		--k;
+	}
+	
+	return std::ldexp(static_cast<T>(quotient.low64()), static_cast<int>(-k));
+}
+
+/** Whether long double is the x87 extended format with an explicit integer bit. */
+const bool X87_LONG_DOUBLE = std::numeric_limits<long double>::digits == 64
+		&& std::numeric_limits<long double>::max_exponent == 16384;
+
+/** Exact powers of ten for the fast path of Clinger. */
+const double DOUBLE_POWERS_OF_TEN[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const long double LONG_DOUBLE_POWERS_OF_TEN[] = {
+	1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L,
+	1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L,
+	1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+};
+
+/** Applies the sign and handles infinity and NaN. */
+template <typename T>
+bool specialValue(const DecimalText& decimal, T& value)
+{
+	if (decimal.nan) {
+		value = std::numeric_limits<T>::quiet_NaN();
+	} else if (decimal.infinity) {
+		value = std::numeric_limits<T>::infinity();
+	} else {
+		return false;
+	}
+	if (decimal.negative)
+		value = -value;
+	return true;
+}
+
+} // anonymous namespace
+
+const char* parseDecimal(const char* begin, const char* end, char grouping,
+		DecimalText& decimal)
+{
+	decimal = {0, 0, false, false, false, false, begin, begin, grouping};
+	const char* p = begin;
+	if (p != end && (*p == '-' || *p == '+')) {
+		decimal.negative = *p == '-';
+		++p;
+	}
+	
+	if (p != end && !isDigit(*p) && *p != '.') {
+		if (matchWord(p, end, "infinity") || matchWord(p, end, "inf"))
+			decimal.infinity = true;
+		else if (matchWord(p, end, "nan"))
+			decimal.nan = true;
+		else
+			return begin;
+		decimal.end = p;
+		return p;
+	}
+	
+	// Integer digits, where separators are only allowed between digits
+	decimal.begin = p;
+	unsigned count = 0;
+	bool any_digits = false;
+	while (p != end) {
+		if (isDigit(*p)) {
+			addDigit(decimal, count, static_cast<unsigned>(*p - '0'), false);
+			any_digits = true;
+		} else if (*p != grouping || grouping == '\0' || !any_digits
+				|| p + 1 == end || !isDigit(p[1])) {
+			break;
+		}
+		++p;
+	}
+	
+	// Fraction digits
+	if (p != end && *p == '.') {
+		const char* q = p + 1;
+		while (q != end && isDigit(*q)) {
+			addDigit(decimal, count, static_cast<unsigned>(*q - '0'), true);
+			any_digits = true;
+			++q;
+		}
+		if (!any_digits)
+			return begin;
+		p = q;
+	}
+	if (!any_digits)
+		return begin;
+	decimal.end = p;
+	
+	// The exponent only counts if there are digits after the "e"
+	if (p != end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negative = false;
+		if (q != end && (*q == '-' || *q == '+')) {
+			negative = *q == '-';
+			++q;
+		}
+		if (q != end && isDigit(*q)) {
+			int64_t exponent = 0;
+			for (; q != end && isDigit(*q); ++q) {
+				// Anything beyond this is zero or infinity anyway
+				if (exponent < 100000000)
+					exponent = exponent * 10 + (*q - '0');
+			}
+			decimal.exponent += negative ? -exponent : exponent;
+			p = q;
+		}
+	}
+	return p;
+}
+
+float decimalToFloat(const DecimalText& decimal)
+{
+	float value;
+	if (specialValue(decimal, value))
+		return value;
+
+#if FLT_EVAL_METHOD == 0
+	if (!decimal.truncated && decimal.significand <= (1ull << 24)
+			&& decimal.exponent >= -10 && decimal.exponent <= 10) {
+		value = static_cast<float>(decimal.significand);
+		if (decimal.exponent < 0)
+			value /= static_cast<float>(DOUBLE_POWERS_OF_TEN[-decimal.exponent]);
+		else
+			value *= static_cast<float>(DOUBLE_POWERS_OF_TEN[decimal.exponent]);
+		return decimal.negative ? -value : value;
+	}
+#endif
+	
+	uint64_t bits;
+	if (eiselLemire(FLOAT_FORMAT, decimal, bits)) {
+		uint32_t bits32 = static_cast<uint32_t>(bits);
+		std::memcpy(&value, &bits32, sizeof(value));
+	} else {
+		value = exactValue<float>(decimal, 24, -149);
+	}
+	return decimal.negative ? -value : value;
+}
+
+double decimalToDouble(const DecimalText& decimal)
+{
+	double value;
+	if (specialValue(decimal, value))
+		return value;
+
+#if FLT_EVAL_METHOD == 0
+	if (!decimal.truncated && decimal.significand <= (1ull << 53)
+			&& decimal.exponent >= -22 && decimal.exponent <= 22) {
+		value = static_cast<double>(decimal.significand);
+		if (decimal.exponent < 0)
+			value /= DOUBLE_POWERS_OF_TEN[-decimal.exponent];
+		else
+			value *= DOUBLE_POWERS_OF_TEN[decimal.exponent];
+		return decimal.negative ? -value : value;
+	}
+#endif
+	
+	uint64_t bits;
+	if (eiselLemire(DOUBLE_FORMAT, decimal, bits))
+		std::memcpy(&value, &bits, sizeof(value));
+	else
+		value = exactValue<double>(decimal, 53, -1074);
+	return decimal.negative ? -value : value;
+}
+
+long double decimalToLongDouble(const DecimalText& decimal)
+{
+	// Other formats, like binary128 or double-double, are read with double
+	// precision, which is also what they are printed with
+	if (!X87_LONG_DOUBLE)
+		return decimalToDouble(decimal);
+	
+	long double value;
+	if (specialValue(decimal, value))
+		return value;
+	
+	// Every 64-bit significand and power of ten up to 10^27 is exact
+	if (!decimal.truncated && decimal.exponent >= -27 && decimal.exponent <= 27) {
+		value = static_cast<long double>(decimal.significand);
+		if (decimal.exponent < 0)
+			value /= LONG_DOUBLE_POWERS_OF_TEN[-decimal.exponent];
+		else
+			value *= LONG_DOUBLE_POWERS_OF_TEN[decimal.exponent];
+	} else {
+		value = exactValue<long double>(decimal, 64, -16445);
+	}
+	return decimal.negative ? -value : value;
+}
+
+} // namespace detail
+} // namespace fs
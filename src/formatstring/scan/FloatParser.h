@@ -0,0 +1,51 @@
+/** @file formatstring/scan/FloatParser.h
+ *
+ * Locale independent conversion of decimal text to floating point values. This
+ * header is private to the library.
+ */
+
+#ifndef FORMATSTRING_FLOATPARSER_H
+#define FORMATSTRING_FLOATPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+
+/**
+ * A decimal number read from text, significand * 10^exponent. Only the first
+ * 19 significant digits are kept in significand. If there were more nonzero
+ * digits, truncated is set and the digits can be read again from the text
+ * between begin and end.
+ */
+struct DecimalText {
+	uint64_t significand;
+	int64_t exponent;
+	bool negative;
+	bool truncated;
+	bool infinity;
+	bool nan;
+	const char* begin;
+	const char* end;
+	char grouping;
+};
+
+/**
+ * Reads a decimal number like "-1,234.5e-6", "inf" or "NaN" starting at begin.
+ * The grouping character, if not '\0', may separate digits before the point.
+ * Returns the position after the number, or begin if there is none.
+ */
+const char* parseDecimal(const char* begin, const char* end, char grouping,
+		DecimalText& decimal);
+
+/** Converts the decimal to the closest value, ties to even. */
+float decimalToFloat(const DecimalText& decimal);
+double decimalToDouble(const DecimalText& decimal);
+long double decimalToLongDouble(const DecimalText& decimal);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_FLOATPARSER_H
@@ -0,0 +1,448 @@
+// formatstring/scan/Scan.cpp
+//
+// Implementation of scan(), which reads formatted values back from text.
+
+#include "formatstring/Scan.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "formatstring/detail/FormatParser.h"
+#include "formatstring/err/FormatException.h"
+#include "formatstring/scan/FloatParser.h"
+#include "formatstring/stringify/FloatToString.h"
+#include "formatstring/stringify/FormatHelper.h"
+#include "formatstring/stringify/IntToString.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+/** Returns the value of a digit in any base up to 16, or 16 for other chars. */
+inline unsigned digitValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return static_cast<unsigned>(c - '0');
+	c = static_cast<char>(c | 0x20);
+	if (c >= 'a' && c <= 'f')
+		return static_cast<unsigned>(c - 'a' + 10);
+	return 16;
+}
+
+/** Skips fill characters, unless they could be part of a number. */
+void skipFill(const char*& p, const char* end, char fill)
+{
+	if (fill >= '0' && fill <= '9')
+		return;
+	while (p != end && *p == fill)
+		++p;
+}
+
+/**
+ * Skips fill characters after a field that started at begin, but only as far
+ * as the width of the field.
+ */
+void skipTrailingFill(const char*& p, const char* end, const char* begin,
+		const Alignformat& af)
+{
+	if (af.fill >= '0' && af.fill <= '9')
+		return;
+	while (p != end && *p == af.fill && p - begin < af.width)
+		++p;
+}
+
+template <typename T>
+inline void store(void* target, T value)
+{
+	std::memcpy(target, &value, sizeof(value));
+}
+
+//------------------------------------------------------------------------------
+// Integers
+
+/**
+ * Reads an integer with sign, base prefix and grouping characters. Returns
+ * false if there is none or if it doesn't fit into 64 bits.
+ */
+bool readInteger(const char*& p, const char* end, const Numformat& nf,
+		unsigned base, bool& negative, uint64_t& magnitude)
+{
+	const char* q = p;
+	negative = false;
+	if (q != end && (*q == '-' || *q == '+')) {
+		negative = *q == '-';
+		++q;
+	}
+	
+	// The prefix only counts if digits follow, "0x" alone is a zero
+	char prefix = base == 2 ? 'b' : base == 8 ? 'o' : 'x';
+	if (base != 10 && end - q > 2 && q[0] == '0' && (q[1] | 0x20) == prefix
+			&& (digitValue(q[2]) < base || (nf.align == '=' && q[2] == nf.fill)))
+		q += 2;
+	if (nf.align == '=')
+		skipFill(q, end, nf.fill);
+	
+	uint64_t value = 0;
+	bool any_digits = false;
+	for (; q != end; ++q) {
+		unsigned digit = digitValue(*q);
+		if (digit < base) {
+			if (value > (~0ull - digit) / base)
+				return false;
+			value = value * base + digit;
+			any_digits = true;
+		} else if (*q != nf.grouping || nf.grouping == '\0' || !any_digits
+				|| q + 1 == end || digitValue(q[1]) >= base) {
+			break;
+		}
+	}
+	if (!any_digits)
+		return false;
+	
+	p = q;
+	magnitude = value;
+	return true;
+}
+
+/** Reads an integer field and stores it if it fits into the variable. */
+bool scanInteger(const char*& p, const char* end, const std::string& spec,
+		const ScanArg& arg)
+{
+	Numformat nf = parseIntformat(spec);
+	unsigned base = 10;
+	if (nf.type == "x" || nf.type == "X")
+		base = 16;
+	else if (nf.type == "o")
+		base = 8;
+	else if (nf.type == "b")
+		base = 2;
+	else if (nf.type == "si" || nf.type == "bi")
+		throw err::FormatException("Type \"" + nf.type + "\" can't be scanned",
+				spec, nf.parsed_until - nf.type.length());
+	
+	skipFill(p, end, nf.fill);
+	const char* begin = p;
+	bool negative;
+	uint64_t magnitude;
+	if (!readInteger(p, end, nf, base, negative, magnitude))
+		return false;
+	
+	unsigned bits = static_cast<unsigned>(arg.size * 8);
+	if (arg.type == ScanArg::Type::Signed) {
+		uint64_t max = (1ull << (bits - 1)) - 1;
+		if (magnitude > max + (negative ? 1 : 0))
+			return false;
+		int64_t value = negative ? static_cast<int64_t>(0 - magnitude)
+		                         : static_cast<int64_t>(magnitude);
+		switch (arg.size) {
+		case 1: store(arg.target, static_cast<int8_t>(value)); break;
+		case 2: store(arg.target, static_cast<int16_t>(value)); break;
+		case 4: store(arg.target, static_cast<int32_t>(value)); break;
+		default: store(arg.target, value); break;
+		}
+	} else {
+		uint64_t max = bits == 64 ? ~0ull : (1ull << bits) - 1;
+		if (magnitude > max || (negative && magnitude != 0))
+			return false;
+		switch (arg.size) {
+		case 1: store(arg.target, static_cast<uint8_t>(magnitude)); break;
+		case 2: store(arg.target, static_cast<uint16_t>(magnitude)); break;
+		case 4: store(arg.target, static_cast<uint32_t>(magnitude)); break;
+		default: store(arg.target, magnitude); break;
+		}
+	}
+	
+	skipTrailingFill(p, end, begin, nf);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Floating point values
+
+/** Returns the power of ten of an SI prefix, or 0 if c is none. */
+int siPower(char c)
+{
+	switch (c) {
+	case 'y': return -24;
+	case 'z': return -21;
+	case 'a': return -18;
+	case 'f': return -15;
+	case 'p': return -12;
+	case 'n': return -9;
+	case 'u': return -6;
+	case 'm': return -3;
+	case 'k': return 3;
+	case 'M': return 6;
+	case 'G': return 9;
+	case 'T': return 12;
+	case 'P': return 15;
+	case 'E': return 18;
+	case 'Z': return 21;
+	case 'Y': return 24;
+	default:  return 0;
+	}
+}
+
+/** Reads a floating point field and stores it in the type of the variable. */
+bool scanFloat(const char*& p, const char* end, const std::string& spec,
+		const ScanArg& arg)
+{
+	Numformat nf = parseFloatformat(spec);
+	
+	skipFill(p, end, nf.fill);
+	const char* begin = p;
+	const char* q = p;
+	bool negative = false;
+	if (nf.align == '=' && q != end && (*q == '-' || *q == '+')) {
+		negative = *q == '-';
+		++q;
+		skipFill(q, end, nf.fill);
+	}
+	
+	DecimalText decimal;
+	const char* after = parseDecimal(q, end, nf.grouping, decimal);
+	if (after == q)
+		return false;
+	decimal.negative = decimal.negative != negative;
+	
+	bool si = nf.type.length() == 2 && (nf.type[0] | 0x20) == 's'
+			&& (nf.type[1] | 0x20) == 'i';
+	if (si && after != end && !decimal.infinity && !decimal.nan) {
+		int power = siPower(*after);
+		if (power != 0) {
+			decimal.exponent += power;
+			++after;
+		}
+	}
+	p = after;
+	
+	switch (arg.type) {
+	case ScanArg::Type::Float:
+		store(arg.target, decimalToFloat(decimal));
+		break;
+	case ScanArg::Type::Double:
+		store(arg.target, decimalToDouble(decimal));
+		break;
+	default:
+		store(arg.target, decimalToLongDouble(decimal));
+		break;
+	}
+	
+	skipTrailingFill(p, end, begin, nf);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Text
+
+/** Reads a bool by its names, "true" and "false" unless given in the format. */
+bool scanBool(const char*& p, const char* end, const std::string& spec,
+		const ScanArg& arg)
+{
+	size_t l = spec.length();
+	size_t i = 0;
+	Alignformat af{};
+	if (!spec.empty() && spec[0] != 'd' && spec[0] != 'D')
+		af = parseAlignformat(spec, i);
+	
+	std::string ntrue, nfalse;
+	if (i < l && spec[i] == 'n') {
+		++i;
+		ntrue = readSingleQuotedString(spec, i);
+		if (i >= l || spec[i++] != ' ')
+			throw err::FormatException("Space expected", spec, i-1);
+		nfalse = readSingleQuotedString(spec, i);
+	} else {
+		ntrue = "true";
+		nfalse = "false";
+	}
+	
+	skipFill(p, end, af.fill);
+	const char* begin = p;
+	size_t available = static_cast<size_t>(end - p);
+	auto matches = [&](const std::string& name) {
+		return name.length() <= available && name.compare(0, name.length(), p, name.length()) == 0;
+	};
+	
+	// The longer name first, in case one is a prefix of the other
+	bool true_first = ntrue.length() >= nfalse.length();
+	const std::string& first = true_first ? ntrue : nfalse;
+	const std::string& second = true_first ? nfalse : ntrue;
+	bool value;
+	if (matches(first)) {
+		value = true_first;
+		p += first.length();
+	} else if (matches(second)) {
+		value = !true_first;
+		p += second.length();
+	} else {
+		return false;
+	}
+	
+	store(arg.target, value);
+	skipTrailingFill(p, end, begin, af);
+	return true;
+}
+
+/**
+ * Returns the end of a text field at p. It ends at the literal text that
+ * follows in the format, at whitespace if another field follows, or at the
+ * end of the input.
+ */
+const char* textEnd(const char* p, const char* end, const std::string& format,
+		const FormatParser& parser)
+{
+	FormatParser lookahead = parser;
+	Segment next;
+	if (!lookahead.next(next))
+		return end;
+	
+	if (next.type == SegmentType::Substring) {
+		const char* literal = format.data() + next.begin;
+		size_t length = next.end - next.begin;
+		for (const char* q = p; static_cast<size_t>(end - q) >= length; ++q) {
+			if (std::memcmp(q, literal, length) == 0)
+				return q;
+		}
+		return end;
+	}
+	
+	while (p != end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+		++p;
+	return p;
+}
+
+/** Removes the padding of an aligned text field. */
+void stripPadding(const char*& begin, const char*& end, const Alignformat& af)
+{
+	if (af.align == '\0')
+		return;
+	if (af.align != '<') {
+		while (begin != end && *begin == af.fill)
+			++begin;
+	}
+	if (af.align != '>') {
+		while (begin != end && end[-1] == af.fill)
+			--end;
+	}
+}
+
+/** Reads a single character, or its code with the "i" format. */
+bool scanChar(const char*& p, const char* end, const std::string& spec,
+		const ScanArg& arg, const std::string& format, const FormatParser& parser)
+{
+	if (!spec.empty() && spec[0] == 'i') {
+		unsigned char code;
+		ScanArg code_arg{ScanArg::Type::Unsigned, &code, 1};
+		if (!scanInteger(p, end, spec.substr(1), code_arg))
+			return false;
+		store(arg.target, static_cast<char>(code));
+		return true;
+	}
+	
+	size_t i = 0;
+	Alignformat af = parseAlignformat(spec, i);
+	if (af.width <= 1) {
+		if (p == end)
+			return false;
+		store(arg.target, *p++);
+		return true;
+	}
+	
+	// A padded char is the one that is left after removing the padding, or
+	// the fill character itself if there is nothing else
+	const char* field_end = textEnd(p, end, format, parser);
+	const char* begin = p;
+	const char* text_end = field_end;
+	stripPadding(begin, text_end, af);
+	if (text_end - begin > 1 || field_end == p)
+		return false;
+	store(arg.target, begin != text_end ? *begin : af.fill);
+	p = field_end;
+	return true;
+}
+
+/** Reads a string field, see textEnd(). */
+bool scanString(const char*& p, const char* end, const std::string& spec,
+		const ScanArg& arg, const std::string& format, const FormatParser& parser)
+{
+	size_t i = 0;
+	Alignformat af = parseAlignformat(spec, i);
+	const char* field_end = textEnd(p, end, format, parser);
+	const char* begin = p;
+	const char* text_end = field_end;
+	stripPadding(begin, text_end, af);
+	static_cast<std::string*>(arg.target)->assign(begin, text_end);
+	p = field_end;
+	return true;
+}
+
+} // anonymous namespace
+
+size_t scanArgs(const std::string& input, const std::string& format,
+		const ScanArg* args, size_t count)
+{
+	const char* p = input.data();
+	const char* end = p + input.length();
+	FormatParser parser(format);
+	Segment segment;
+	size_t assigned = 0;
+	bool matching = true;
+	
+	// After a mismatch, the rest of the format is still checked for errors
+	while (parser.next(segment)) {
+		if (segment.type == SegmentType::Substring) {
+			size_t length = segment.end - segment.begin;
+			if (!matching)
+				continue;
+			if (static_cast<size_t>(end - p) < length
+					|| std::memcmp(p, format.data() + segment.begin, length) != 0)
+				matching = false;
+			else
+				p += length;
+			continue;
+		}
+		
+		if (segment.variable >= count)
+			throw err::FormatException("Not enough variables provided", format);
+		if (!matching)
+			continue;
+		
+		// Short specifiers fit into the string itself, so numeric fields don't
+		// allocate
+		std::string spec = specifier(format, segment);
+		const ScanArg& arg = args[segment.variable];
+		switch (arg.type) {
+		case ScanArg::Type::Signed:
+		case ScanArg::Type::Unsigned:
+			matching = scanInteger(p, end, spec, arg);
+			break;
+		case ScanArg::Type::Float:
+		case ScanArg::Type::Double:
+		case ScanArg::Type::LongDouble:
+			matching = scanFloat(p, end, spec, arg);
+			break;
+		case ScanArg::Type::Bool:
+			matching = scanBool(p, end, spec, arg);
+			break;
+		case ScanArg::Type::Char:
+			matching = scanChar(p, end, spec, arg, format, parser);
+			break;
+		case ScanArg::Type::String:
+			matching = scanString(p, end, spec, arg, format, parser);
+			break;
+		case ScanArg::Type::None:
+			matching = false;
+			break;
+		}
+		if (matching)
+			++assigned;
+	}
+	
+	return assigned;
+}
+
+} // namespace detail
+} // namespace fs
@@ -0,0 +1,128 @@
+// formatstring/stringify/BigIntToString.cpp
+//
+// toString implementation for integers of arbitrary size.
+
+#include "formatstring/stringify/BigIntToString.h"
+
+#include "formatstring/err/FormatException.h"
+#include "formatstring/stringify/FormatHelper.h"
+#include "formatstring/stringify/IntToString.h"
+#include "formatstring/util/Bignum.h"
+
+namespace fs {
+
+namespace {
+
+/** Returns count (at most 64) bits of the limbs starting at bit offset. */
+uint64_t readBits(const BigIntView& value, size_t offset, unsigned count)
+{
+	size_t index = offset / 64;
+	unsigned shift = offset % 64;
+	
+	uint64_t out = value.getLimbs()[index] >> shift;
+	if (shift != 0 && index + 1 < value.getSize())
+		out |= value.getLimbs()[index + 1] << (64 - shift);
+	return count < 64 ? out & ((1ull << count) - 1) : out;
+}
+
+/**
+ * Writes the digits of a power-of-two base. The value is sliced into chunks of
+ * whole digits that fit the 64-bit kernels, 64 bits for binary and hex and 63
+ * bits for octal.
+ */
+template <unsigned Base>
+void appendSlicedDigits(std::string& out, const BigIntView& value,
+		size_t bit_length, bool uppercase)
+{
+	const unsigned digit_bits = Base == 2 ? 1 : Base == 8 ? 3 : 4;
+	const unsigned chunk_bits = 64 / digit_bits * digit_bits;
+	const size_t chunk_digits = chunk_bits / digit_bits;
+	
+	size_t chunks = bit_length == 0 ? 1 : (bit_length + chunk_bits - 1) / chunk_bits;
+	char buffer[detail::maxDigits<Base>()];
+	
+	for (size_t i = chunks; i-- > 0;) {
+		uint64_t chunk = bit_length == 0 ? 0 : readBits(value, i * chunk_bits, chunk_bits);
+		size_t count = detail::writeDigits<Base>(chunk, buffer, uppercase);
+		if (i != chunks - 1)
+			out.append(chunk_digits - count, '0');
+		out.append(buffer, count);
+	}
+}
+
+} // anonymous namespace
+
+std::string str(const BigIntView& value, const std::string& format)
+{
+	Numformat nf = detail::parseIntformat(format);
+	if (nf.type.length() == 2)
+		throw err::FormatException("Unknown type parameter \"" + nf.type + "\"",
+				format, nf.parsed_until - nf.type.length());
+	char type = nf.type.empty() ? 'd' : nf.type[0];
+	
+	// Ignore leading zero limbs
+	size_t size = value.getSize();
+	while (size > 0 && value.getLimbs()[size - 1] == 0)
+		--size;
+	BigIntView trimmed(value.getLimbs(), size, value.isNegative());
+	
+	size_t bit_length = 0;
+	if (size > 0) {
+		uint64_t top = value.getLimbs()[size - 1];
+		bit_length = (size - 1) * 64;
+		while (top != 0) {
+			++bit_length;
+			top >>= 1;
+		}
+	}
+	
+	std::string digits;
+	
+	// Output sign
+	if (value.isNegative() && size > 0) {
+		digits += '-';
+	} else {
+		if (nf.sign == '+')
+			digits += '+';
+		else if (nf.sign == ' ')
+			digits += ' ';
+	}
+	
+	// Output base if needed
+	if (nf.alternate && type != 'd') {
+		digits += '0';
+		digits += type == 'X' ? 'x' : type;
+	}
+	
+	size_t center = digits.length();
+	
+	// Output digits
+	switch (type) {
+	case 'b': appendSlicedDigits<2>(digits, trimmed, bit_length, false); break;
+	case 'o': appendSlicedDigits<8>(digits, trimmed, bit_length, false); break;
+	case 'x': appendSlicedDigits<16>(digits, trimmed, bit_length, false); break;
+	case 'X': appendSlicedDigits<16>(digits, trimmed, bit_length, true); break;
+	default:  detail::Bignum(trimmed.getLimbs(), size).appendDecimal(digits); break;
+	}
+	
+	std::string out;
+	if (nf.grouping != '\0') {
+		size_t group = nf.group_size != -1 ? static_cast<size_t>(nf.group_size)
+		                                   : (type == 'd' ? 3 : 4);
+		std::string grouped(digits, 0, center);
+		if (nf.zero) {
+			// Zero padding is grouped as well, e.g. 0,001,234
+			size_t width = nf.width > 0 ? static_cast<size_t>(nf.width) : 0;
+			appendGrouped(grouped, digits.data() + center, digits.length() - center,
+					nf.grouping, group, width > center ? width - center : 0);
+			return grouped;
+		}
+		appendGrouped(grouped, digits.data() + center, digits.length() - center,
+				nf.grouping, group);
+		digits.swap(grouped);
+	}
+	appendPadded(out, digits.data(), digits.length(), nf, center, '>');
+	return out;
+}
+
+} // namespace fs
@@ -0,0 +1,152 @@
+// formatstring/stringify/DecimalToString.cpp
+//
+// toString implementation for fixed-point decimals
+
+#include "formatstring/stringify/DecimalToString.h"
+
+#include <cstring>
+
+#include "formatstring/err/FormatException.h"
+#include "formatstring/stringify/IntToString.h"
+
+
+namespace fs {
+
+namespace {
+
+const uint64_t POW10[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+	100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+	1000000000000ull, 10000000000000ull, 100000000000000ull,
+	1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+	1000000000000000000ull, 10000000000000000000ull
+};
+
+} // anonymous namespace
+
+std::string str(const ScaledDecimal& value, const std::string& format)
+{
+	std::string out;
+	detail::appendDecimal(out, value, detail::parseDecimalformat(format));
+	return out;
+}
+
+namespace detail {
+
+Numformat parseDecimalformat(const std::string& format)
+{
+	Numformat nf = parseNumformat(format);
+	if (!nf.type.empty() && nf.type != "f" && nf.type != "F")
+		throw err::FormatException("Unknown type parameter \"" + nf.type + "\"",
+				format, nf.parsed_until - nf.type.length());
+	
+	if (nf.zero) {
+		nf.align = '=';
+		nf.fill = '0';
+	}
+	
+	return nf;
+}
+
+void appendDecimal(std::string& out, const ScaledDecimal& value, const Numformat& nf)
+{
+	unsigned scale = value.getScale();
+	if (scale > 19)
+		throw err::FormatException("The scale of a decimal can be at most 19");
+	
+	int64_t units = value.getUnits();
+	bool negative = units < 0;
+	uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(units)
+	                              : static_cast<uint64_t>(units);
+	
+	size_t max_decimals = nf.max_precision != -1 ? static_cast<size_t>(nf.max_precision) : scale;
+	size_t min_decimals = nf.min_precision != -1 ? static_cast<size_t>(nf.min_precision) : max_decimals;
+	
+	// Round away the digits beyond the precision, ties to even. The remainder
+	// is compared with its distance to the divisor, as twice the remainder
+	// could overflow.
+	size_t kept = scale;
+	if (max_decimals < scale) {
+		uint64_t divisor = POW10[scale - max_decimals];
+		uint64_t quotient = magnitude / divisor;
+		uint64_t remainder = magnitude % divisor;
+		uint64_t rest = divisor - remainder;
+		if (remainder > rest || (remainder == rest && (quotient & 1) != 0))
+			++quotient;
+		magnitude = quotient;
+		kept = max_decimals;
+	}
+	
+	// Precision beyond the scale adds zeros. With a range, trailing zeros are
+	// removed again down to the minimum.
+	size_t zeros = max_decimals > scale ? max_decimals - scale : 0;
+	while (kept + zeros > min_decimals) {
+		if (zeros > 0) {
+			--zeros;
+		} else if (kept > 0 && magnitude % 10 == 0) {
+			magnitude /= 10;
+			--kept;
+		} else {
+			break;
+		}
+	}
+	
+	// Digits with at least one before the point, e.g. 0.05
+	char digits[2 * maxDigits<10>()];
+	char raw[maxDigits<10>()];
+	size_t raw_count = writeDigits<10>(magnitude, raw);
+	size_t leading = raw_count <= kept ? kept + 1 - raw_count : 0;
+	std::memset(digits, '0', leading);
+	std::memcpy(digits + leading, raw, raw_count);
+	size_t integer_count = leading + raw_count - kept;
+	const char* fraction = digits + integer_count;
+	
+	// Sign, integer digits with separators, the point and the kept digits
+	char text[4 + 4 * maxDigits<10>()];
+	size_t length = 0;
+	if (negative)
+		text[length++] = '-';
+	else if (nf.sign == '+' || nf.sign == ' ')
+		text[length++] = nf.sign;
+	size_t center = length;
+	
+	bool point = kept + zeros > 0 || nf.alternate;
+	size_t fraction_length = (point ? 1 : 0) + kept + zeros;
+	size_t group = 0;
+	if (nf.grouping != '\0')
+		group = nf.group_size != -1 ? static_cast<size_t>(nf.group_size) : 3;
+	
+	if (group != 0 && nf.zero) {
+		// Zero padding is grouped as well, e.g. 000,012.50
+		size_t width = nf.width > 0 ? static_cast<size_t>(nf.width) : 0;
+		out.append(text, center);
+		appendGrouped(out, digits, integer_count, nf.grouping, group,
+				width > center + fraction_length ? width - center - fraction_length : 0);
+		if (point)
+			out += '.';
+		out.append(fraction, kept);
+		out.append(zeros, '0');
+		return;
+	}
+	
+	std::memcpy(text + length, digits, integer_count);
+	if (group != 0)
+		length += groupDigits(text + length, integer_count, nf.grouping, group);
+	else
+		length += integer_count;
+	if (point)
+		text[length++] = '.';
+	std::memcpy(text + length, fraction, kept);
+	length += kept;
+	
+	if (zeros == 0) {
+		appendPadded(out, text, length, nf, center, '>');
+	} else {
+		std::string padded(text, length);
+		padded.append(zeros, '0');
+		appendPadded(out, padded.data(), padded.length(), nf, center, '>');
+	}
+}
+
+} // namespace detail
+} // namespace fs
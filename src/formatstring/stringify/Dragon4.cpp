@@ -0,0 +1,117 @@
+// formatstring/stringify/Dragon4.cpp
+//
+// This file contains the Dragon4 algorithm by Steele and White with the
+// free-format termination of Burger and Dybvig ("Printing Floating-Point
+// Numbers Quickly and Accurately", PLDI 1996). It works on exact big integers,
+// which makes it slow but independent of the significand size.
+
+#include "formatstring/stringify/FloatToString.h"
+
+#include <cmath>
+
+#include "formatstring/stringify/IntToString.h"
+#include "formatstring/util/Bignum.h"
+
+
+namespace fs {
+namespace detail {
+
+decimal dragon4(fp v, int significand_bits, int32_t min_exponent)
+{
+	if (v.f == 0)
+		return {"0", 1, 0};
+	
+	// Denormals come shifted into the position of normal numbers
+	uint64_t f = v.f;
+	int32_t e = v.e;
+	if (e < min_exponent) {
+		f >>= min_exponent - e;
+		e = min_exponent;
+	}
+	
+	// The value is r / s, the distances to the neighbours are m_minus / s and
+	// m_plus / s. All are doubled so that the midpoints are integers. The gap
+	// below is half as large at powers of two, except for the smallest normal.
+	bool asymmetric = f == 1ull << (significand_bits - 1) && e > min_exponent;
+	bool accept_bounds = (f & 1) == 0;
+	Bignum r(f), s(1), m_minus(1);
+	r.shiftLeft(asymmetric ? 2 : 1);
+	s.shiftLeft(asymmetric ? 2 : 1);
+	if (e >= 0) {
+		r.shiftLeft(static_cast<size_t>(e));
+		m_minus.shiftLeft(static_cast<size_t>(e));
+	} else {
+		s.shiftLeft(static_cast<size_t>(-e));
+	}
+	Bignum m_plus = m_minus;
+	if (asymmetric)
+		m_plus.shiftLeft(1);
+	
+	// Estimate k with 10^(k-1) <= value < 10^k from the bit length. It may be
+	// one too small, which the comparisons below fix.
+	int32_t log2 = e + static_cast<int32_t>(significantBits(f)) - 1;
+	int32_t k = static_cast<int32_t>(std::floor(log2 * 0.30102999566398114)) + 1;
+	if (k >= 0) {
+		s.mulPow10(static_cast<unsigned>(k));
+	} else {
+		r.mulPow10(static_cast<unsigned>(-k));
+		m_minus.mulPow10(static_cast<unsigned>(-k));
+		m_plus.mulPow10(static_cast<unsigned>(-k));
+	}
+	
+	// The upper end of the interval decides whether the first digit is there
+	Bignum high;
+	int cmp;
+	for (;;) {
+		high = r;
+		high += m_plus;
+		cmp = Bignum::compare(high, s);
+		if (cmp < 0 || (cmp == 0 && !accept_bounds))
+			break;
+		s.mulSmall(10);
+		++k;
+	}
+	
+	decimal d;
+	d.length = 0;
+	for (;;) {
+		r.mulSmall(10);
+		m_minus.mulSmall(10);
+		m_plus.mulSmall(10);
+		
+		// The digit is at most 9, so subtracting is faster than dividing
+		char digit = '0';
+		while (Bignum::compare(r, s) >= 0) {
+			r -= s;
+			++digit;
+		}
+		
+		// Stop once the digits so far, or the next larger ones, are in the
+		// interval of values that round to v
+		cmp = Bignum::compare(r, m_minus);
+		bool low_ok = cmp < 0 || (cmp == 0 && accept_bounds);
+		high = r;
+		high += m_plus;
+		cmp = Bignum::compare(high, s);
+		bool high_ok = cmp > 0 || (cmp == 0 && accept_bounds);
+		
+		if (low_ok && high_ok) {
+			// Both are in, take the closer one with ties to even
+			Bignum twice = r;
+			twice.shiftLeft(1);
+			cmp = Bignum::compare(twice, s);
+			if (cmp > 0 || (cmp == 0 && (digit & 1) != 0))
+				++digit;
+		} else if (high_ok) {
+			++digit;
+		}
+		d.digits[d.length++] = digit;
+		if (low_ok || high_ok)
+			break;
+	}
+	d.exponent = k - d.length;
+	return d;
+}
+
+} // namespace detail
+} // namespace fs
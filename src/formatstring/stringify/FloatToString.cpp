@@ -5,10 +5,19 @@
 #include "formatstring/stringify/FloatToString.h"
 
 #include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "formatstring/QuickFormat.h"
 #include "formatstring/err/FormatException.h"
 #include "formatstring/stringify/FormatHelper.h"
+#include "formatstring/stringify/IntToString.h"
 #include "formatstring/util/Assert.h"
 
 
@@ -70,80 +79,447 @@ decomposition decomposeFloat(double f)
 	return {{f_ieee, e_ieee - 1023 - 52}, sign, special};
 }
 
+/** Whether long double is the x87 extended format with an explicit integer bit. */
+const bool X87_LONG_DOUBLE = std::numeric_limits<long double>::digits == 64
+		&& std::numeric_limits<long double>::max_exponent == 16384;
+
 decomposition decomposeFloat(long double f)
 {
-	// Maybe add special method in the future?
-	// For now it's too much effort for too little payoff.
-	return decomposeFloat(static_cast<double>(f));
+	// Other formats, like binary128 or double-double, don't fit the 64-bit
+	// significand and are printed with double precision
+	if (!X87_LONG_DOUBLE)
+		return decomposeFloat(static_cast<double>(f));
+	
+	// 64-bit significand, then 15-bit exponent and sign, little endian
+	uint64_t f_ieee;
+	uint16_t sign_exponent;
+	std::memcpy(&f_ieee, &f, sizeof(f_ieee));
+	std::memcpy(&sign_exponent, reinterpret_cast<const char*>(&f) + sizeof(f_ieee),
+			sizeof(sign_exponent));
+	
+	bool sign = (sign_exponent & 0x8000) != 0;
+	int32_t e_ieee = sign_exponent & 0x7fff;
+	
+	bool special = false;
+	if (e_ieee == 0x7fff) {
+		special = true;
+		f_ieee &= ~(1ull << 63); // Infinity has only the integer bit set
+	} else if (e_ieee == 0) {
+		if ((f_ieee >> 63) != 0)
+			e_ieee = 1; // Pseudo-denormal, read like the smallest normal
+		else
+			f_ieee <<= 1; // Denormal; shift into position of standard number
+	}
+	
+	return {{f_ieee, e_ieee - 16383 - 63}, sign, special};
+}
+
+/**
+ * Generates the shortest digits of a double. Ryu always finds them, Grisu2 is
+ * kept selectable for comparison.
+ */
+decimal shortestDigits(const fp& v, double)
+{
+#ifdef FORMATSTRING_GRISU2
+	return detail::grisu2(v);
+#else
+	return detail::ryu(v);
+#endif
+}
+
+decimal shortestDigits(const fp& v, float)
+{
+	return detail::ryuFloat(v);
+}
+
+decimal shortestDigits(const fp& v, long double)
+{
+	if (!X87_LONG_DOUBLE)
+		return shortestDigits(v, 0.0);
+	return detail::dragon4(v, 64, 1 - 16383 - 63);
+}
+
+/**
+ * Returns whether shortestDigits() gives the digits closest to the value among
+ * the shortest ones, which Grisu2 doesn't guarantee.
+ */
+bool closestDigits(double)
+{
+#ifdef FORMATSTRING_GRISU2
+	return false;
+#else
+	return true;
+#endif
+}
+
+bool closestDigits(float)
+{
+	return true;
+}
+
+bool closestDigits(long double)
+{
+	return X87_LONG_DOUBLE || closestDigits(0.0);
 }
 
 //------------------------------------------------------------------------------
 
+/**
+ * Buffer for the formatted text of a single value. It lives on the stack,
+ * which fits every double in fixed notation with grouping, unless an extreme
+ * width or precision needs more room.
+ */
+class TextBuffer
+{
+public:
+	explicit TextBuffer(size_t capacity)
+	{
+		if (capacity > sizeof(local_))
+			heap_.resize(capacity);
+		data_ = capacity > sizeof(local_) ? &heap_[0] : local_;
+	}
+	
+	char* data() { return data_; }
+
+private:
+	char local_[512];
+	std::string heap_;
+	char* data_;
+};
+
+/**
+ * Exact digits that don't fit a decimal. Like TextBuffer it lives on the
+ * stack, unless an extreme precision or exponent needs more room.
+ */
+class DigitBuffer
+{
+public:
+	/** Returns room for capacity digits and empties the buffer. */
+	char* reserve(size_t capacity)
+	{
+		if (capacity > sizeof(local_)) {
+			heap_.resize(capacity);
+			data_ = &heap_[0];
+		}
+		length_ = 0;
+		return data_;
+	}
+	
+	bool empty() const { return length_ == 0; }
+	char* data() { return data_; }
+	const char* data() const { return data_; }
+	void resize(size_t length) { length_ = length; }
+
+private:
+	char local_[512];
+	std::string heap_;
+	char* data_ = local_;
+	size_t length_ = 0;
+};
+
+/**
+ * Rounds the digits in place so that the least significant one has the given
+ * exponent. Returns whether the number of digits before or after the point
+ * changed because of a carry.
+ */
 bool roundDecimal(decimal& d, int lsd_exponent)
 {
-	bool changed_msd_or_lsd = false;
-	char last = '0';
-	while (lsd_exponent > d.exponent) {
-		last = d.digits.back();
-		d.digits.pop_back();
-		++d.exponent;
+	if (lsd_exponent <= d.exponent)
+		return false;
+	
+	int keep = d.length - (lsd_exponent - d.exponent);
+	bool up = keep >= 0 && d.digits[keep] >= '5';
+	d.length = std::max(keep, 0);
+	d.exponent = lsd_exponent;
+	
+	if (!up) {
+		if (d.length != 0)
+			return false;
+		d.digits[0] = '0';
+		d.length = 1;
+		d.exponent = 0;
+		return true;
 	}
-	if (last >= '5' && last <= '9')
-		++d.digits[d.digits.length() - 1];
-	while (d.digits.length() > 1 && d.digits[d.digits.length() - 1] == '9' + 1) {
-		d.digits.pop_back();
-		++d.digits[d.digits.length() - 1];
+	
+	// Nines carry over and disappear, e.g. 1299 -> 13
+	bool changed_msd_or_lsd = d.length == 0;
+	while (d.length > 0 && d.digits[d.length - 1] == '9') {
+		--d.length;
 		++d.exponent;
 		changed_msd_or_lsd = true;
 	}
-	if (d.digits.length() == 1 && d.digits[0] == '9' + 1) {
-		d.digits = "1";
-		++ d.exponent;
-		changed_msd_or_lsd = true;
+	if (d.length == 0) {
+		d.digits[0] = '1';
+		d.length = 1;
+	} else {
+		++d.digits[d.length - 1];
+	}
+	return changed_msd_or_lsd;
+}
+
+/**
+ * Returns whether v is an integer whose neighbours are at most 1 apart, so
+ * that its shortest digits are exact.
+ */
+bool isExactInteger(const fp& v)
+{
+	return v.e <= 0 && v.e > -64 && (v.f & ((1ull << -v.e) - 1)) == 0;
+}
+
+/** Writes the 9 digits of a value below 10^9, with leading zeros. */
+void writeChunk(uint32_t chunk, char* out)
+{
+	for (int i = 8; i >= 0; --i) {
+		out[i] = static_cast<char>('0' + chunk % 10);
+		chunk /= 10;
 	}
-	if (d.digits.length() == 0) {
-		d.digits = "0";
+}
+
+/**
+ * Computes the digits of the exact value v rounded half to even to a multiple
+ * of 10^lsd_exponent in a single pass over 32-bit limbs. An integer part
+ * wider than 64 bits is divided by 10^9, a fraction is multiplied by 10^9,
+ * nine digits at a time and only down to the digit that decides the rounding.
+ * The limbs of every float and double fit on the stack. Digits that don't fit
+ * d are stored in exact.
+ */
+void exactDigits(const fp& v, int lsd_exponent, decimal& d, DigitBuffer& exact)
+{
+	const uint64_t CHUNK = 1000000000;
+	int integer_bits = std::max(detail::significantBits(v.f) + v.e, 0);
+	int fraction_bits = std::max(-v.e, 0);
+	int fraction_digits = lsd_exponent <= 0 ? std::min(1 - lsd_exponent, fraction_bits) : 0;
+	
+	// log10(2) < 1234/4096, so this bounds the number of integer digits
+	size_t integer_digits = static_cast<size_t>(integer_bits) * 1234 / 4096 + 1;
+	size_t integer_chunks = (integer_digits + 8) / 9;
+	char* digits = exact.reserve(integer_bits > 64
+			? 9 * integer_chunks
+			: detail::maxDigits<10>() + static_cast<size_t>(fraction_digits) + 8);
+	
+	size_t limb_count = static_cast<size_t>(integer_bits > 64 ? integer_bits + 31
+	                                                          : fraction_bits + 31) / 32;
+	uint32_t local_limbs[36];
+	std::vector<uint32_t> heap_limbs;
+	uint32_t* limbs = local_limbs;
+	if (limb_count > sizeof(local_limbs) / sizeof(uint32_t)) {
+		heap_limbs.resize(limb_count);
+		limbs = heap_limbs.data();
+	}
+	
+	size_t length = 0;
+	int exponent = 0;
+	bool sticky = false;
+	if (integer_bits > 64) {
+		// Only integer digits, which come from the least significant end
+		std::fill(limbs, limbs + limb_count, 0);
+		size_t word = static_cast<size_t>(v.e / 32);
+		int shift = v.e % 32;
+		limbs[word] = static_cast<uint32_t>(v.f << shift);
+		if (word + 1 < limb_count)
+			limbs[word + 1] = static_cast<uint32_t>((v.f << shift) >> 32);
+		if (word + 2 < limb_count && shift != 0)
+			limbs[word + 2] = static_cast<uint32_t>(v.f >> (64 - shift));
+		
+		char* end = digits + 9 * integer_chunks;
+		char* begin = end;
+		while (limb_count != 0) {
+			uint64_t remainder = 0;
+			for (size_t i = limb_count; i-- > 0;) {
+				uint64_t current = remainder << 32 | limbs[i];
+				limbs[i] = static_cast<uint32_t>(current / CHUNK);
+				remainder = current % CHUNK;
+			}
+			while (limb_count != 0 && limbs[limb_count - 1] == 0)
+				--limb_count;
+			begin -= 9;
+			writeChunk(static_cast<uint32_t>(remainder), begin);
+		}
+		while (*begin == '0')
+			++begin;
+		length = static_cast<size_t>(end - begin);
+		std::memmove(digits, begin, length);
+	
+	} else {
+		uint64_t integer = v.e >= 0 ? v.f << v.e
+		                            : fraction_bits < 64 ? v.f >> fraction_bits : 0;
+		uint64_t fraction = fraction_bits == 0 ? 0
+		                  : fraction_bits < 64 ? v.f & ((1ull << fraction_bits) - 1) : v.f;
+		if (integer != 0)
+			length = detail::writeDigits<10>(integer, digits);
+		
+		if (fraction != 0) {
+			// Keep the binary point above the most significant limb, so that
+			// the carry out of each multiplication is the next nine digits
+			size_t shift = limb_count * 32 - static_cast<size_t>(fraction_bits);
+			std::fill(limbs, limbs + limb_count, 0);
+			limbs[0] = static_cast<uint32_t>(fraction << shift);
+			if (limb_count > 1)
+				limbs[1] = static_cast<uint32_t>((fraction << shift) >> 32);
+			if (limb_count > 2 && shift != 0)
+				limbs[2] = static_cast<uint32_t>(fraction >> (64 - shift));
+			
+			// Only limbs that are not 0 take part, leading zeros are cheap
+			size_t low = 0;
+			size_t high = std::min<size_t>(limb_count, 3);
+			while (limbs[high - 1] == 0)
+				--high;
+			for (int generated = 0; generated < fraction_digits && low != high; generated += 9) {
+				uint64_t carry = 0;
+				for (size_t i = low; i < high; ++i) {
+					uint64_t product = limbs[i] * CHUNK + carry;
+					limbs[i] = static_cast<uint32_t>(product);
+					carry = product >> 32;
+				}
+				if (high < limb_count) {
+					limbs[high] = static_cast<uint32_t>(carry);
+					high += carry != 0 ? 1 : 0;
+					carry = 0;
+				}
+				while (low != high && limbs[low] == 0)
+					++low;
+				
+				exponent -= 9;
+				if (length != 0) {
+					writeChunk(static_cast<uint32_t>(carry), digits + length);
+					length += 9;
+				} else if (carry != 0) {
+					length = detail::writeDigits<10>(carry, digits);
+				}
+			}
+			sticky = low != high;
+		}
+	}
+	
+	// Round half to even, digits beyond the rounding digit only count if not 0
+	int keep = static_cast<int>(length) - (lsd_exponent - exponent);
+	if (keep < static_cast<int>(length)) {
+		bool up = false;
+		if (keep >= 0 && digits[keep] >= '5') {
+			up = digits[keep] > '5' || sticky || (keep > 0 && (digits[keep - 1] & 1) != 0);
+			for (size_t i = static_cast<size_t>(keep) + 1; !up && i < length; ++i)
+				up = digits[i] != '0';
+		}
+		length = static_cast<size_t>(std::max(keep, 0));
+		exponent = lsd_exponent;
+		if (up) {
+			while (length > 0 && digits[length - 1] == '9') {
+				--length;
+				++exponent;
+			}
+			if (length == 0)
+				digits[length++] = '0';
+			++digits[length - 1];
+		}
+	}
+	if (length == 0) {
+		digits[length++] = '0';
+		exponent = lsd_exponent;
+	}
+	
+	d.length = static_cast<int>(length);
+	d.exponent = exponent;
+	if (length <= sizeof(d.digits)) {
+		std::copy(digits, digits + length, d.digits);
+		length = 0;
+	}
+	exact.resize(length);
+}
+
+/**
+ * Rounds the value to a multiple of 10^lsd_exponent, half to even. Rounding
+ * the closest shortest digits gives the same result as rounding the exact
+ * value, unless they end in exactly the 5 to be rounded off or more digits
+ * than the shortest ones are needed. Only then the exact digits are computed.
+ * Digits that don't fit d are stored in exact. Returns whether the number of
+ * digits before or after the point changed.
+ */
+bool roundValue(decimal& d, const fp& v, bool closest, int lsd_exponent,
+		DigitBuffer& exact)
+{
+	int keep = d.length - (lsd_exponent - d.exponent);
+	bool tie = keep == d.length - 1 && d.digits[keep] == '5';
+	bool needs_exact = lsd_exponent < d.exponent ? !isExactInteger(v)
+	                                             : tie || !closest;
+	if (v.f == 0 || !needs_exact)
+		return roundDecimal(d, lsd_exponent);
+	
+	exactDigits(v, lsd_exponent, d, exact);
+	
+	// Trailing zeros are dropped like after rounding the shortest digits, so
+	// that precision ranges can shorten the output
+	char* digits = exact.empty() ? d.digits : exact.data();
+	while (d.length > 1 && digits[d.length - 1] == '0') {
+		--d.length;
+		++d.exponent;
+	}
+	if (d.length == 1 && digits[0] == '0')
 		d.exponent = 0;
-		changed_msd_or_lsd = true;
+	if (!exact.empty())
+		exact.resize(static_cast<size_t>(d.length));
+	return true;
+}
+
+/**
+ * Returns the exponent of the most significant digit of v. The shortest digits
+ * of a value just below a power of ten can be that power, e.g. 1e23 for
+ * 99999999999999991611392, while precision counts the digits of the value.
+ */
+int msdExponent(const decimal& d, const fp& v)
+{
+	int msd_exponent = d.exponent + d.length - 1;
+	if (d.digits[0] != '1' || v.f == 0)
+		return msd_exponent;
+	for (int i = 1; i < d.length; ++i) {
+		if (d.digits[i] != '0')
+			return msd_exponent;
 	}
 	
-	return changed_msd_or_lsd;
+	// 22 digits are far more than any significand can get near the power
+	decimal exact_digits;
+	DigitBuffer exact;
+	exactDigits(v, msd_exponent - 21, exact_digits, exact);
+	return exact_digits.exponent + exact_digits.length - 1 < msd_exponent ? msd_exponent - 1
+	                                                                       : msd_exponent;
 }
 
-std::string specialToString(decomposition d, Numformat nf)
+void appendSpecial(std::string& out, decomposition d, const Numformat& nf)
 {
 	if (d.special && d.v.f == 0) {
-		std::string out;
+		char text[4];
+		size_t length = 0;
 		
 		// Output sign
 		if (d.sign) {
-			out += '-';
+			text[length++] = '-';
 		} else {
 			if (nf.sign == '+')
-				out += '+';
+				text[length++] = '+';
 			else if (nf.sign == ' ')
-				out += ' ';
+				text[length++] = ' ';
 		}
 		
-		size_t center = out.length();
-		out += "Inf";
-		
-		return padStringToWidth(out, nf, center, '>');
-		
-	} else if (d.special && d.v.f != 0) {
-		return padStringToWidth("NaN", nf);
+		size_t center = length;
+		text[length++] = 'I';
+		text[length++] = 'n';
+		text[length++] = 'f';
 		
+		appendPadded(out, text, length, nf, center, '>');
+	
 	} else {
-		assertmsg(d.special, "specialToString() called on normal float.");
-		return {};
+		assertmsg(d.special, "appendSpecial() called on normal float.");
+		appendPadded(out, "NaN", 3, nf);
 	}
 }
 
-std::string floatToFixed(decimal d, bool negative, const std::string& type, Numformat nf)
+void floatToFixed(std::string& out, const decomposition& value, bool closest,
+		decimal d, const std::string& type, const Numformat& nf)
 {
 	// Determine print boundaries and length
-	int num_digits = static_cast<int>(d.digits.length());
-	int msd_exponent = std::max(d.exponent + num_digits - 1, 0);
+	bool precise = nf.max_precision != -1 || nf.min_precision != -1;
+	int num_digits = d.length;
+	int msd_exponent = std::max(precise ? msdExponent(d, value.v)
+	                                    : d.exponent + num_digits - 1, 0);
 	int lsd_exponent = std::min(d.exponent, 0);
 	int round_lsd_exponent = lsd_exponent;
 	
@@ -168,10 +544,14 @@ std::string floatToFixed(decimal d, bool negative, const std::string& type, Numf
 	
 	assertmsg(lsd_exponent <= 0, "lsd_exp=" << lsd_exponent);
 	
-	// Round the number to the needed number of digits
-	if (roundDecimal(d, round_lsd_exponent)) {
+	// Round the number to the needed number of digits. Without precision the
+	// shortest digits are printed, with precision the exact value is rounded.
+	DigitBuffer exact;
+	if ((precise ? roundValue(d, value.v, closest, round_lsd_exponent, exact)
+	             : roundDecimal(d, round_lsd_exponent))
+			|| d.exponent + d.length - 1 > msd_exponent) {
 		// Readjust values on significant changes
-		int digits = static_cast<int>(d.digits.length());
+		int digits = d.length;
 		msd_exponent = std::max(digits + d.exponent - 1, msd_exponent);
 		
 		if (d.exponent > round_lsd_exponent) {
@@ -182,54 +562,82 @@ std::string floatToFixed(decimal d, bool negative, const std::string& type, Numf
 				else
 					max_lsd_exponent = msd_exponent + 1 - nf.min_precision;
 			}
-			lsd_exponent = std::min(max_lsd_exponent, d.exponent);
+			// Integer digits are always printed, even if rounded to zero
+			lsd_exponent = std::min({max_lsd_exponent, d.exponent, 0});
 		}
 	}
 	
 	//--------------------------------------------------------------------------
 	// Construct a string from the data
 	
+	Alignformat af = nf;
 	if (nf.zero) {
-		nf.align = '=';
-		nf.fill = '0';
+		af.align = '=';
+		af.fill = '0';
 	}
 	
-	std::string out;
+	const char* digits = exact.empty() ? d.digits : exact.data();
 	
 	// Output sign
-	if (negative) {
-		out += '-';
-	} else {
-		if (nf.sign == '+')
-			out += '+';
-		else if (nf.sign == ' ')
-			out += ' ';
+	char sign = '\0';
+	if (value.sign)
+		sign = '-';
+	else if (nf.sign == '+' || nf.sign == ' ')
+		sign = nf.sign;
+	
+	size_t center = sign != '\0' ? 1 : 0;
+	
+	// Determine the length of the output in advance
+	int group = 0;
+	if (nf.grouping != '\0')
+		group = nf.group_size != -1 ? nf.group_size : 3;
+	size_t fraction_length = lsd_exponent < 0 ? static_cast<size_t>(1 - lsd_exponent)
+	                                          : (nf.alternate ? 1 : 0);
+	auto length = [&]() {
+		size_t integer_digits = static_cast<size_t>(msd_exponent + 1);
+		return center + fraction_length + (group != 0
+				? groupedLength(integer_digits, static_cast<size_t>(group)) : integer_digits);
+	};
+	
+	// Zero padding is grouped as well, e.g. 0,001.5
+	if (group != 0 && nf.zero) {
+		while (static_cast<int>(length()) < nf.width)
+			++msd_exponent;
 	}
 	
-	size_t center = out.length();
+	TextBuffer text(length());
+	char* p = text.data();
+	if (sign != '\0')
+		*p++ = sign;
 	
 	// Output digits
 	for (int exp = msd_exponent; exp >= lsd_exponent; --exp) {
 		if (exp == -1)
-			out += '.';
+			*p++ = '.';
 		char c = '0';
-		int index = static_cast<int>(d.digits.length()) - exp - 1 + d.exponent;
-		if (index >= 0 && index < static_cast<int>(d.digits.length()))
-			c = d.digits[index];
-		out += c;
+		int index = d.length - exp - 1 + d.exponent;
+		if (index >= 0 && index < d.length)
+			c = digits[index];
+		*p++ = c;
+		if (group != 0 && exp > 0 && exp % group == 0)
+			*p++ = nf.grouping;
 	}
 	
 	if (nf.alternate && lsd_exponent >= 0)
-		out += '.';
+		*p++ = '.';
 	
-	return padStringToWidth(out, nf, center, '>');
+	size_t written = static_cast<size_t>(p - text.data());
+	assertmsg(written == length(), "written=" << written << ", length=" << length());
+	appendPadded(out, text.data(), written, af, center, '>');
 }
 
-std::string floatToScientific(decimal d, bool negative, const std::string& type, Numformat nf)
+void floatToScientific(std::string& out, const decomposition& value, bool closest,
+		decimal d, const std::string& type, const Numformat& nf)
 {
 	// Determine print boundaries and length
-	int num_digits = static_cast<int>(d.digits.length());
-	int msd_exponent = d.exponent + num_digits - 1;
+	bool precise = nf.max_precision != -1 || nf.min_precision != -1;
+	int num_digits = d.length;
+	int msd_exponent = precise ? msdExponent(d, value.v) : d.exponent + num_digits - 1;
 	int lsd_exponent = d.exponent;
 	
 	// Precision defines number of significant digits
@@ -239,9 +647,12 @@ std::string floatToScientific(decimal d, bool negative, const std::string& type,
 		lsd_exponent = std::min(lsd_exponent, msd_exponent + 1 - nf.min_precision);
 	
 	// Round the number to the needed number of digits
-	if (roundDecimal(d, lsd_exponent)) {
+	DigitBuffer exact;
+	if ((precise ? roundValue(d, value.v, closest, lsd_exponent, exact)
+	             : roundDecimal(d, lsd_exponent))
+			|| d.exponent + d.length - 1 > msd_exponent) {
 		// Readjust values on significant changes
-		int digits = static_cast<int>(d.digits.length());
+		int digits = d.length;
 		msd_exponent = std::max(digits + d.exponent - 1, msd_exponent);
 		
 		if (d.exponent > lsd_exponent) {
@@ -265,61 +676,74 @@ std::string floatToScientific(decimal d, bool negative, const std::string& type,
 	
 	//--------------------------------------------------------------------------
 	// Construct a string from the data
-	std::string out;
 	
+	Alignformat af = nf;
 	if (nf.zero) {
-		nf.align = '=';
-		nf.fill = '0';
+		af.align = '=';
+		af.fill = '0';
 	}
 	
+	const char* digits = exact.empty() ? d.digits : exact.data();
+	
 	// Output sign
-	if (negative) {
-		out += '-';
-	} else {
-		if (nf.sign == '+')
-			out += '+';
-		else if (nf.sign == ' ')
-			out += ' ';
-	}
+	char sign = '\0';
+	if (value.sign)
+		sign = '-';
+	else if (nf.sign == '+' || nf.sign == ' ')
+		sign = nf.sign;
 	
-	size_t center = out.length();
+	size_t center = sign != '\0' ? 1 : 0;
+	
+	// Integer digits of the mantissa are grouped relative to the exponent
+	int group = 0;
+	if (nf.grouping != '\0')
+		group = nf.group_size != -1 ? nf.group_size : 3;
+	
+	// Sign, digits with separators, points and an exponent like "e-1234"
+	size_t digit_count = static_cast<size_t>(msd_exponent - lsd_exponent + 1);
+	TextBuffer text(center + 2 * digit_count + 8);
+	char* p = text.data();
+	if (sign != '\0')
+		*p++ = sign;
 	
 	// Output digits
 	for (int exp = msd_exponent; exp >= lsd_exponent; --exp) {
 		if (exp == display_exponent - 1)
-			out += '.';
+			*p++ = '.';
 		char c = '0';
-		int index = static_cast<int>(d.digits.length()) - exp - 1 + d.exponent;
-		if (index >= 0 && index < static_cast<int>(d.digits.length()))
-			c = d.digits[index];
-		out += c;
+		int index = d.length - exp - 1 + d.exponent;
+		if (index >= 0 && index < d.length)
+			c = digits[index];
+		*p++ = c;
+		if (group != 0 && exp > display_exponent && (exp - display_exponent) % group == 0)
+			*p++ = nf.grouping;
 	}
 	
 	if (nf.alternate)
-		out += '.';
+		*p++ = '.';
 	
 	// Output exponent
 	bool done = false;
 	if (type == "si") {
 		done = true;
 		switch (display_exponent) {
-		case -24: out += 'y'; break;   // yocto = 10^-24
-		case -21: out += 'z'; break;   // zepto = 10^-21
-		case -18: out += 'a'; break;   // atto  = 10^-18
-		case -15: out += 'f'; break;   // femto = 10^-15
-		case -12: out += 'p'; break;   // pico  = 10^-12
-		case -9:  out += 'n'; break;   // nano  = 10^-9
-		case -6:  out += 'u'; break;   // micro = 10^-6
-		case -3:  out += 'm'; break;   // milli = 10^-3
+		case -24: *p++ = 'y'; break;   // yocto = 10^-24
+		case -21: *p++ = 'z'; break;   // zepto = 10^-21
+		case -18: *p++ = 'a'; break;   // atto  = 10^-18
+		case -15: *p++ = 'f'; break;   // femto = 10^-15
+		case -12: *p++ = 'p'; break;   // pico  = 10^-12
+		case -9:  *p++ = 'n'; break;   // nano  = 10^-9
+		case -6:  *p++ = 'u'; break;   // micro = 10^-6
+		case -3:  *p++ = 'm'; break;   // milli = 10^-3
 		case 0:   	          break;
-		case 3:   out += 'k'; break;   // kilo  = 10^3
-		case 6:   out += 'M'; break;   // mega  = 10^6
-		case 9:   out += 'G'; break;   // giga  = 10^9
-		case 12:  out += 'T'; break;   // tera  = 10^12
-		case 15:  out += 'P'; break;   // peta  = 10^15
-		case 18:  out += 'E'; break;   // exa   = 10^18
-		case 21:  out += 'Z'; break;   // zetta = 10^21
-		case 24:  out += 'Y'; break;   // yotta = 10^24
+		case 3:   *p++ = 'k'; break;   // kilo  = 10^3
+		case 6:   *p++ = 'M'; break;   // mega  = 10^6
+		case 9:   *p++ = 'G'; break;   // giga  = 10^9
+		case 12:  *p++ = 'T'; break;   // tera  = 10^12
+		case 15:  *p++ = 'P'; break;   // peta  = 10^15
+		case 18:  *p++ = 'E'; break;   // exa   = 10^18
+		case 21:  *p++ = 'Z'; break;   // zetta = 10^21
+		case 24:  *p++ = 'Y'; break;   // yotta = 10^24
 		default:
 			done = false;
 		}
@@ -327,17 +751,17 @@ std::string floatToScientific(decimal d, bool negative, const std::string& type,
 	
 	if (!done) {
 		if (isupper(nf.type[0]))
-			out += 'E';
+			*p++ = 'E';
 		else
-			out += 'e';
+			*p++ = 'e';
 		
 		// Output the exponent's value
 		bool exp_sign = display_exponent < 0;
 		if (exp_sign) {
-			out += '-';
+			*p++ = '-';
 			display_exponent = -display_exponent;
 		} else if (nf.sign == '+') {
-			out += '+';
+			*p++ = '+';
 		}
 		
 		bool printing = false;
@@ -349,60 +773,349 @@ std::string floatToScientific(decimal d, bool negative, const std::string& type,
 			if (digit != 0 || exponentMagnitude == 0)
 				printing = true;
 			if (printing)
-				out += static_cast<char>(digit + '0');
+				*p++ = static_cast<char>(digit + '0');
 		}
 		assertmsg(display_exponent == 0, "exponent=" << display_exponent);
 	}
 	
-	return padStringToWidth(out, nf, center, '>');
+	appendPadded(out, text.data(), static_cast<size_t>(p - text.data()), af, center, '>');
 }
 
-template <typename T>
-std::string floatToString(T value, const std::string& format)
+/** Returns the length of an exponent like "e-12" for the given format. */
+int exponentLength(int exponent, const Numformat& nf)
+{
+	int length = exponent < 0 || nf.sign == '+' ? 2 : 1;
+	exponent = std::abs(exponent);
+	do {
+		++length;
+		exponent /= 10;
+	} while (exponent != 0);
+	return length;
+}
+
+/**
+ * Appends the value with as many significant digits as fit into the width of
+ * the format, at most the shortest ones. Fixed notation is used unless
+ * scientific notation shows more digits. The notation and the precision are
+ * derived from the exponent of the shortest digits, only a carry when
+ * rounding (e.g. 9.96 to 10.0) can make the output wider than expected, which
+ * is then formatted again with one digit less. If the value doesn't fit at
+ * all, the shorter notation is used with a single digit.
+ */
+void floatToWidth(std::string& out, const decomposition& value, bool closest,
+		const decimal& d, const Numformat& nf)
+{
+	int width = nf.width;
+	int sign = value.sign || nf.sign == '+' || nf.sign == ' ' ? 1 : 0;
+	int msd_exponent = d.exponent + d.length - 1;
+	
+	// Fixed notation: integer digits with separators, then decimals after
+	// the point if there is room for at least one
+	int integer_digits = std::max(msd_exponent + 1, 1);
+	int integer_length = integer_digits;
+	if (nf.grouping != '\0')
+		integer_length = static_cast<int>(groupedLength(static_cast<size_t>(integer_digits),
+				static_cast<size_t>(nf.group_size != -1 ? nf.group_size : 3)));
+	int fixed_room = width - sign - integer_length;
+	int shortest_decimals = std::max(-d.exponent, 0);
+	int decimals = std::min(std::max(fixed_room - 1, 0), shortest_decimals);
+	int fixed_digits = fixed_room >= 0 ? msd_exponent + 1 + decimals : -1;
+	
+	// Scientific notation: one digit, or a point and more digits
+	int scientific_room = width - sign - exponentLength(msd_exponent, nf);
+	int precision = std::min(scientific_room >= 3 ? scientific_room - 1 : 1, d.length);
+	int scientific_digits = scientific_room >= 1 ? precision : -1;
+	
+	bool fixed = fixed_digits >= scientific_digits;
+	if (fixed_digits < 0 && scientific_digits < 0) {
+		// Nothing fits, take the shorter one
+		fixed = integer_length <= 1 + exponentLength(msd_exponent, nf);
+		decimals = 0;
+		precision = 1;
+	}
+	
+	Numformat f = nf;
+	f.min_precision = fixed ? 0 : 1;
+	for (;;) {
+		size_t begin = out.length();
+		if (fixed) {
+			f.type = "f";
+			f.max_precision = decimals;
+			if (decimals >= shortest_decimals)
+				f.min_precision = f.max_precision = -1;
+			floatToFixed(out, value, closest, d, "f", f);
+		} else {
+			f.type = isupper(nf.type[0]) ? "E" : "e";
+			f.max_precision = precision;
+			if (precision >= d.length)
+				f.min_precision = f.max_precision = -1;
+			floatToScientific(out, value, closest, d, "e", f);
+		}
+		
+		if (static_cast<int>(out.length() - begin) <= width
+				|| (fixed ? decimals == 0 : precision == 1))
+			break;
+		out.resize(begin);
+		if (fixed)
+			--decimals;
+		else
+			--precision;
+		f.min_precision = fixed ? 0 : 1;
+	}
+}
+
+namespace detail {
+
+Numformat parseFloatformat(const std::string& format)
 {
-	// Parse format parameters
 	Numformat nf = parseNumformat(format);
 	std::string type = nf.type;
 	std::transform(type.begin(), type.end(), type.begin(), tolower);
 	
-	if (!type.empty() && type != "g" && type != "e" && type != "f" && type != "ee" && type != "si")
+	if (!type.empty() && type != "g" && type != "e" && type != "f" && type != "ee" && type != "si"
+			&& type != "w")
 		throw err::FormatException("Unknown type parameter \"" + nf.type + "\"",
 				format, nf.parsed_until - nf.type.length());
+	if (type == "w" && nf.width <= 0)
+		throw err::FormatException("Type \"" + nf.type + "\" requires a width",
+				format, nf.parsed_until - nf.type.length());
+	if (type == "w" && (nf.max_precision != -1 || nf.min_precision != -1))
+		throw err::FormatException("Type \"" + nf.type + "\" can't have a precision",
+				format, nf.parsed_until - nf.type.length());
 	
-	// Check for special types
-	decomposition d = decomposeFloat(value);
-	if (d.special)
-		return specialToString(d, nf);
-	
-	// Generate digits
-	decimal dec = detail::grisu2(d.v);
-	
+	return nf;
+}
+
+} // namespace detail
+
+/** Returns the type of a parsed float format in lowercase. */
+std::string lowercaseType(const Numformat& nf)
+{
+	std::string type = nf.type;
+	std::transform(type.begin(), type.end(), type.begin(), tolower);
+	return type;
+}
+
+/**
+ * Appends a finite value whose digits are generated already. Without a type,
+ * values below 1e-3 or from 1e10 on are printed in scientific style.
+ */
+template <typename T>
+void formatDigits(std::string& out, T value, const decomposition& d, bool closest,
+		const decimal& dec, const std::string& type, const Numformat& nf)
+{
 	// Decide on fixed or scientific style
 	if (type == "e" || type == "ee" || type == "si") {
-		return floatToScientific(dec, d.sign, type, nf);
+		floatToScientific(out, d, closest, dec, type, nf);
 	} else if (type == "f") {
-		return floatToFixed(dec, d.sign, type, nf);
+		floatToFixed(out, d, closest, dec, type, nf);
+	} else if (type == "w") {
+		floatToWidth(out, d, closest, dec, nf);
 	} else {
 		if (value != 0 && (std::abs(value) < 1e-3 || std::abs(value) >= 1e10))
-			return floatToScientific(dec, d.sign, type, nf);
+			floatToScientific(out, d, closest, dec, type, nf);
 		else
-			return floatToFixed(dec, d.sign, type, nf);
+			floatToFixed(out, d, closest, dec, type, nf);
 	}
 }
 
+template <typename T>
+void formatFloat(std::string& out, T value, const Numformat& nf)
+{
+	// Check for special types
+	decomposition d = decomposeFloat(value);
+	if (d.special) {
+		appendSpecial(out, d, nf);
+		return;
+	}
+	
+	// Generate digits
+	decimal dec = shortestDigits(d.v, value);
+	formatDigits(out, value, d, closestDigits(value), dec, lowercaseType(nf), nf);
+}
+
+/** Number of values whose digits are generated in one go by formatDoubles(). */
+const size_t BLOCK_SIZE = 256;
+
+/** Number of values a thread formats at once in formatDoubles(). */
+const size_t SEGMENT_SIZE = 65536;
+
+/**
+ * Appends count values, each preceded by the separator unless it is the first
+ * value of the output. The values are decomposed and their digits generated
+ * block by block before any text is written, so that the digit generator
+ * keeps its tables in the cache.
+ */
+void formatDoubleRange(std::string& out, const double* values, size_t count,
+		bool first, const Numformat& nf, const std::string& type,
+		const std::string& separator)
+{
+	decomposition decompositions[BLOCK_SIZE];
+	decimal digits[BLOCK_SIZE];
+	bool closest = closestDigits(0.0);
+	
+	for (size_t begin = 0; begin < count; begin += BLOCK_SIZE) {
+		size_t size = std::min(BLOCK_SIZE, count - begin);
+		for (size_t i = 0; i < size; ++i) {
+			decompositions[i] = decomposeFloat(values[begin + i]);
+			if (!decompositions[i].special)
+				digits[i] = shortestDigits(decompositions[i].v, 0.0);
+		}
+		
+		for (size_t i = 0; i < size; ++i) {
+			if (!first || begin + i != 0)
+				out += separator;
+			if (decompositions[i].special)
+				appendSpecial(out, decompositions[i], nf);
+			else
+				formatDigits(out, values[begin + i], decompositions[i], closest,
+						digits[i], type, nf);
+		}
+	}
+}
+
+namespace detail {
+
+void appendFloat(std::string& out, float value, const Numformat& nf)
+{
+	formatFloat(out, value, nf);
+}
+
+void appendFloat(std::string& out, double value, const Numformat& nf)
+{
+	formatFloat(out, value, nf);
+}
+
+void appendFloat(std::string& out, long double value, const Numformat& nf)
+{
+	formatFloat(out, value, nf);
+}
+
+} // namespace detail
+
 std::string str(float value, const std::string& format)
 {
-	return floatToString(value, format);
+	std::string out;
+	formatFloat(out, value, detail::parseFloatformat(format));
+	return out;
 }
 
 std::string str(double value, const std::string& format)
 {
-	return floatToString(value, format);
+	std::string out;
+	formatFloat(out, value, detail::parseFloatformat(format));
+	return out;
 }
 
 std::string str(long double value, const std::string& format)
 {
-	return floatToString(value, format);
+	std::string out;
+	formatFloat(out, value, detail::parseFloatformat(format));
+	return out;
 }
+
+void formatDoubles(const double* values, size_t count, const std::string& format,
+		const Sink& sink, const std::string& separator, unsigned threads)
+{
+	Numformat nf = detail::parseFloatformat(format);
+	std::string type = lowercaseType(nf);
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	
+	size_t segments = (count + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+	size_t worker_count = std::min<size_t>(threads, segments);
+	auto formatSegment = [&](size_t segment, std::string& text) {
+		size_t begin = segment * SEGMENT_SIZE;
+		text.clear();
+		formatDoubleRange(text, values + begin, std::min(SEGMENT_SIZE, count - begin),
+				begin == 0, nf, type, separator);
+	};
+	
+	if (worker_count <= 1) {
+		std::string text;
+		for (size_t segment = 0; segment < segments; ++segment) {
+			formatSegment(segment, text);
+			sink(text.data(), text.length());
+		}
+		return;
+	}
+	
+	// Each worker formats every worker_count-th segment into its own text,
+	// which this thread passes to the sink in order before the worker reuses
+	// it. The first exception stops all threads and is rethrown after joining.
+	struct Slot {
+		std::string text;
+		bool ready;
+	};
+	std::vector<Slot> slots(worker_count, Slot{std::string(), false});
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::exception_ptr error;
+	bool stop = false;
+	auto fail = [&]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error)
+			error = std::current_exception();
+		stop = true;
+		changed.notify_all();
+	};
+	
+	auto work = [&](size_t worker) {
+		try {
+			Slot& slot = slots[worker];
+			for (size_t segment = worker; segment < segments; segment += worker_count) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [&] { return !slot.ready || stop; });
+					if (stop)
+						return;
+				}
+				formatSegment(segment, slot.text);
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.ready = true;
+				changed.notify_all();
+			}
+		} catch (...) {
+			fail();
+		}
+	};
+	
+	std::vector<std::thread> workers;
+	try {
+		for (size_t worker = 0; worker < worker_count; ++worker)
+			workers.emplace_back(work, worker);
+		for (size_t segment = 0; segment < segments; ++segment) {
+			Slot& slot = slots[segment % worker_count];
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return slot.ready || stop; });
+				if (stop)
+					break;
+			}
+			sink(slot.text.data(), slot.text.length());
+			std::lock_guard<std::mutex> lock(mutex);
+			slot.ready = false;
+			changed.notify_all();
+		}
+	} catch (...) {
+		fail();
+	}
 	
+	for (std::thread& worker: workers)
+		worker.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+std::string formatDoubles(const std::vector<double>& values, const std::string& format,
+		const std::string& separator, unsigned threads)
+{
+	std::string out;
+	formatDoubles(values.data(), values.size(), format,
+			[&out](const char* data, size_t length) {
+				out.append(data, length);
+			}, separator, threads);
+	return out;
+}
+
 } // namespace fs
@@ -7,7 +7,10 @@
 
 #include "formatstring/stringify/FormatHelper.h"
 
+#include <cstring>
+
 #include "formatstring/util/Assert.h"
+#include "formatstring/util/Utf8.h"
 
 namespace fs {
 
@@ -57,6 +60,25 @@ Numformat parseNumformat(const std::string& fmt)
 			}
 		}
 		
+		// Grouping
+		if (l > i && (fmt[i] == ',' || fmt[i] == '_')) {
+			nf.grouping = fmt[i];
+			if (l > ++i && isdigit(fmt[i])) {
+				size_t group_pos = i;
+				nf.group_size = 0;
+				while (l > i && isdigit(fmt[i])) {
+					nf.group_size = nf.group_size * 10 + fmt[i] - '0';
+					if (nf.group_size > 99)
+						throw err::FormatException("Group size must be at most 99",
+								fmt, group_pos);
+					++i;
+				}
+				if (nf.group_size == 0)
+					throw err::FormatException("Group size must be positive",
+							fmt, group_pos);
+			}
+		}
+		
 		// Precision
 		if (l > i && fmt[i] == '.') {
 			if (l > ++i && isdigit(fmt[i])) {
@@ -157,19 +179,23 @@ std::string readSingleQuotedString(const std::string& fmt, size_t& i)
 	return out;
 }
 
-std::string padStringToWidth(const std::string& source, const Alignformat& af,
-		size_t center, char default_align)
+namespace {
+
+/** Pads the source of the given length, which takes columns characters on screen. */
+void appendPaddedColumns(std::string& out, const char* source, size_t length,
+		size_t columns, const Alignformat& af, size_t center, char default_align)
 {
 	size_t width = static_cast<size_t>(af.width);
 	
-	if (af.width == -1 || source.length() >= width)
-		return source;
-	if (source.find('\n') != std::string::npos)
-		return source;
+	if (af.width == -1 || columns >= width ||
+			std::memchr(source, '\n', length) != nullptr) {
+		out.append(source, length);
+		return;
+	}
 	
-	size_t padding = width - source.length();
-	std::string out;
-	out.reserve(width);
+	size_t padding = width - columns;
+	size_t begin = out.length();
+	out.reserve(begin + width);
 	
 	char align = af.align;
 	if (align == '\0')
@@ -183,29 +209,115 @@ std::string padStringToWidth(const std::string& source, const Alignformat& af,
 		leading_pad = padding / 2;
 		padding -= leading_pad;
 	}
-	for (size_t i = 0; i < leading_pad; ++i)
-		out += af.fill;
+	out.append(leading_pad, af.fill);
 	
 	// Output string
 	if (align != '=') {
-		out += source;
+		out.append(source, length);
 	} else {
-		out.append(&source[0], center);
-		for (size_t i = 0; i < padding; ++i)
-			out += af.fill;
-		out.append(&source[center], source.length() - center);
+		out.append(source, center);
+		out.append(padding, af.fill);
+		out.append(source + center, length - center);
 	}
 	
 	// Output trailing padding if needed
-	if (align == '<' || align == '^') {
-		for (size_t i = 0; i < padding; ++i)
-			out += af.fill;
-	}
+	if (align == '<' || align == '^')
+		out.append(padding, af.fill);
 	
-	assertmsg(out.length() == width, "length is " << out.length() <<
-	        " but should be " << width << "\n\"" << out << '"');
+	assertmsg(out.length() - begin == length + width - columns, "length is "
+			<< out.length() - begin << " but should be " << length + width - columns
+			<< "\n\"" << out.substr(begin) << '"');
+}
+
+} // anonymous namespace
+
+std::string padStringToWidth(const std::string& source, const Alignformat& af,
+		size_t center, char default_align)
+{
+	if (af.width == -1)
+		return source;
+	
+	size_t columns = detail::displayWidth(source.data(), source.length());
+	if (columns >= static_cast<size_t>(af.width))
+		return source;
 	
+	std::string out;
+	appendPaddedColumns(out, source.data(), source.length(), columns, af, center,
+			default_align);
 	return out;
 }
 
+void padToWidth(std::string& out, size_t begin, const Alignformat& af,
+		char default_align)
+{
+	if (af.width == -1)
+		return;
+	
+	const char* text = out.data() + begin;
+	size_t length = out.length() - begin;
+	size_t width = static_cast<size_t>(af.width);
+	size_t columns = detail::displayWidth(text, length);
+	if (columns >= width || std::memchr(text, '\n', length) != nullptr)
+		return;
+	
+	size_t padding = width - columns;
+	char align = af.align == '\0' ? default_align : af.align;
+	size_t leading_pad = 0;
+	if (align == '>')
+		leading_pad = padding;
+	else if (align == '^')
+		leading_pad = padding / 2;
+	out.insert(begin, leading_pad, af.fill);
+	out.append(padding - leading_pad, af.fill);
+}
+
+void appendPadded(std::string& out, const char* source, size_t length,
+		const Alignformat& af, size_t center, char default_align)
+{
+	appendPaddedColumns(out, source, length, length, af, center, default_align);
+}
+
+size_t groupedLength(size_t count, size_t group)
+{
+	return count == 0 ? 0 : count + (count - 1) / group;
+}
+
+namespace {
+
+/**
+ * Writes the digits back to front, so that the output ends right before end.
+ * The last count digits are taken from digits, the ones before are zeros. As
+ * the output is never shorter than the input, both may overlap.
+ */
+void writeGroupedBackwards(char* end, const char* digits, size_t count,
+		size_t total, char separator, size_t group)
+{
+	for (size_t i = 0; i < total; ++i) {
+		if (i != 0 && i % group == 0)
+			*--end = separator;
+		*--end = i < count ? digits[count - 1 - i] : '0';
+	}
+}
+
+} // anonymous namespace
+
+size_t groupDigits(char* digits, size_t count, char separator, size_t group)
+{
+	size_t length = groupedLength(count, group);
+	writeGroupedBackwards(digits + length, digits, count, count, separator, group);
+	return length;
+}
+
+void appendGrouped(std::string& out, const char* digits, size_t count,
+		char separator, size_t group, size_t min_length)
+{
+	size_t total = count;
+	while (groupedLength(total, group) < min_length)
+		++total;
+	
+	size_t begin = out.length();
+	out.resize(begin + groupedLength(total, group));
+	writeGroupedBackwards(&out[0] + out.length(), digits, count, total, separator, group);
+}
+
 } // namespace fs
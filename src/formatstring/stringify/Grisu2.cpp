@@ -6,7 +6,6 @@
 
 #include "formatstring/stringify/FloatToString.h"
 
-#include <cmath>
 #include <formatstring/QuickFormat.h>
 
 #include "formatstring/util/Assert.h"
@@ -133,8 +132,9 @@ void compute_boundaries(const fp& v, fp& upper, fp& lower)
  */
 fp cached_power(int e_min, int& k)
 {
-	const double inverse_ld_10 = 0.30102999566398114; // = 1 / log_2(10)
-	int k_optimal = static_cast<int>(ceil((e_min + 64 - 1) * inverse_ld_10));
+	// ceil(x * log10(2)) with log10(2) ~ 78913 / 2^18, exact for |x| <= 1650
+	int x = e_min + 64 - 1;
+	int k_optimal = x > 0 ? ((x * 78913) >> 18) + 1 : -((-x * 78913) >> 18);
 	
 	const int first_cached_exp = -348;
 	
@@ -151,40 +151,44 @@ decimal generate_digits(fp M_up, uint64_t delta, int k)
 	fp one = {1ull << -M_up.e, M_up.e};
 	uint32_t part1 = static_cast<uint32_t>(M_up.f >> -M_up.e); // effectively div 2^-e_M_up
 	uint64_t part2 = M_up.f & (one.f - 1ull); // effectively mod 2^-e_M_up
-	std::string out;
+	decimal out;
+	out.length = 0;
 	
 	int kappa = 10;
 	uint32_t div = 1000000000;
 	
 	while (kappa > 0) {
 		int32_t d = part1 / div;
-		if (d > 0 || !out.empty())
-			out += static_cast<char>('0' + d);
+		if (d > 0 || out.length != 0)
+			out.digits[out.length++] = static_cast<char>('0' + d);
 		part1 %= div;
 		div /= 10;
 		--kappa;
-		if ((static_cast<uint64_t>(part1) << -one.e) + part2 <= delta)
-			return {out, kappa - k};
+		if ((static_cast<uint64_t>(part1) << -one.e) + part2 <= delta) {
+			out.exponent = kappa - k;
+			return out;
+		}
 	}
 	
 	do {
 		part2 *= 10;
 		int64_t d = part2 >> -one.e;
-		if (d > 0 || !out.empty())
-			out += static_cast<char>('0' + d);
+		if (d > 0 || out.length != 0)
+			out.digits[out.length++] = static_cast<char>('0' + d);
 		part2 &= (one.f - 1ull);
 		delta *= 10;
 		--kappa;
 		
 	} while (part2 > delta);
 	
-	return {out, kappa - k};
+	out.exponent = kappa - k;
+	return out;
 }
 
 decimal grisu2(fp v)
 {
 	if (v.f == 0)
-		return {"0", 0};
+		return {"0", 1, 0};
 	
 	fp m_up, m_low;
 	compute_boundaries(v, m_up, m_low);
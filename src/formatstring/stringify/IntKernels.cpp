@@ -0,0 +1,465 @@
+// formatstring/stringify/IntKernels.cpp
+//
+// Digit generation kernels for integers. Each kernel expands a whole 64-bit
+// value at once instead of looping digit by digit. SIMD versions are chosen at
+// runtime, portable scalar versions are used on all other platforms.
+
+#include "formatstring/stringify/IntToString.h"
+
+#include <cstring>
+
+#include "formatstring/util/Cpu.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+/** Writes the 8 bytes of v to out, most significant byte first. */
+inline void storeBigEndian(char* out, uint64_t v)
+{
+	for (int i = 0; i < 8; ++i)
+		out[i] = static_cast<char>(v >> (56 - 8 * i));
+}
+
+//------------------------------------------------------------------------------
+// Portable SWAR kernels
+
+/** Spreads the 8 nibbles of x into the 8 bytes of the result. */
+inline uint64_t spreadNibbles(uint32_t x)
+{
+	uint64_t v = x;
+	v = ((v & 0x00000000ffff0000ull) << 16) | (v & 0x000000000000ffffull);
+	v = ((v & 0x0000ff000000ff00ull) << 8)  | (v & 0x000000ff000000ffull);
+	v = ((v & 0x00f000f000f000f0ull) << 4)  | (v & 0x000f000f000f000full);
+	return v;
+}
+
+/** Turns 8 nibbles, one per byte, into 8 hex characters. */
+inline uint64_t nibblesToHex(uint64_t v, bool uppercase)
+{
+	const uint64_t ones = 0x0101010101010101ull;
+	// 0x01 in each byte holding a nibble greater than 9
+	uint64_t letters = ((v + 6 * ones) >> 4) & ones;
+	return v + '0' * ones + letters * (uppercase ? 'A' - '9' - 1 : 'a' - '9' - 1);
+}
+
+void hexScalar(uint64_t value, char* out, bool uppercase)
+{
+	storeBigEndian(out, nibblesToHex(spreadNibbles(
+			static_cast<uint32_t>(value >> 32)), uppercase));
+	storeBigEndian(out + 8, nibblesToHex(spreadNibbles(
+			static_cast<uint32_t>(value)), uppercase));
+}
+
+void binaryScalar(uint64_t value, char* out)
+{
+	for (int i = 0; i < 8; ++i) {
+		// Spread the 8 bits of one byte into the 8 bytes of v
+		uint64_t v = (value >> (56 - 8 * i)) & 0xff;
+		v = ((v & 0x00000000000000f0ull) << 28) | (v & 0x000000000000000full);
+		v = ((v & 0x0000000c0000000cull) << 14) | (v & 0x0000000300000003ull);
+		v = ((v & 0x0002000200020002ull) << 7)  | (v & 0x0001000100010001ull);
+		storeBigEndian(out + 8 * i, v + 0x3030303030303030ull);
+	}
+}
+
+/** Writes 8 octal digits for the lower 24 bits of x. */
+inline void octal8(uint32_t x, char* out)
+{
+	uint64_t v = x & 0xffffff;
+	v = ((v & 0x0000000000fff000ull) << 20) | (v & 0x0000000000000fffull);
+	v = ((v & 0x00000fc000000fc0ull) << 10) | (v & 0x0000003f0000003full);
+	v = ((v & 0x0038003800380038ull) << 5)  | (v & 0x0007000700070007ull);
+	storeBigEndian(out, v + 0x3030303030303030ull);
+}
+
+const char DIGIT_PAIRS[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233"
+		"34353637383940414243444546474849505152535455565758596061626364656667"
+		"68697071727374757677787980818283848586878889909192939495969798990";
+
+const uint64_t POW10[] = {
+		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+		10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+		100000000000ull, 1000000000000ull, 10000000000000ull,
+		100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+		100000000000000000ull, 1000000000000000000ull,
+		10000000000000000000ull
+};
+
+/** Returns the number of decimal digits in value, at least 1. */
+inline size_t decimalDigits(uint64_t value)
+{
+	// Approximate log10 from log2, then correct by one power table lookup
+	int log10 = significantBits(value) * 1233 >> 12;
+	if (value < POW10[log10])
+		return log10 == 0 ? 1 : static_cast<size_t>(log10);
+	return static_cast<size_t>(log10 + 1);
+}
+
+/** Writes exactly count digits of value to out, two digits at a time. */
+inline void digitPairs(uint64_t value, char* out, size_t count)
+{
+	char* end = out + count;
+	while (value >= 100) {
+		size_t pair = static_cast<size_t>(value % 100) * 2;
+		value /= 100;
+		end -= 2;
+		end[0] = DIGIT_PAIRS[pair];
+		end[1] = DIGIT_PAIRS[pair + 1];
+	}
+	if (value >= 10) {
+		end -= 2;
+		end[0] = DIGIT_PAIRS[value * 2];
+		end[1] = DIGIT_PAIRS[value * 2 + 1];
+	} else {
+		*--end = static_cast<char>('0' + value);
+	}
+	// Leading zeros, if count exceeds the number of digits
+	while (end > out)
+		*--end = '0';
+}
+
+size_t decimalScalar(uint64_t value, char* out)
+{
+	size_t count = decimalDigits(value);
+	digitPairs(value, out, count);
+	return count;
+}
+
+//------------------------------------------------------------------------------
+// x86 SIMD kernels
+
+#if FORMATSTRING_X86_SIMD
+
+/** Returns the 16 nibbles of value as bytes, most significant first. */
+FORMATSTRING_TARGET("sse2")
+inline __m128i nibblesSse2(uint64_t value)
+{
+	uint64_t swapped = __builtin_bswap64(value);
+	__m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&swapped));
+	__m128i mask = _mm_set1_epi8(0x0f);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+	__m128i lo = _mm_and_si128(x, mask);
+	return _mm_unpacklo_epi8(hi, lo);
+}
+
+FORMATSTRING_TARGET("sse2")
+void hexSse2(uint64_t value, char* out, bool uppercase)
+{
+	__m128i nibbles = nibblesSse2(value);
+	__m128i letters = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+	__m128i offset = _mm_and_si128(letters,
+			_mm_set1_epi8(uppercase ? 'A' - '9' - 1 : 'a' - '9' - 1));
+	__m128i chars = _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), offset);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+}
+
+FORMATSTRING_TARGET("ssse3")
+void hexSsse3(uint64_t value, char* out, bool uppercase)
+{
+	__m128i nibbles = nibblesSse2(value);
+	__m128i lookup = uppercase
+			? _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			                '8', '9', 'A', 'B', 'C', 'D', 'E', 'F')
+			: _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			                '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+			_mm_shuffle_epi8(lookup, nibbles));
+}
+
+FORMATSTRING_TARGET("sse2")
+void binarySse2(uint64_t value, char* out)
+{
+	const __m128i select = _mm_setr_epi8(
+			-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m128i zero = _mm_set1_epi8('0');
+	
+	for (int i = 0; i < 4; ++i) {
+		// Two bytes, each one repeated 8 times, the more significant first
+		unsigned bits = static_cast<unsigned>(value >> (48 - 16 * i)) & 0xffff;
+		__m128i x = _mm_cvtsi32_si128(static_cast<int>((bits >> 8) | (bits << 8)));
+		x = _mm_unpacklo_epi8(x, x);
+		x = _mm_unpacklo_epi16(x, x);
+		x = _mm_unpacklo_epi32(x, x);
+		__m128i set = _mm_cmpeq_epi8(_mm_and_si128(x, select), select);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * i),
+				_mm_sub_epi8(zero, set));
+	}
+}
+
+FORMATSTRING_TARGET("avx2")
+void binaryAvx2(uint64_t value, char* out)
+{
+	// Within each 128 bit lane, repeat each of two source bytes 8 times
+	const __m256i spread = _mm256_setr_epi8(
+			3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+			1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i select = _mm256_setr_epi8(
+			-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+			-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m256i zero = _mm256_set1_epi8('0');
+	
+	for (int i = 0; i < 2; ++i) {
+		int bits = static_cast<int>(value >> (32 - 32 * i));
+		__m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32(bits), spread);
+		__m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(x, select), select);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32 * i),
+				_mm256_sub_epi8(zero, set));
+	}
+}
+
+// Decimal conversion after "Converting integers to strings with SSE2" by
+// Wojciech Mula: a number below 10^8 is split into two halves of 4 digits,
+// which are then divided by 1000, 100, 10 and 1 in parallel 16-bit lanes
+// using multiplications with fixed reciprocals.
+
+/**
+ * Converts the value in the lowest 32 bit of x, which must be below 10^8, into
+ * its 8 digits as 16-bit integers.
+ */
+FORMATSTRING_TARGET("sse2")
+inline __m128i convert8DigitsSse2(__m128i x)
+{
+	// abcd, efgh = abcdefgh divmod 10000
+	__m128i abcd = _mm_srli_epi64(_mm_mul_epu32(x,
+			_mm_set1_epi32(static_cast<int>(0xd1b71759))), 45);
+	__m128i efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+	// [abcd * 4, efgh * 4], each repeated in four 16-bit lanes
+	__m128i v = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+	v = _mm_unpacklo_epi16(v, v);
+	v = _mm_unpacklo_epi32(v, v);
+	// [a, ab, abc, abcd, e, ef, efg, efgh]
+	v = _mm_mulhi_epu16(v, _mm_setr_epi16(
+			8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+	v = _mm_mulhi_epu16(v, _mm_setr_epi16(
+			1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768));
+	// [a, b, c, d, e, f, g, h]
+	return _mm_sub_epi16(v, _mm_slli_epi64(_mm_mullo_epi16(v, _mm_set1_epi16(10)), 16));
+}
+
+/** Same as convert8DigitsSse2(), but on both 128 bit lanes at once. */
+FORMATSTRING_TARGET("avx2")
+inline __m256i convert8DigitsAvx2(__m256i x)
+{
+	__m256i abcd = _mm256_srli_epi64(_mm256_mul_epu32(x,
+			_mm256_set1_epi32(static_cast<int>(0xd1b71759))), 45);
+	__m256i efgh = _mm256_sub_epi32(x, _mm256_mul_epu32(abcd, _mm256_set1_epi32(10000)));
+	__m256i v = _mm256_slli_epi64(_mm256_unpacklo_epi16(abcd, efgh), 2);
+	v = _mm256_unpacklo_epi16(v, v);
+	v = _mm256_unpacklo_epi32(v, v);
+	v = _mm256_mulhi_epu16(v, _mm256_setr_epi16(
+			8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768,
+			8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+	v = _mm256_mulhi_epu16(v, _mm256_setr_epi16(
+			1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768,
+			1 << 7, 1 << 11, 1 << 13, -32768, 1 << 7, 1 << 11, 1 << 13, -32768));
+	return _mm256_sub_epi16(v, _mm256_slli_epi64(_mm256_mullo_epi16(v, _mm256_set1_epi16(10)), 16));
+}
+
+/**
+ * Writes the digits above the lowest 16 to out and reduces value to those 16.
+ * Returns the number of digits written.
+ */
+inline size_t splitHighDigits(uint64_t& value, char* out, size_t count)
+{
+	if (count <= 16)
+		return 0;
+	digitPairs(value / POW10[16], out, count - 16);
+	value %= POW10[16];
+	return count - 16;
+}
+
+FORMATSTRING_TARGET("sse2")
+size_t decimalSse2(uint64_t value, char* out)
+{
+	// Short numbers are faster in scalar code
+	if (value < 100000000)
+		return decimalScalar(value, out);
+	
+	size_t count = decimalDigits(value);
+	size_t high = splitHighDigits(value, out, count);
+	
+	__m128i upper = convert8DigitsSse2(
+			_mm_cvtsi32_si128(static_cast<int>(value / 100000000)));
+	__m128i lower = convert8DigitsSse2(
+			_mm_cvtsi32_si128(static_cast<int>(value % 100000000)));
+	__m128i digits = _mm_add_epi8(_mm_packus_epi16(upper, lower),
+			_mm_set1_epi8('0'));
+	
+	char buffer[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(buffer), digits);
+	std::memcpy(out + high, buffer + 16 - (count - high), count - high);
+	return count;
+}
+
+FORMATSTRING_TARGET("avx2")
+size_t decimalAvx2(uint64_t value, char* out)
+{
+	if (value < 100000000)
+		return decimalScalar(value, out);
+	
+	size_t count = decimalDigits(value);
+	size_t high = splitHighDigits(value, out, count);
+	
+	// Both halves of 8 digits are converted at once, one in each lane
+	__m256i x = convert8DigitsAvx2(_mm256_setr_epi32(
+			static_cast<int>(value / 100000000), 0, 0, 0,
+			static_cast<int>(value % 100000000), 0, 0, 0));
+	__m256i packed = _mm256_permute4x64_epi64(
+			_mm256_packus_epi16(x, _mm256_setzero_si256()), 0x08);
+	__m128i digits = _mm_add_epi8(_mm256_castsi256_si128(packed),
+			_mm_set1_epi8('0'));
+	
+	char buffer[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(buffer), digits);
+	std::memcpy(out + high, buffer + 16 - (count - high), count - high);
+	return count;
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using DecimalKernel = size_t (*)(uint64_t, char*);
+using HexKernel = void (*)(uint64_t, char*, bool);
+using BinaryKernel = void (*)(uint64_t, char*);
+
+HexKernel selectHexKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasSsse3())
+		return hexSsse3;
+	if (cpu::hasSse2())
+		return hexSse2;
+#endif
+	return hexScalar;
+}
+
+DecimalKernel selectDecimalKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return decimalAvx2;
+	if (cpu::hasSse2())
+		return decimalSse2;
+#endif
+	return decimalScalar;
+}
+
+BinaryKernel selectBinaryKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return binaryAvx2;
+	if (cpu::hasSse2())
+		return binarySse2;
+#endif
+	return binaryScalar;
+}
+
+} // anonymous namespace
+
+
+template <>
+size_t writeDigits<10>(uint64_t value, char* out, bool)
+{
+	static const DecimalKernel kernel = selectDecimalKernel();
+	return kernel(value, out);
+}
+
+template <>
+size_t writeDigits<16>(uint64_t value, char* out, bool uppercase)
+{
+	static const HexKernel kernel = selectHexKernel();
+	
+	char buffer[16];
+	kernel(value, buffer, uppercase);
+	size_t count = static_cast<size_t>(significantBits(value) + 3) / 4;
+	std::memcpy(out, buffer + 16 - count, count);
+	return count;
+}
+
+template <>
+size_t writeDigits<2>(uint64_t value, char* out, bool)
+{
+	static const BinaryKernel kernel = selectBinaryKernel();
+	
+	char buffer[64];
+	kernel(value, buffer);
+	size_t count = static_cast<size_t>(significantBits(value));
+	std::memcpy(out, buffer + 64 - count, count);
+	return count;
+}
+
+template <>
+size_t writeDigits<8>(uint64_t value, char* out, bool)
+{
+	// Three groups of 8 digits each; the top group holds the remaining 16 bits
+	char buffer[24];
+	octal8(static_cast<uint32_t>(value >> 48), buffer);
+	octal8(static_cast<uint32_t>(value >> 24), buffer + 8);
+	octal8(static_cast<uint32_t>(value), buffer + 16);
+	size_t count = static_cast<size_t>(significantBits(value) + 2) / 3;
+	std::memcpy(out, buffer + 24 - count, count);
+	return count;
+}
+
+#ifdef __SIZEOF_INT128__
+
+namespace {
+
+/** Number of digits of the 64-bit chunks a 128-bit value is split into. */
+template <unsigned Base>
+constexpr size_t chunkDigits()
+{
+	return Base == 2 ? 64 : Base == 8 ? 21 : Base == 10 ? 19 : 16;
+}
+
+/** Base to the power of chunkDigits(). */
+template <unsigned Base>
+constexpr unsigned __int128 chunkDivisor()
+{
+	return Base == 10 ? static_cast<unsigned __int128>(10000000000000000000ull)
+	                  : static_cast<unsigned __int128>(1) << (Base == 8 ? 63 : 64);
+}
+
+} // anonymous namespace
+
+template <unsigned Base>
+size_t writeDigits(unsigned __int128 value, char* out, bool uppercase)
+{
+	constexpr unsigned __int128 divisor = chunkDivisor<Base>();
+	
+	// Split off full chunks, least significant first. At most three are needed
+	// for octal and decimal.
+	uint64_t chunks[3];
+	size_t count = 0;
+	while (value >= divisor) {
+		chunks[count++] = static_cast<uint64_t>(value % divisor);
+		value /= divisor;
+	}
+	
+	// The leading chunk only writes its significant digits, all others are
+	// filled up with zeros to the full chunk length
+	size_t length = writeDigits<Base>(static_cast<uint64_t>(value), out, uppercase);
+	while (count > 0) {
+		char buffer[maxDigits<Base>()];
+		size_t digits = writeDigits<Base>(chunks[--count], buffer, uppercase);
+		size_t zeros = chunkDigits<Base>() - digits;
+		std::memset(out + length, '0', zeros);
+		std::memcpy(out + length + zeros, buffer, digits);
+		length += chunkDigits<Base>();
+	}
+	return length;
+}
+
+template size_t writeDigits<2>(unsigned __int128, char*, bool);
+template size_t writeDigits<8>(unsigned __int128, char*, bool);
+template size_t writeDigits<10>(unsigned __int128, char*, bool);
+template size_t writeDigits<16>(unsigned __int128, char*, bool);
+
+#endif // __SIZEOF_INT128__
+
+} // namespace detail
+} // namespace fs
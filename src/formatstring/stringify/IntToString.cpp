@@ -4,104 +4,351 @@
 
 #include "formatstring/stringify/IntToString.h"
 
-#include <limits>
-#include <iostream>
-
 #include "formatstring/err/FormatException.h"
 #include "formatstring/stringify/FormatHelper.h"
-#include "formatstring/util/Assert.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace fs
 {
 
-template <typename T>
-std::string intToString(T value, const std::string& format)
+namespace detail {
+
+Numformat parseIntformat(const std::string& format)
 {
-	// Parse format parameter
 	Numformat nf = parseNumformat(format);
 	if (!nf.type.empty() && nf.type != "d" && nf.type != "x" && nf.type != "X"
-						 && nf.type != "o" && nf.type != "b")
+						 && nf.type != "o" && nf.type != "b"
+						 && nf.type != "si" && nf.type != "bi")
 		throw err::FormatException("Unknown type parameter \"" + nf.type + "\"",
 				format, nf.parsed_until - nf.type.length());
 	
-	// Generate digits
-	// Get unsigned type
-	using UT = typename std::make_unsigned<T>::type;
-	
-	// Define base and maximum number of digits
-	int base = 10;
-	int maxDigits = std::numeric_limits<UT>::digits10 + 1;
-	if (nf.type == "b") {
-		base = 2;
-		maxDigits = std::numeric_limits<UT>::digits;
-	} else if (nf.type == "o") {
-		base = 8;
-		maxDigits = std::numeric_limits<UT>::digits / 3;
-	} else if (nf.type == "x" || nf.type == "X") {
-		base = 16;
-		maxDigits = std::numeric_limits<UT>::digits / 4;
+	if (nf.zero) {
+		nf.align = '=';
+		nf.fill = '0';
 	}
 	
-	char digits[maxDigits];
+	return nf;
+}
+
+namespace {
+
+/** Character of the alternate base prefix, e.g. the "x" in "0x". */
+template <unsigned Base>
+constexpr char basePrefix()
+{
+	return Base == 2 ? 'b' : Base == 8 ? 'o' : 'x';
+}
+
+/**
+ * Formats a single value in a fixed base. All digit arithmetic of the kernel
+ * reduces to shifts, masks or multiplications with constant reciprocals.
+ */
+template <unsigned Base, typename U>
+void appendInteger(std::string& out, U absValue, bool negative,
+		const Numformat& nf)
+{
+	// Sign, base prefix and digits are collected in one buffer, with room for
+	// a separator after every digit
+	char buffer[3 + 2 * maxDigits<Base>() * (sizeof(U) / sizeof(uint64_t))];
+	size_t length = 0;
 	
-	// Define lookup
-	const char* lowercase_lookup = "0123456789abcdef";
-	const char* uppercase_lookup = "0123456789ABCDEF";
-	const char* lookup = nf.type == "X" ? uppercase_lookup : lowercase_lookup;
+	// Output sign
+	if (negative) {
+		buffer[length++] = '-';
+	} else {
+		if (nf.sign == '+')
+			buffer[length++] = '+';
+		else if (nf.sign == ' ')
+			buffer[length++] = ' ';
+	}
 	
-	// Check for negative values
-	bool negative = value < 0;
-	UT absValue = negative ? -value : value;
-	
-	// Fill the buffer from the end
-	int index = 0;
-	while (absValue > 0) {
-		int digit = absValue % base;
-		assertmsg(digit < base, "digit=" << digit << ", base=" << base);
-		absValue /= base;
-		
-		++index;
-		assertmsg(index <= maxDigits, "index=" << index << ", base" << base);
-		digits[maxDigits - index] = lookup[digit];
+	// Output base if needed
+	if (Base != 10 && nf.alternate) {
+		buffer[length++] = '0';
+		buffer[length++] = basePrefix<Base>();
 	}
 	
-	//--------------------------------------------------------------------------
-	// Construct a string from the data
-	std::string out;
+	size_t center = length;
 	
-	if (nf.zero) {
-		nf.align = '=';
-		nf.fill = '0';
+	// Output digits
+	bool uppercase = Base == 16 && nf.type[0] == 'X';
+	size_t count = writeDigits<Base>(absValue, buffer + length, uppercase);
+	
+	if (nf.grouping != '\0') {
+		size_t group = nf.group_size != -1 ? static_cast<size_t>(nf.group_size)
+		                                   : (Base == 10 ? 3 : 4);
+		if (nf.zero) {
+			// Zero padding is grouped as well, e.g. 0,001,234
+			size_t width = nf.width > 0 ? static_cast<size_t>(nf.width) : 0;
+			out.append(buffer, center);
+			appendGrouped(out, buffer + center, count, nf.grouping, group,
+					width > center ? width - center : 0);
+			return;
+		}
+		count = groupDigits(buffer + center, count, nf.grouping, group);
+	}
+	length += count;
+	
+	appendPadded(out, buffer, length, nf, center, '>');
+}
+
+const char* const SI_PREFIXES[] = {"", "k", "M", "G", "T", "P", "E", "Z", "Y"};
+const char* const IEC_PREFIXES[] = {"", "Ki", "Mi", "Gi", "Ti", "Pi", "Ei", "Zi", "Yi"};
+
+const uint64_t POW1000[] = {
+	1ull, 1000ull, 1000000ull, 1000000000ull, 1000000000000ull,
+	1000000000000000ull, 1000000000000000000ull
+};
+
+/** Largest prefix index that U can reach, E for 64 bits and Y for 128 bits. */
+template <typename U>
+constexpr unsigned maxPrefix()
+{
+	return sizeof(U) > sizeof(uint64_t) ? 8 : 6;
+}
+
+/** Returns 1000^k, which must fit into U. */
+template <typename U>
+U pow1000(unsigned k)
+{
+	return k <= 6 ? U(POW1000[k]) : U(POW1000[6]) * POW1000[k - 6];
+}
+
+/** Returns the number of significant bits of a 64- or 128-bit value. */
+template <typename U>
+int bitLength(U value)
+{
+	uint64_t high = static_cast<uint64_t>(value >> 32 >> 32);
+	return high != 0 ? 64 + significantBits(high)
+	                 : significantBits(static_cast<uint64_t>(value));
+}
+
+/**
+ * Writes the exact decimal digits of value / 1000^k or value / 1024^k to
+ * digits and returns their number. integer_digits receives the length of the
+ * integer part. Fractions of 1000^k have at most 3k digits, those of 1024^k at
+ * most 10k, so the buffer needs 40 + 10 * maxPrefix<U>() characters.
+ */
+template <typename U>
+size_t writeScaledDigits(U value, unsigned k, bool binary, char* digits,
+		size_t& integer_digits)
+{
+	U divisor = binary ? U(1) << (10 * k) : pow1000<U>(k);
+	U remainder = binary ? value & (divisor - 1) : value % divisor;
+	size_t length = writeDigits<10>(binary ? value >> (10 * k) : value / divisor, digits);
+	integer_digits = length;
+	
+	if (binary) {
+		// Each step shifts one decimal digit above the binary point
+		while (remainder != 0) {
+			remainder *= 10;
+			digits[length++] = static_cast<char>('0' + static_cast<unsigned>(remainder >> (10 * k)));
+			remainder &= divisor - 1;
+		}
+	} else if (remainder != 0) {
+		char buffer[maxDigits<10>() * 2];
+		size_t count = writeDigits<10>(remainder, buffer);
+		std::memset(digits + length, '0', 3 * k - count);
+		std::memcpy(digits + length + 3 * k - count, buffer, count);
+		length += 3 * k;
+	}
+	return length;
+}
+
+/** Returns the index of the first significant digit, the last one for 0. */
+size_t firstSignificant(const char* digits, size_t length)
+{
+	size_t first = 0;
+	while (first + 1 < length && digits[first] == '0')
+		++first;
+	return first;
+}
+
+/**
+ * Rounds the digits half-to-even to at most max_digits significant digits.
+ * Integer digits that are cut off are replaced by zeros. Returns the new
+ * length and updates integer_digits if the rounding carries into a new digit.
+ */
+size_t roundDigits(char* digits, size_t length, size_t& integer_digits,
+		size_t max_digits)
+{
+	size_t cut = firstSignificant(digits, length) + max_digits;
+	if (cut >= length)
+		return length;
+	
+	bool up = digits[cut] > '5';
+	if (digits[cut] == '5') {
+		up = (digits[cut - 1] - '0') % 2 == 1;
+		for (size_t i = cut + 1; i < length && !up; ++i)
+			up = digits[i] != '0';
+	}
+	
+	length = cut;
+	if (up) {
+		size_t i = cut;
+		while (i > 0 && digits[i - 1] == '9')
+			digits[--i] = '0';
+		if (i > 0) {
+			++digits[i - 1];
+		} else {
+			// All digits were nines, e.g. 999.7 -> 1000
+			std::memmove(digits + 1, digits, length);
+			digits[0] = '1';
+			++length;
+			++integer_digits;
+		}
+	}
+	
+	if (length < integer_digits) {
+		std::memset(digits + length, '0', integer_digits - length);
+		length = integer_digits;
+	}
+	return length;
+}
+
+/**
+ * Formats the value scaled by an SI (1000^k) or binary (1024^k) prefix. The
+ * prefix is chosen from the bit length or a table of powers and the digits
+ * are computed exactly with integer arithmetic. Without precision, SI values
+ * are printed exactly and binary values with up to 4 significant digits.
+ */
+template <typename U>
+void appendMagnitude(std::string& out, U absValue, bool negative,
+		const Numformat& nf, bool binary)
+{
+	unsigned k = 0;
+	if (binary) {
+		k = std::min(static_cast<unsigned>(bitLength(absValue) - 1) / 10, maxPrefix<U>());
+	} else {
+		while (k < maxPrefix<U>() && absValue >= pow1000<U>(k + 1))
+			++k;
 	}
 	
+	int max_precision = nf.max_precision != -1 ? nf.max_precision : (binary ? 4 : -1);
+	
+	char digits[40 + 10 * maxPrefix<U>()];
+	size_t integer_digits = 0;
+	size_t length = writeScaledDigits(absValue, k, binary, digits, integer_digits);
+	if (max_precision != -1)
+		length = roundDigits(digits, length, integer_digits,
+				static_cast<size_t>(std::max(max_precision, 1)));
+	
+	// Rounding may reach the next prefix, e.g. 999.96k -> 1.00M or
+	// 1023.96Ki -> 1.00Mi. The rounded value is then exactly 1 of that prefix,
+	// like the mantissa of the "e" format after its exponent is adjusted.
+	bool overflow = binary ? integer_digits > 4 ||
+	                         (integer_digits == 4 && std::memcmp(digits, "1024", 4) >= 0)
+	                       : integer_digits > 3;
+	if (overflow && k < maxPrefix<U>()) {
+		++k;
+		digits[0] = '1';
+		length = integer_digits = 1;
+	}
+	
+	// Trailing fraction zeros are only kept up to the minimum precision
+	size_t min_length = integer_digits;
+	if (nf.min_precision != -1)
+		min_length = std::max(min_length, firstSignificant(digits, length)
+				+ static_cast<size_t>(nf.min_precision));
+	while (length > min_length && digits[length - 1] == '0')
+		--length;
+	
+	std::string text;
+	
 	// Output sign
 	if (negative) {
-		out += '-';
+		text += '-';
 	} else {
 		if (nf.sign == '+')
-			out += '+';
+			text += '+';
 		else if (nf.sign == ' ')
-			out += ' ';
+			text += ' ';
 	}
 	
-	// Output base if needed
-	if (nf.alternate && base != 10) {
-		switch (base) {
-		case 2:  out += "0b"; break;
-		case 8:  out += "0o"; break;
-		case 16: out += "0x"; break;
-		}
+	size_t center = text.length();
+	
+	// Output digits
+	if (nf.grouping != '\0') {
+		size_t group = nf.group_size != -1 ? static_cast<size_t>(nf.group_size) : 3;
+		appendGrouped(text, digits, integer_digits, nf.grouping, group);
+	} else {
+		text.append(digits, integer_digits);
 	}
+	if (std::max(length, min_length) > integer_digits || nf.alternate)
+		text += '.';
+	text.append(digits + integer_digits, length - integer_digits);
+	if (min_length > length)
+		text.append(min_length - length, '0');
 	
-	size_t center = out.length();
+	// Output prefix
+	text += binary ? IEC_PREFIXES[k] : SI_PREFIXES[k];
 	
-	// Output digits
-	if (value == 0)
-		out += '0';
-	else
-		out.append(&digits[maxDigits - index], static_cast<size_t>(index));
+	appendPadded(out, text.data(), text.length(), nf, center, '>');
+}
+
+/** Selects the base from the parsed type once per value. */
+template <typename U>
+void appendInteger(std::string& out, U absValue, bool negative,
+		const Numformat& nf)
+{
+	if (nf.type.length() == 2) {
+		appendMagnitude(out, absValue, negative, nf, nf.type[0] == 'b');
+		return;
+	}
+	
+	switch (nf.type.empty() ? 'd' : nf.type[0]) {
+	case 'b': appendInteger<2>(out, absValue, negative, nf); break;
+	case 'o': appendInteger<8>(out, absValue, negative, nf); break;
+	case 'x':
+	case 'X': appendInteger<16>(out, absValue, negative, nf); break;
+	default:  appendInteger<10>(out, absValue, negative, nf); break;
+	}
+}
+
+} // anonymous namespace
+
+void appendInt(std::string& out, long long value, const Numformat& nf)
+{
+	bool negative = value < 0;
+	uint64_t absValue = static_cast<uint64_t>(value);
+	appendInteger(out, negative ? 0 - absValue : absValue, negative, nf);
+}
+
+void appendInt(std::string& out, unsigned long long value, const Numformat& nf)
+{
+	appendInteger(out, static_cast<uint64_t>(value), false, nf);
+}
+
+#ifdef __SIZEOF_INT128__
+
+void appendInt(std::string& out, __int128 value, const Numformat& nf)
+{
+	bool negative = value < 0;
+	unsigned __int128 absValue = static_cast<unsigned __int128>(value);
+	appendInteger(out, negative ? 0 - absValue : absValue, negative, nf);
+}
+
+void appendInt(std::string& out, unsigned __int128 value, const Numformat& nf)
+{
+	appendInteger(out, value, false, nf);
+}
+
+#endif // __SIZEOF_INT128__
+
+} // namespace detail
+
+template <typename T>
+std::string intToString(T value, const std::string& format)
+{
+	// Widen to the matching 64-bit type
+	using WT = typename std::conditional<std::is_signed<T>::value,
+			long long, unsigned long long>::type;
 	
-	return padStringToWidth(out, nf, center, '>');
+	std::string out;
+	detail::appendInt(out, static_cast<WT>(value), detail::parseIntformat(format));
+	return out;
 }
 
 
@@ -154,5 +401,25 @@ std::string str(unsigned long long value, const std::string& format)
 {
 	return intToString(value, format);
 }
-	
+
+#ifdef __SIZEOF_INT128__
+// std::is_signed is not specialized for 128-bit integers in strict ISO mode,
+// so they don't go through intToString()
+
+std::string str(__int128 value, const std::string& format)
+{
+	std::string out;
+	detail::appendInt(out, value, detail::parseIntformat(format));
+	return out;
+}
+
+std::string str(unsigned __int128 value, const std::string& format)
+{
+	std::string out;
+	detail::appendInt(out, value, detail::parseIntformat(format));
+	return out;
+}
+
+#endif // __SIZEOF_INT128__
+
 } // namespace fs
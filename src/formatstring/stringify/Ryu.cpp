@@ -0,0 +1,335 @@
+// formatstring/stringify/Ryu.cpp
+//
+// This file contains an implementation of the Ryu algorithm by Ulf Adams
+// ("Ryu: Fast Float-to-String Conversion", PLDI 2018), which turns doubles and
+// floats into their shortest decimal digits. Floats have their own variant with
+// a 32-bit significand, smaller tables and 64-bit multiplications.
+
+#include "formatstring/stringify/FloatToString.h"
+
+#include "formatstring/stringify/IntToString.h"
+#include "formatstring/stringify/RyuTables.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+/** Returns floor(log10(2^e)) for 0 <= e <= 1650. */
+inline uint32_t log10Pow2(int32_t e)
+{
+	return (static_cast<uint32_t>(e) * 78913) >> 18;
+}
+
+/** Returns floor(log10(5^e)) for 0 <= e <= 2620. */
+inline uint32_t log10Pow5(int32_t e)
+{
+	return (static_cast<uint32_t>(e) * 732923) >> 20;
+}
+
+/** Returns the bit length of 5^e for 0 <= e <= 3528. */
+inline int32_t pow5bits(int32_t e)
+{
+	return static_cast<int32_t>((static_cast<uint32_t>(e) * 1217359) >> 19) + 1;
+}
+
+/** Returns whether value is divisible by 5^p. */
+inline bool multipleOfPowerOf5(uint64_t value, uint32_t p)
+{
+	uint32_t count = 0;
+	while (value % 5 == 0) {
+		value /= 5;
+		++count;
+	}
+	return count >= p;
+}
+
+/** Returns whether value is divisible by 2^p. */
+inline bool multipleOfPowerOf2(uint64_t value, uint32_t p)
+{
+	return (value & ((1ull << p) - 1)) == 0;
+}
+
+/** Returns (m * mul) >> j for a 128-bit factor mul and 64 < j < 128. */
+inline uint64_t mulShift64(uint64_t m, const uint64_t* mul, int32_t j)
+{
+#ifdef __SIZEOF_INT128__
+	using uint128 = unsigned __int128;
+	uint128 low = static_cast<uint128>(m) * mul[0];
+	uint128 high = static_cast<uint128>(m) * mul[1];
+	return static_cast<uint64_t>(((low >> 64) + high) >> (j - 64));
+#else
+	// Products of the 32-bit halves
+	auto umul128 = [](uint64_t a, uint64_t b, uint64_t& high) {
+		uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+		uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+		uint64_t lo_lo = a_lo * b_lo;
+		uint64_t hi_lo = a_hi * b_lo;
+		uint64_t lo_hi = a_lo * b_hi;
+		uint64_t hi_hi = a_hi * b_hi;
+		uint64_t mid = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+		high = hi_hi + (hi_lo >> 32) + (mid >> 32);
+		return (mid << 32) | (lo_lo & 0xffffffff);
+	};
+	uint64_t high0, high1;
+	umul128(m, mul[0], high0);
+	uint64_t low1 = umul128(m, mul[1], high1);
+	uint64_t sum = high0 + low1;
+	if (sum < high0)
+		++high1;
+	int32_t shift = j - 64;
+	return (high1 << (64 - shift)) | (sum >> shift);
+#endif
+}
+
+/** Returns (m * factor) >> shift for a 64-bit factor and 32 < shift < 96. */
+inline uint32_t mulShift32(uint32_t m, uint64_t factor, int32_t shift)
+{
+	uint64_t low = static_cast<uint64_t>(m) * static_cast<uint32_t>(factor);
+	uint64_t high = static_cast<uint64_t>(m) * static_cast<uint32_t>(factor >> 32);
+	return static_cast<uint32_t>(((low >> 32) + high) >> (shift - 32));
+}
+
+} // anonymous namespace
+
+decimal ryu(fp v)
+{
+	if (v.f == 0)
+		return {"0", 1, 0};
+	
+	// Denormals come shifted into the position of normal numbers
+	uint64_t m2 = v.f;
+	int32_t e2 = v.e;
+	if (e2 < -1074) {
+		m2 >>= 1;
+		e2 = -1074;
+	}
+	
+	// The interval of values rounding to v is [mm, mp] in units of 2^(e2 - 2).
+	// It is asymmetric at powers of two, except for the smallest normal.
+	bool accept_bounds = (m2 & 1) == 0;
+	uint32_t mm_shift = m2 != (1ull << 52) || e2 <= -1074;
+	uint64_t mv = 4 * m2;
+	e2 -= 2;
+	
+	// Step 1: Scale mm, mv and mp by a power of ten so that they have only a
+	// few more digits than needed
+	uint64_t vr, vp, vm;
+	int32_t e10;
+	bool vm_trailing_zeros = false;
+	bool vr_trailing_zeros = false;
+	if (e2 >= 0) {
+		uint32_t q = log10Pow2(e2) - (e2 > 3);
+		e10 = static_cast<int32_t>(q);
+		int32_t k = POW5_INV_BITCOUNT + pow5bits(static_cast<int32_t>(q)) - 1;
+		int32_t i = -e2 + static_cast<int32_t>(q) + k;
+		vr = mulShift64(mv, POW5_INV_SPLIT[q], i);
+		vp = mulShift64(mv + 2, POW5_INV_SPLIT[q], i);
+		vm = mulShift64(mv - 1 - mm_shift, POW5_INV_SPLIT[q], i);
+		
+		// Only small values can be multiples of 5^q, see the paper
+		if (q <= 21) {
+			if (mv % 5 == 0)
+				vr_trailing_zeros = multipleOfPowerOf5(mv, q);
+			else if (accept_bounds)
+				vm_trailing_zeros = multipleOfPowerOf5(mv - 1 - mm_shift, q);
+			else
+				vp -= multipleOfPowerOf5(mv + 2, q);
+		}
+	} else {
+		uint32_t q = log10Pow5(-e2) - (-e2 > 1);
+		e10 = static_cast<int32_t>(q) + e2;
+		int32_t i = -e2 - static_cast<int32_t>(q);
+		int32_t k = pow5bits(i) - POW5_BITCOUNT;
+		int32_t j = static_cast<int32_t>(q) - k;
+		vr = mulShift64(mv, POW5_SPLIT[i], j);
+		vp = mulShift64(mv + 2, POW5_SPLIT[i], j);
+		vm = mulShift64(mv - 1 - mm_shift, POW5_SPLIT[i], j);
+		
+		if (q <= 1) {
+			// mv has at least q trailing zero bits, so vr has q trailing zeros
+			vr_trailing_zeros = true;
+			if (accept_bounds)
+				vm_trailing_zeros = mm_shift == 1;
+			else
+				--vp;
+		} else if (q < 63) {
+			vr_trailing_zeros = multipleOfPowerOf2(mv, q);
+		}
+	}
+	
+	// Step 2: Remove digits while the interval still contains a shorter
+	// number, tracking the removed digits for correct rounding
+	int32_t removed = 0;
+	uint64_t output;
+	if (vm_trailing_zeros || vr_trailing_zeros) {
+		// Rare case with exact boundaries
+		uint32_t last_removed = 0;
+		while (vp / 10 > vm / 10) {
+			vm_trailing_zeros &= vm % 10 == 0;
+			vr_trailing_zeros &= last_removed == 0;
+			last_removed = static_cast<uint32_t>(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		if (vm_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_trailing_zeros &= last_removed == 0;
+				last_removed = static_cast<uint32_t>(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				++removed;
+			}
+		}
+		// Exact ties round to even
+		if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+			last_removed = 4;
+		output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+				|| last_removed >= 5);
+	} else {
+		// Common case, only the last removed digit matters
+		bool round_up = false;
+		if (vp / 100 > vm / 100) {
+			round_up = vr % 100 >= 50;
+			vr /= 100;
+			vp /= 100;
+			vm /= 100;
+			removed += 2;
+		}
+		while (vp / 10 > vm / 10) {
+			round_up = vr % 10 >= 5;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		output = vr + (vr == vm || round_up);
+	}
+	
+	decimal d;
+	d.length = static_cast<int>(writeDigits<10>(output, d.digits));
+	d.exponent = e10 + removed;
+	return d;
+}
+
+decimal ryuFloat(fp v)
+{
+	if (v.f == 0)
+		return {"0", 1, 0};
+	
+	uint32_t m2 = static_cast<uint32_t>(v.f);
+	int32_t e2 = v.e;
+	if (e2 < -149) {
+		m2 >>= 1;
+		e2 = -149;
+	}
+	
+	bool accept_bounds = (m2 & 1) == 0;
+	uint32_t mm_shift = m2 != (1u << 23) || e2 <= -149;
+	uint32_t mv = 4 * m2;
+	e2 -= 2;
+	
+	// Step 1: Unlike for doubles, q is not reduced by one, so that the results
+	// fit 32 bits. The last removed digit is computed separately instead.
+	uint32_t vr, vp, vm;
+	int32_t e10;
+	bool vm_trailing_zeros = false;
+	bool vr_trailing_zeros = false;
+	uint32_t last_removed = 0;
+	if (e2 >= 0) {
+		uint32_t q = log10Pow2(e2);
+		e10 = static_cast<int32_t>(q);
+		int32_t k = FLOAT_POW5_INV_BITCOUNT + pow5bits(static_cast<int32_t>(q)) - 1;
+		int32_t i = -e2 + static_cast<int32_t>(q) + k;
+		vr = mulShift32(mv, FLOAT_POW5_INV_SPLIT[q], i);
+		vp = mulShift32(mv + 2, FLOAT_POW5_INV_SPLIT[q], i);
+		vm = mulShift32(mv - 1 - mm_shift, FLOAT_POW5_INV_SPLIT[q], i);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			int32_t l = FLOAT_POW5_INV_BITCOUNT + pow5bits(static_cast<int32_t>(q) - 1) - 1;
+			last_removed = mulShift32(mv, FLOAT_POW5_INV_SPLIT[q - 1],
+					-e2 + static_cast<int32_t>(q) - 1 + l) % 10;
+		}
+		
+		if (q <= 9) {
+			if (mv % 5 == 0)
+				vr_trailing_zeros = multipleOfPowerOf5(mv, q);
+			else if (accept_bounds)
+				vm_trailing_zeros = multipleOfPowerOf5(mv - 1 - mm_shift, q);
+			else
+				vp -= multipleOfPowerOf5(mv + 2, q);
+		}
+	} else {
+		uint32_t q = log10Pow5(-e2);
+		e10 = static_cast<int32_t>(q) + e2;
+		int32_t i = -e2 - static_cast<int32_t>(q);
+		int32_t k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+		int32_t j = static_cast<int32_t>(q) - k;
+		vr = mulShift32(mv, FLOAT_POW5_SPLIT[i], j);
+		vp = mulShift32(mv + 2, FLOAT_POW5_SPLIT[i], j);
+		vm = mulShift32(mv - 1 - mm_shift, FLOAT_POW5_SPLIT[i], j);
+		if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+			j = static_cast<int32_t>(q) - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+			last_removed = mulShift32(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+		}
+		
+		if (q <= 1) {
+			vr_trailing_zeros = true;
+			if (accept_bounds)
+				vm_trailing_zeros = mm_shift == 1;
+			else
+				--vp;
+		} else if (q < 31) {
+			vr_trailing_zeros = multipleOfPowerOf2(mv, q - 1);
+		}
+	}
+	
+	// Step 2: Remove digits as for doubles
+	int32_t removed = 0;
+	uint32_t output;
+	if (vm_trailing_zeros || vr_trailing_zeros) {
+		while (vp / 10 > vm / 10) {
+			vm_trailing_zeros &= vm % 10 == 0;
+			vr_trailing_zeros &= last_removed == 0;
+			last_removed = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		if (vm_trailing_zeros) {
+			while (vm % 10 == 0) {
+				vr_trailing_zeros &= last_removed == 0;
+				last_removed = vr % 10;
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				++removed;
+			}
+		}
+		if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+			last_removed = 4;
+		output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros))
+				|| last_removed >= 5);
+	} else {
+		while (vp / 10 > vm / 10) {
+			last_removed = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			++removed;
+		}
+		output = vr + (vr == vm || last_removed >= 5);
+	}
+	
+	decimal d;
+	d.length = static_cast<int>(writeDigits<10>(static_cast<uint64_t>(output), d.digits));
+	d.exponent = e10 + removed;
+	return d;
+}
+
+} // namespace detail
+} // namespace fs
@@ -4,10 +4,17 @@
 
 #include "formatstring/stringify/StringToString.h"
 
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 #include <vector>
 #include <formatstring/err/FormatException.h>
 
 #include "formatstring/stringify/FormatHelper.h"
+#include "formatstring/util/Escape.h"
+#include "formatstring/util/Replacer.h"
+#include "formatstring/util/TextTransform.h"
+#include "formatstring/util/Utf8.h"
 
 
 namespace fs {
@@ -16,7 +23,10 @@ struct Stringformat: Alignformat {
 	bool truncate {false};
 	int substring_begin {-1};
 	int substring_end {-1};
-	std::vector<std::pair<std::string, std::string>> replacements {};
+	bool trim {false};
+	char letter_case {'\0'};
+	detail::Replacer replacer {};
+	char escape {'\0'};
 };
 
 Stringformat parseStringFormat(const std::string& fmt) {
@@ -86,9 +96,26 @@ Stringformat parseStringFormat(const std::string& fmt) {
 			}
 		}
 		
-		// Replacement
 		while (l > i && fmt[i] == ' ') ++i;
 		
+		// Transforms
+		while (l > i && (fmt[i] == 't' || fmt[i] == 'u' || fmt[i] == 'l')) {
+			if (fmt[i] == 't')
+				sf.trim = true;
+			else
+				sf.letter_case = fmt[i];
+			++i;
+			while (l > i && fmt[i] == ' ') ++i;
+		}
+		
+		// Replacement
+		bool at_once = l > i && fmt[i] == 'm';
+		if (at_once) {
+			++i;
+			while (l > i && fmt[i] == ' ') ++i;
+		}
+		
+		std::vector<detail::Replacer::Rule> replacements;
 		while (l > i && fmt[i] == 'r') {
 			++i;
 			std::string find = readSingleQuotedString(fmt, i);
@@ -97,80 +124,253 @@ Stringformat parseStringFormat(const std::string& fmt) {
 						fmt, i);
 			++i;
 			std::string replace = readSingleQuotedString(fmt, i);
-			sf.replacements.emplace_back(find, replace);
+			replacements.emplace_back(find, replace);
 			
 			while (l > i && fmt[i] == ' ') ++i;
 		}
+		sf.replacer = detail::Replacer(replacements, at_once);
+		
+		// Escaping
+		if (l > i && fmt[i] == 'e') {
+			++i;
+			if (l == i || !detail::isEscapeMode(fmt[i]))
+				throw err::FormatException("Unknown escape mode", fmt, i);
+			sf.escape = fmt[i];
+			++i;
+		}
 	}
 	
 	return sf;
 }
 
-std::string replace(
-		std::string value, const std::string& find, const std::string& replace)
+/**
+ * Returns the parsed format, which is cached per thread, so that the
+ * replacement rules of a format used repeatedly are only compiled once.
+ */
+const Stringformat& cachedStringFormat(const std::string& fmt)
 {
-	std::string out;
-	size_t i;
+	thread_local std::unordered_map<std::string, Stringformat> formats;
+	auto found = formats.find(fmt);
+	if (found != formats.end())
+		return found->second;
 	
-	for (i = 0; i <= value.length() - find.length(); ++i) {
-		if (value[i] == find[0]) {
-			if (value.compare(i, find.length(), find) == 0) {
-				out += replace;
-				i += find.length() - 1;
-			} else {
-				out += value[i];
-			}
-			
-		} else {
-			out += value[i];
+	Stringformat sf = parseStringFormat(fmt);
+	if (formats.size() >= 64)
+		formats.clear();
+	return formats.emplace(fmt, std::move(sf)).first->second;
+}
+
+namespace {
+
+/** Size of the pieces that long strings are formatted in. */
+const size_t PIECE_SIZE = 64 * 1024;
+
+/**
+ * Applies the steps of the string format after the replacements to the
+ * pieces of a string, which must not cut UTF-8 sequences, and appends the
+ * result to out. A sink without out only counts the length of the result.
+ */
+class StringSink
+{
+public:
+	StringSink(std::string& out, const Stringformat& sf):
+			out_(&out), sf_(sf), start_(out.length()) {}
+	
+	explicit StringSink(const Stringformat& sf):
+			out_(nullptr), sf_(sf), start_(0) {}
+	
+	/** Returns whether the string has been truncated, so that no more pieces are needed. */
+	bool full() const { return full_; }
+	
+	/** Returns the counted length, without the quotes of a CSV value. */
+	size_t length() const { return length_; }
+	
+	/** Returns whether the counted CSV value needs quotes. */
+	bool quoted() const { return quote_; }
+	
+	/** Adds the opening quote of a CSV value, before any piece is written. */
+	void quote();
+	
+	void write(const char* begin, const char* end);
+	
+	/** Adds the closing quote of a CSV value and the padding. */
+	void finish();
+
+private:
+	std::string* out_;
+	const Stringformat& sf_;
+	size_t start_;        // Of the formatted string in out_
+	size_t columns_ = 0;  // Taken by the pieces so far
+	size_t length_ = 0;   // Counted so far
+	bool full_ = false;
+	bool quote_ = false;  // Whether the CSV value needs quotes
+	std::string mapped_;
+};
+
+void StringSink::quote()
+{
+	*out_ += '"';
+	quote_ = true;
+}
+
+void StringSink::write(const char* begin, const char* end)
+{
+	// Truncation without cutting characters, a wide one that doesn't fit is
+	// replaced by padding
+	if (sf_.width != -1) {
+		size_t length = static_cast<size_t>(end - begin);
+		size_t fit = detail::fitToWidth(begin, length, static_cast<size_t>(sf_.width) - columns_);
+		end = begin + fit;
+		if (fit < length)
+			full_ = true;
+		else
+			columns_ += detail::displayWidth(begin, fit);
+	}
+	
+	// Case mapping
+	if (sf_.letter_case != '\0') {
+		if (sf_.escape == '\0' && out_ != nullptr) {
+			detail::appendCaseMapped(*out_, begin, end, sf_.letter_case);
+			return;
 		}
+		mapped_.clear();
+		detail::appendCaseMapped(mapped_, begin, end, sf_.letter_case);
+		begin = mapped_.data();
+		end = begin + mapped_.length();
 	}
 	
-	out.append(&value[i], value.length() - i);
+	// Escaping comes last, so that no escape sequence is cut off
+	if (out_ == nullptr)
+		length_ += sf_.escape == '\0' ? static_cast<size_t>(end - begin)
+				: detail::escapedPieceLength(begin, end, sf_.escape, quote_);
+	else if (sf_.escape == '\0')
+		out_->append(begin, end);
+	else
+		detail::appendEscapedPiece(*out_, begin, end, sf_.escape);
+}
+
+void StringSink::finish()
+{
+	if (quote_)
+		*out_ += '"';
 	
-	return out;
+	padToWidth(*out_, start_, sf_);
 }
 
-std::string str_string(const std::string& value, const std::string& format)
+/**
+ * Writes the text to the sink piece by piece, so that none of the steps
+ * copies the whole string. If replace is set, the replacements are applied
+ * on the way.
+ */
+void writePieces(StringSink& sink, const char* begin, const char* end,
+		const Stringformat& sf, bool replace)
 {
-	if (format.empty())
-		return value;
+	if (!replace) {
+		while (begin != end && !sink.full()) {
+			size_t piece = static_cast<size_t>(end - begin);
+			if (piece > PIECE_SIZE)
+				piece = detail::completeLength(begin, PIECE_SIZE);
+			sink.write(begin, begin + piece);
+			begin += piece;
+		}
+		return;
+	}
 	
-	Stringformat sf = parseStringFormat(format);
+	// The replaced text of a piece can end within a UTF-8 sequence, whose
+	// beginning is then kept for the next piece
+	detail::Replacer::Stream stream(sf.replacer);
+	std::string replaced;
+	while (begin != end && !sink.full()) {
+		const char* piece_end = begin + std::min(static_cast<size_t>(end - begin), PIECE_SIZE);
+		stream.write(begin, piece_end, replaced);
+		size_t complete = detail::completeLength(replaced.data(), replaced.length());
+		sink.write(replaced.data(), replaced.data() + complete);
+		replaced.erase(0, complete);
+		begin = piece_end;
+	}
+	if (!sink.full()) {
+		stream.finish(replaced);
+		sink.write(replaced.data(), replaced.data() + replaced.length());
+	}
+}
+
+} // anonymous namespace
+
+void appendString(std::string& out, const char* value, size_t length,
+		const std::string& format)
+{
+	if (format.empty()) {
+		out.append(value, length);
+		return;
+	}
 	
-	std::string out;
+	const Stringformat& sf = cachedStringFormat(format);
 	
-	// Substring
-	if (!value.empty() && sf.substring_begin != -1) {
-		if (static_cast<size_t>(sf.substring_begin) < value.length()) {
-			if (sf.substring_end == -1)
-				out = value.substr(static_cast<size_t>(sf.substring_begin),
-						static_cast<size_t>(value.length() - sf.substring_begin));
-			else
-				out = value.substr(static_cast<size_t>(sf.substring_begin),
-						static_cast<size_t>(sf.substring_end - sf.substring_begin));
-		}
-	} else {
-		out = value;
+	// Substring, the indices count code points
+	const char* begin = value;
+	const char* end = begin + length;
+	if (sf.substring_begin != -1) {
+		begin += detail::codePointOffset(begin, length,
+				static_cast<size_t>(sf.substring_begin));
+		if (sf.substring_end != -1)
+			end = begin + detail::codePointOffset(begin, static_cast<size_t>(end - begin),
+					static_cast<size_t>(sf.substring_end - sf.substring_begin));
 	}
 	
-	// Replacement
-	if (!out.empty() && !sf.replacements.empty()) {
-		for (auto replacement: sf.replacements)
-			out = replace(out, replacement.first, replacement.second);
+	if (sf.trim)
+		detail::trimSpace(begin, end);
+	
+	// Short strings are replaced as a whole, long ones piece by piece
+	size_t text_length = static_cast<size_t>(end - begin);
+	bool replace = !sf.replacer.empty();
+	std::string replaced;
+	if (replace && text_length <= PIECE_SIZE) {
+		sf.replacer.apply(begin, end, replaced);
+		begin = replaced.data();
+		end = begin + replaced.length();
+		replace = false;
 	}
 	
-	// Truncation or padding
-	if (sf.width != -1 && out.length() > static_cast<size_t>(sf.width)) {
-		return out.substr(0, static_cast<size_t>(sf.width));
-	} else {
-		return padStringToWidth(out, sf);
+	// Escaping, case mapping and replacements can make the result longer than
+	// the text. A long text is then formatted twice, first only to count the
+	// length of the result, so that out grows just once and takes no more
+	// memory than the result. Whether a CSV value needs quotes is counted as
+	// well, as the opening one is written first.
+	size_t width = sf.width == -1 ? 0 : static_cast<size_t>(sf.width);
+	bool grows = sf.escape != '\0' || sf.letter_case != '\0' || sf.replacer.canGrow();
+	StringSink sink(out, sf);
+	if (sf.escape == 'c' || (grows && text_length > PIECE_SIZE)) {
+		StringSink counter(sf);
+		writePieces(counter, begin, end, sf, replace);
+		size_t result_length = counter.length() + (counter.quoted() ? 2 : 0);
+		out.reserve(out.length() + std::max(result_length, width));
+		if (counter.quoted())
+			sink.quote();
+	} else if (sf.width == -1 && text_length > PIECE_SIZE) {
+		out.reserve(out.length() + text_length);
+	} else if (text_length < width) {
+		out.reserve(out.length() + width);
 	}
+	
+	writePieces(sink, begin, end, sf, replace);
+	sink.finish();
+}
+
+std::string str_string(const std::string& value, const std::string& format)
+{
+	if (format.empty())
+		return value;
+	
+	std::string out;
+	appendString(out, value.data(), value.length(), format);
+	return out;
 }
 
 std::string str(const char* value, const std::string& format)
 {
-	return str_string(value, format);
+	std::string out;
+	appendString(out, value, std::strlen(value), format);
+	return out;
 }
 
 std::string str(unsigned char, const std::string&);
@@ -181,7 +381,9 @@ std::string str(char value, const std::string& format)
 		return str(static_cast<unsigned char>(value), format.substr(1));
 	}
 	
-	return str_string(std::string(1, value), format);
+	std::string out;
+	appendString(out, &value, 1, format);
+	return out;
 }
 
 } // namespace fs
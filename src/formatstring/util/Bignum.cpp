@@ -0,0 +1,465 @@
+// formatstring/util/Bignum.cpp
+//
+// Arithmetic and decimal conversion of the internal arbitrary-precision
+// integer.
+
+#include "formatstring/util/Bignum.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "formatstring/stringify/IntToString.h"
+#include "formatstring/util/Assert.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+// Decimal digits written per 32-bit division in the base case
+const uint32_t CHUNK_DIVISOR = 1000000000;
+const size_t CHUNK_DIGITS = 9;
+
+// Numbers up to this many 32-bit digits are converted by repeated division by
+// CHUNK_DIVISOR, larger ones are split by powers of ten first
+const size_t SPLIT_THRESHOLD = 32;
+
+// Products of numbers with fewer 32-bit digits are computed in schoolbook
+// fashion, larger ones with Karatsuba's method
+const size_t KARATSUBA_THRESHOLD = 40;
+
+const uint32_t POW5_32[] = {
+		1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625,
+		48828125, 244140625, 1220703125
+};
+
+inline int leadingZeros(uint32_t x)
+{
+	int n = 0;
+	while (!(x & 0x80000000u)) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+}
+
+/** Power of ten used to split values and its reciprocal for Barrett reduction. */
+struct SplitPower {
+	Bignum power;
+	Bignum reciprocal;  // floor(2^(64 * power.size()) / power)
+};
+
+/**
+ * Returns 10^(9 * 2^k) and its reciprocal. Both are computed once per thread
+ * and cached, so that repeated conversions of large values only pay for the
+ * multiplications.
+ */
+const SplitPower& splitPower(size_t k)
+{
+	thread_local std::deque<SplitPower> powers;
+	while (powers.size() <= k) {
+		SplitPower next;
+		next.power = powers.empty() ? Bignum(CHUNK_DIVISOR)
+		                            : Bignum::mul(powers.back().power, powers.back().power);
+		Bignum remainder;
+		Bignum::divMod(Bignum(1).shiftLeft(64 * next.power.size()), next.power,
+				next.reciprocal, remainder);
+		powers.push_back(std::move(next));
+	}
+	return powers[k];
+}
+
+/**
+ * Divides value by a split power with Barrett reduction, i.e. two
+ * multiplications and at most two corrections. The value must have at most
+ * twice as many digits as the power.
+ */
+void divModSplit(const Bignum& value, const SplitPower& split, Bignum& quotient,
+		Bignum& remainder)
+{
+	size_t n = split.power.size();
+	assertmsg(value.size() <= 2 * n, "value too large for Barrett reduction");
+	
+	quotient = Bignum::mul(value.high(n - 1), split.reciprocal).high(n + 1);
+	remainder = value;
+	remainder -= Bignum::mul(quotient, split.power);
+	while (Bignum::compare(remainder, split.power) >= 0) {
+		remainder -= split.power;
+		quotient.addSmall(1);
+	}
+}
+
+/**
+ * Base case of the decimal conversion: repeatedly splits off 9 digits with a
+ * single 32-bit division per digit of the number.
+ */
+void appendDecimalSmall(Bignum value, std::string& out, size_t digits)
+{
+	std::vector<uint32_t> chunks;
+	while (!value.isZero())
+		chunks.push_back(value.divSmall(CHUNK_DIVISOR));
+	
+	if (chunks.empty()) {
+		out.append(digits != 0 ? digits : 1, '0');
+		return;
+	}
+	
+	// The leading chunk is written without zeros, all others with 9 digits
+	char buffer[maxDigits<10>()];
+	size_t count = writeDigits<10>(static_cast<uint64_t>(chunks.back()), buffer);
+	size_t length = count + (chunks.size() - 1) * CHUNK_DIGITS;
+	if (digits != 0) {
+		assertmsg(length <= digits, "value has more than " << digits << " digits");
+		out.append(digits - length, '0');
+	}
+	out.append(buffer, count);
+	
+	for (size_t i = chunks.size() - 1; i-- > 0;) {
+		count = writeDigits<10>(static_cast<uint64_t>(chunks[i]), buffer);
+		out.append(CHUNK_DIGITS - count, '0');
+		out.append(buffer, count);
+	}
+}
+
+/**
+ * Divide and conquer conversion: splits the value by a cached power of ten of
+ * about half its size and converts the quotient and the zero-padded remainder
+ * independently.
+ */
+void appendDecimalRecursive(const Bignum& value, std::string& out, size_t digits)
+{
+	if (value.size() <= SPLIT_THRESHOLD) {
+		appendDecimalSmall(value, out, digits);
+		return;
+	}
+	
+	// Smallest power with at least half the size of the value. It is always
+	// smaller than the value, so both halves shrink.
+	size_t k = 0;
+	while (splitPower(k).power.size() * 2 < value.size())
+		++k;
+	size_t power_digits = CHUNK_DIGITS << k;
+	
+	Bignum high, low;
+	divModSplit(value, splitPower(k), high, low);
+	
+	if (!high.isZero() || digits != 0) {
+		appendDecimalRecursive(high, out, digits != 0 ? digits - power_digits : 0);
+		appendDecimalRecursive(low, out, power_digits);
+	} else {
+		appendDecimalRecursive(low, out, 0);
+	}
+}
+
+} // anonymous namespace
+
+Bignum::Bignum(uint64_t value)
+{
+	while (value != 0) {
+		digits_.push_back(static_cast<uint32_t>(value));
+		value >>= 32;
+	}
+}
+
+Bignum::Bignum(const uint64_t* limbs, size_t size)
+{
+	digits_.reserve(size * 2);
+	for (size_t i = 0; i < size; ++i) {
+		digits_.push_back(static_cast<uint32_t>(limbs[i]));
+		digits_.push_back(static_cast<uint32_t>(limbs[i] >> 32));
+	}
+	normalize();
+}
+
+void Bignum::normalize()
+{
+	while (!digits_.empty() && digits_.back() == 0)
+		digits_.pop_back();
+}
+
+size_t Bignum::bitLength() const
+{
+	if (digits_.empty())
+		return 0;
+	return digits_.size() * 32 - static_cast<size_t>(leadingZeros(digits_.back()));
+}
+
+int Bignum::compare(const Bignum& lhs, const Bignum& rhs)
+{
+	if (lhs.digits_.size() != rhs.digits_.size())
+		return lhs.digits_.size() < rhs.digits_.size() ? -1 : 1;
+	for (size_t i = lhs.digits_.size(); i-- > 0;) {
+		if (lhs.digits_[i] != rhs.digits_[i])
+			return lhs.digits_[i] < rhs.digits_[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+Bignum& Bignum::addSmall(uint32_t summand)
+{
+	uint64_t carry = summand;
+	for (size_t i = 0; carry != 0 && i < digits_.size(); ++i) {
+		carry += digits_[i];
+		digits_[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	if (carry != 0)
+		digits_.push_back(static_cast<uint32_t>(carry));
+	return *this;
+}
+
+Bignum& Bignum::mulSmall(uint32_t factor)
+{
+	uint64_t carry = 0;
+	for (uint32_t& digit: digits_) {
+		carry += static_cast<uint64_t>(digit) * factor;
+		digit = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	if (carry != 0)
+		digits_.push_back(static_cast<uint32_t>(carry));
+	if (factor == 0)
+		digits_.clear();
+	return *this;
+}
+
+Bignum& Bignum::mulPow5(unsigned exponent)
+{
+	while (exponent >= 13) {
+		mulSmall(POW5_32[13]);
+		exponent -= 13;
+	}
+	if (exponent > 0)
+		mulSmall(POW5_32[exponent]);
+	return *this;
+}
+
+Bignum& Bignum::mulPow10(unsigned exponent)
+{
+	mulPow5(exponent);
+	return shiftLeft(exponent);
+}
+
+Bignum& Bignum::shiftLeft(size_t count)
+{
+	if (digits_.empty())
+		return *this;
+	
+	size_t words = count / 32;
+	unsigned shift = count % 32;
+	
+	if (shift != 0) {
+		uint32_t carry = 0;
+		for (uint32_t& digit: digits_) {
+			uint32_t next = digit >> (32 - shift);
+			digit = (digit << shift) | carry;
+			carry = next;
+		}
+		if (carry != 0)
+			digits_.push_back(carry);
+	}
+	digits_.insert(digits_.begin(), words, 0);
+	return *this;
+}
+
+Bignum& Bignum::operator+=(const Bignum& rhs)
+{
+	if (digits_.size() < rhs.digits_.size())
+		digits_.resize(rhs.digits_.size(), 0);
+	
+	uint64_t carry = 0;
+	for (size_t i = 0; i < digits_.size(); ++i) {
+		if (i >= rhs.digits_.size() && carry == 0)
+			return *this;
+		carry += digits_[i];
+		if (i < rhs.digits_.size())
+			carry += rhs.digits_[i];
+		digits_[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	if (carry != 0)
+		digits_.push_back(static_cast<uint32_t>(carry));
+	return *this;
+}
+
+Bignum& Bignum::operator-=(const Bignum& rhs)
+{
+	assertmsg(compare(*this, rhs) >= 0, "Bignum subtraction would be negative");
+	
+	uint32_t borrow = 0;
+	for (size_t i = 0; i < digits_.size(); ++i) {
+		if (i >= rhs.digits_.size() && borrow == 0)
+			break;
+		uint64_t subtrahend = static_cast<uint64_t>(borrow)
+				+ (i < rhs.digits_.size() ? rhs.digits_[i] : 0);
+		borrow = digits_[i] < subtrahend ? 1 : 0;
+		digits_[i] = static_cast<uint32_t>(digits_[i] - subtrahend);
+	}
+	normalize();
+	return *this;
+}
+
+uint32_t Bignum::divSmall(uint32_t divisor)
+{
+	uint64_t remainder = 0;
+	for (size_t i = digits_.size(); i-- > 0;) {
+		uint64_t current = (remainder << 32) | digits_[i];
+		digits_[i] = static_cast<uint32_t>(current / divisor);
+		remainder = current % divisor;
+	}
+	normalize();
+	return static_cast<uint32_t>(remainder);
+}
+
+Bignum Bignum::low(size_t count) const
+{
+	Bignum out;
+	out.digits_.assign(digits_.begin(), digits_.begin() + std::min(count, digits_.size()));
+	out.normalize();
+	return out;
+}
+
+Bignum Bignum::high(size_t count) const
+{
+	Bignum out;
+	if (count < digits_.size())
+		out.digits_.assign(digits_.begin() + count, digits_.end());
+	return out;
+}
+
+Bignum Bignum::mul(const Bignum& lhs, const Bignum& rhs)
+{
+	Bignum out;
+	if (lhs.isZero() || rhs.isZero())
+		return out;
+	
+	if (std::min(lhs.size(), rhs.size()) >= KARATSUBA_THRESHOLD) {
+		// lhs * rhs = z2 * B^2m + z1 * B^m + z0 with
+		// z1 = (l1 + l0) * (r1 + r0) - z2 - z0
+		size_t m = std::max(lhs.size(), rhs.size()) / 2;
+		Bignum l0 = lhs.low(m), l1 = lhs.high(m);
+		Bignum r0 = rhs.low(m), r1 = rhs.high(m);
+		
+		Bignum z0 = mul(l0, r0);
+		Bignum z2 = mul(l1, r1);
+		l0 += l1;
+		r0 += r1;
+		Bignum z1 = mul(l0, r0);
+		z1 -= z0;
+		z1 -= z2;
+		
+		out = std::move(z2);
+		out.shiftLeft(32 * m);
+		out += z1;
+		out.shiftLeft(32 * m);
+		out += z0;
+		return out;
+	}
+	
+	out.digits_.assign(lhs.digits_.size() + rhs.digits_.size(), 0);
+	for (size_t i = 0; i < lhs.digits_.size(); ++i) {
+		uint64_t carry = 0;
+		uint64_t factor = lhs.digits_[i];
+		for (size_t j = 0; j < rhs.digits_.size(); ++j) {
+			carry += factor * rhs.digits_[j] + out.digits_[i + j];
+			out.digits_[i + j] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		out.digits_[i + rhs.digits_.size()] = static_cast<uint32_t>(carry);
+	}
+	out.normalize();
+	return out;
+}
+
+void Bignum::divMod(const Bignum& dividend, const Bignum& divisor,
+		Bignum& quotient, Bignum& remainder)
+{
+	assertmsg(!divisor.isZero(), "Bignum division by zero");
+	
+	if (compare(dividend, divisor) < 0) {
+		quotient = Bignum();
+		remainder = dividend;
+		return;
+	}
+	if (divisor.size() == 1) {
+		quotient = dividend;
+		remainder = Bignum(quotient.divSmall(divisor.digits_[0]));
+		return;
+	}
+	
+	// Normalize so that the top digit of the divisor has its highest bit set
+	const size_t n = divisor.size();
+	const size_t m = dividend.size() - n;
+	const int s = leadingZeros(divisor.digits_.back());
+	
+	std::vector<uint32_t> v(n), u(dividend.size() + 1);
+	for (size_t i = n - 1; i > 0; --i)
+		v[i] = (divisor.digits_[i] << s) | static_cast<uint32_t>(
+				static_cast<uint64_t>(divisor.digits_[i - 1]) >> (32 - s));
+	v[0] = divisor.digits_[0] << s;
+	
+	u[m + n] = static_cast<uint32_t>(static_cast<uint64_t>(dividend.digits_[m + n - 1]) >> (32 - s));
+	for (size_t i = m + n - 1; i > 0; --i)
+		u[i] = (dividend.digits_[i] << s) | static_cast<uint32_t>(
+				static_cast<uint64_t>(dividend.digits_[i - 1]) >> (32 - s));
+	u[0] = dividend.digits_[0] << s;
+	
+	quotient.digits_.assign(m + 1, 0);
+	const uint64_t base = 1ull << 32;
+	
+	for (size_t j = m + 1; j-- > 0;) {
+		// Estimate the quotient digit from the top two digits
+		uint64_t top = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+		uint64_t qhat = top / v[n - 1];
+		uint64_t rhat = top % v[n - 1];
+		while (qhat >= base || qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2])) {
+			--qhat;
+			rhat += v[n - 1];
+			if (rhat >= base)
+				break;
+		}
+		
+		// Multiply and subtract
+		int64_t borrow = 0;
+		for (size_t i = 0; i < n; ++i) {
+			uint64_t product = qhat * v[i];
+			int64_t t = static_cast<int64_t>(u[i + j]) - borrow
+					- static_cast<int64_t>(product & 0xffffffff);
+			u[i + j] = static_cast<uint32_t>(t);
+			borrow = static_cast<int64_t>(product >> 32) - (t >> 32);
+		}
+		int64_t t = static_cast<int64_t>(u[j + n]) - borrow;
+		u[j + n] = static_cast<uint32_t>(t);
+		
+		// The estimate was one too large in rare cases, add back
+		if (t < 0) {
+			--qhat;
+			uint64_t carry = 0;
+			for (size_t i = 0; i < n; ++i) {
+				carry += static_cast<uint64_t>(u[i + j]) + v[i];
+				u[i + j] = static_cast<uint32_t>(carry);
+				carry >>= 32;
+			}
+			u[j + n] = static_cast<uint32_t>(u[j + n] + carry);
+		}
+		quotient.digits_[j] = static_cast<uint32_t>(qhat);
+	}
+	quotient.normalize();
+	
+	// Undo the normalization for the remainder
+	remainder.digits_.resize(n);
+	for (size_t i = 0; i < n - 1; ++i)
+		remainder.digits_[i] = (u[i] >> s) | static_cast<uint32_t>(
+				static_cast<uint64_t>(u[i + 1]) << (32 - s));
+	remainder.digits_[n - 1] = u[n - 1] >> s;
+	remainder.normalize();
+}
+
+void Bignum::appendDecimal(std::string& out, size_t digits) const
+{
+	appendDecimalRecursive(*this, out, digits);
+}
+
+} // namespace detail
+} // namespace fs
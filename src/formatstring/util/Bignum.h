@@ -0,0 +1,116 @@
+/** @file formatstring/util/Bignum.h
+ *
+ * Minimal arbitrary-precision unsigned integer used for exact conversions
+ * between binary and decimal. This header is private to the library.
+ */
+
+#ifndef FORMATSTRING_BIGNUM_H
+#define FORMATSTRING_BIGNUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace fs {
+namespace detail {
+
+/**
+ * Unsigned integer of arbitrary size, stored as 32-bit digits with the least
+ * significant digit first. 32-bit digits keep all intermediate products and
+ * quotients in portable 64-bit arithmetic. Zero has no digits.
+ */
+class Bignum
+{
+public:
+	/** Creates a Bignum with the value 0. */
+	Bignum() = default;
+	
+	/** Creates a Bignum with the given value. */
+	explicit Bignum(uint64_t value);
+	
+	/** Creates a Bignum from 64-bit limbs, least significant limb first. */
+	Bignum(const uint64_t* limbs, size_t size);
+	
+	//--------------------------------------------------------------------------
+	
+	/** Returns whether the value is 0. */
+	bool isZero() const { return digits_.empty(); }
+	
+	/** Returns whether the value is odd. */
+	bool isOdd() const { return !digits_.empty() && (digits_[0] & 1) != 0; }
+	
+	/** Returns the number of 32-bit digits. */
+	size_t size() const { return digits_.size(); }
+	
+	/** Returns the number of significant bits. */
+	size_t bitLength() const;
+	
+	/** Returns the lowest 64 bits of the value. */
+	uint64_t low64() const
+	{
+		uint64_t out = digits_.empty() ? 0 : digits_[0];
+		if (digits_.size() > 1)
+			out |= static_cast<uint64_t>(digits_[1]) << 32;
+		return out;
+	}
+	
+	/** Returns the value of the lowest count digits. */
+	Bignum low(size_t count) const;
+	
+	/** Returns the value without the lowest count digits. */
+	Bignum high(size_t count) const;
+	
+	/** Returns -1, 0 or 1 if lhs is less than, equal to or greater than rhs. */
+	static int compare(const Bignum& lhs, const Bignum& rhs);
+	
+	//--------------------------------------------------------------------------
+	
+	Bignum& addSmall(uint32_t summand);
+	Bignum& mulSmall(uint32_t factor);
+	Bignum& mulPow5(unsigned exponent);
+	Bignum& mulPow10(unsigned exponent);
+	Bignum& shiftLeft(size_t count);
+	
+	/** Adds rhs to this value. */
+	Bignum& operator+=(const Bignum& rhs);
+	
+	/** Subtracts rhs from this value, which must not be less than rhs. */
+	Bignum& operator-=(const Bignum& rhs);
+	
+	/** Divides this value by divisor and returns the remainder. */
+	uint32_t divSmall(uint32_t divisor);
+	
+	/**
+	 * Returns the product of lhs and rhs. Large operands are multiplied with
+	 * Karatsuba's method.
+	 */
+	static Bignum mul(const Bignum& lhs, const Bignum& rhs);
+	
+	/**
+	 * Divides dividend by the non-zero divisor using Knuth's algorithm D and
+	 * stores quotient and remainder.
+	 */
+	static void divMod(const Bignum& dividend, const Bignum& divisor,
+			Bignum& quotient, Bignum& remainder);
+	
+	//--------------------------------------------------------------------------
+	
+	/**
+	 * Appends the decimal digits of this value to out. If digits is not 0,
+	 * exactly that many digits are written with leading zeros, otherwise only
+	 * the significant ones (at least a single "0").
+	 */
+	void appendDecimal(std::string& out, size_t digits = 0) const;
+
+private:
+	void normalize();
+	
+	std::vector<uint32_t> digits_;
+};
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_BIGNUM_H
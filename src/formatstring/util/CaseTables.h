@@ -0,0 +1,421 @@
+/** @file formatstring/util/CaseTables.h
+ *
+ * Simple case mapping tables for Unicode 14.0.0, generated by
+ * tools/unicode_case_tables.py. This header is private to the library and
+ * must only be included by TextTransform.cpp.
+ */
+
+#ifndef FORMATSTRING_CASETABLES_H
+#define FORMATSTRING_CASETABLES_H
+
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+namespace {
+
+/**
+ * Code points from first to last, every stride one, which are mapped to the
+ * code point delta away.
+ */
+struct CaseRange {
+	uint32_t first;
+	uint32_t last;
+	int32_t delta;
+	uint32_t stride;
+};
+
+/** Non-ASCII code points that have an upper case mapping. */
+const CaseRange TO_UPPER[199] = {
+	{0x000b5, 0x000b5, 743, 1},
+	{0x000e0, 0x000f6, -32, 1},
+	{0x000f8, 0x000fe, -32, 1},
+	{0x000ff, 0x000ff, 121, 1},
+	{0x00101, 0x0012f, -1, 2},
+	{0x00131, 0x00131, -232, 1},
+	{0x00133, 0x00137, -1, 2},
+	{0x0013a, 0x00148, -1, 2},
+	{0x0014b, 0x00177, -1, 2},
+	{0x0017a, 0x0017e, -1, 2},
+	{0x0017f, 0x0017f, -300, 1},
+	{0x00180, 0x00180, 195, 1},
+	{0x00183, 0x00185, -1, 2},
+	{0x00188, 0x00188, -1, 1},
+	{0x0018c, 0x0018c, -1, 1},
+	{0x00192, 0x00192, -1, 1},
+	{0x00195, 0x00195, 97, 1},
+	{0x00199, 0x00199, -1, 1},
+	{0x0019a, 0x0019a, 163, 1},
+	{0x0019e, 0x0019e, 130, 1},
+	{0x001a1, 0x001a5, -1, 2},
+	{0x001a8, 0x001a8, -1, 1},
+	{0x001ad, 0x001ad, -1, 1},
+	{0x001b0, 0x001b0, -1, 1},
+	{0x001b4, 0x001b6, -1, 2},
+	{0x001b9, 0x001b9, -1, 1},
+	{0x001bd, 0x001bd, -1, 1},
+	{0x001bf, 0x001bf, 56, 1},
+	{0x001c5, 0x001c5, -1, 1},
+	{0x001c6, 0x001c6, -2, 1},
+	{0x001c8, 0x001c8, -1, 1},
+	{0x001c9, 0x001c9, -2, 1},
+	{0x001cb, 0x001cb, -1, 1},
+	{0x001cc, 0x001cc, -2, 1},
+	{0x001ce, 0x001dc, -1, 2},
+	{0x001dd, 0x001dd, -79, 1},
+	{0x001df, 0x001ef, -1, 2},
+	{0x001f2, 0x001f2, -1, 1},
+	{0x001f3, 0x001f3, -2, 1},
+	{0x001f5, 0x001f5, -1, 1},
+	{0x001f9, 0x0021f, -1, 2},
+	{0x00223, 0x00233, -1, 2},
+	{0x0023c, 0x0023c, -1, 1},
+	{0x0023f, 0x00240, 10815, 1},
+	{0x00242, 0x00242, -1, 1},
+	{0x00247, 0x0024f, -1, 2},
+	{0x00250, 0x00250, 10783, 1},
+	{0x00251, 0x00251, 10780, 1},
+	{0x00252, 0x00252, 10782, 1},
+	{0x00253, 0x00253, -210, 1},
+	{0x00254, 0x00254, -206, 1},
+	{0x00256, 0x00257, -205, 1},
+	{0x00259, 0x00259, -202, 1},
+	{0x0025b, 0x0025b, -203, 1},
+	{0x0025c, 0x0025c, 42319, 1},
+	{0x00260, 0x00260, -205, 1},
+	{0x00261, 0x00261, 42315, 1},
+	{0x00263, 0x00263, -207, 1},
+	{0x00265, 0x00265, 42280, 1},
+	{0x00266, 0x00266, 42308, 1},
+	{0x00268, 0x00268, -209, 1},
+	{0x00269, 0x00269, -211, 1},
+	{0x0026a, 0x0026a, 42308, 1},
+	{0x0026b, 0x0026b, 10743, 1},
+	{0x0026c, 0x0026c, 42305, 1},
+	{0x0026f, 0x0026f, -211, 1},
+	{0x00271, 0x00271, 10749, 1},
+	{0x00272, 0x00272, -213, 1},
+	{0x00275, 0x00275, -214, 1},
+	{0x0027d, 0x0027d, 10727, 1},
+	{0x00280, 0x00280, -218, 1},
+	{0x00282, 0x00282, 42307, 1},
+	{0x00283, 0x00283, -218, 1},
+	{0x00287, 0x00287, 42282, 1},
+	{0x00288, 0x00288, -218, 1},
+	{0x00289, 0x00289, -69, 1},
+	{0x0028a, 0x0028b, -217, 1},
+	{0x0028c, 0x0028c, -71, 1},
+	{0x00292, 0x00292, -219, 1},
+	{0x0029d, 0x0029d, 42261, 1},
+	{0x0029e, 0x0029e, 42258, 1},
+	{0x00345, 0x00345, 84, 1},
+	{0x00371, 0x00373, -1, 2},
+	{0x00377, 0x00377, -1, 1},
+	{0x0037b, 0x0037d, 130, 1},
+	{0x003ac, 0x003ac, -38, 1},
+	{0x003ad, 0x003af, -37, 1},
+	{0x003b1, 0x003c1, -32, 1},
+	{0x003c2, 0x003c2, -31, 1},
+	{0x003c3, 0x003cb, -32, 1},
+	{0x003cc, 0x003cc, -64, 1},
+	{0x003cd, 0x003ce, -63, 1},
+	{0x003d0, 0x003d0, -62, 1},
+	{0x003d1, 0x003d1, -57, 1},
+	{0x003d5, 0x003d5, -47, 1},
+	{0x003d6, 0x003d6, -54, 1},
+	{0x003d7, 0x003d7, -8, 1},
+	{0x003d9, 0x003ef, -1, 2},
+	{0x003f0, 0x003f0, -86, 1},
+	{0x003f1, 0x003f1, -80, 1},
+	{0x003f2, 0x003f2, 7, 1},
+	{0x003f3, 0x003f3, -116, 1},
+	{0x003f5, 0x003f5, -96, 1},
+	{0x003f8, 0x003f8, -1, 1},
+	{0x003fb, 0x003fb, -1, 1},
+	{0x00430, 0x0044f, -32, 1},
+	{0x00450, 0x0045f, -80, 1},
+	{0x00461, 0x00481, -1, 2},
+	{0x0048b, 0x004bf, -1, 2},
+	{0x004c2, 0x004ce, -1, 2},
+	{0x004cf, 0x004cf, -15, 1},
+	{0x004d1, 0x0052f, -1, 2},
+	{0x00561, 0x00586, -48, 1},
+	{0x010d0, 0x010fa, 3008, 1},
+	{0x010fd, 0x010ff, 3008, 1},
+	{0x013f8, 0x013fd, -8, 1},
+	{0x01c80, 0x01c80, -6254, 1},
+	{0x01c81, 0x01c81, -6253, 1},
+	{0x01c82, 0x01c82, -6244, 1},
+	{0x01c83, 0x01c84, -6242, 1},
+	{0x01c85, 0x01c85, -6243, 1},
+	{0x01c86, 0x01c86, -6236, 1},
+	{0x01c87, 0x01c87, -6181, 1},
+	{0x01c88, 0x01c88, 35266, 1},
+	{0x01d79, 0x01d79, 35332, 1},
+	{0x01d7d, 0x01d7d, 3814, 1},
+	{0x01d8e, 0x01d8e, 35384, 1},
+	{0x01e01, 0x01e95, -1, 2},
+	{0x01e9b, 0x01e9b, -59, 1},
+	{0x01ea1, 0x01eff, -1, 2},
+	{0x01f00, 0x01f07, 8, 1},
+	{0x01f10, 0x01f15, 8, 1},
+	{0x01f20, 0x01f27, 8, 1},
+	{0x01f30, 0x01f37, 8, 1},
+	{0x01f40, 0x01f45, 8, 1},
+	{0x01f51, 0x01f57, 8, 2},
+	{0x01f60, 0x01f67, 8, 1},
+	{0x01f70, 0x01f71, 74, 1},
+	{0x01f72, 0x01f75, 86, 1},
+	{0x01f76, 0x01f77, 100, 1},
+	{0x01f78, 0x01f79, 128, 1},
+	{0x01f7a, 0x01f7b, 112, 1},
+	{0x01f7c, 0x01f7d, 126, 1},
+	{0x01f80, 0x01f87, 8, 1},
+	{0x01f90, 0x01f97, 8, 1},
+	{0x01fa0, 0x01fa7, 8, 1},
+	{0x01fb0, 0x01fb1, 8, 1},
+	{0x01fb3, 0x01fb3, 9, 1},
+	{0x01fbe, 0x01fbe, -7205, 1},
+	{0x01fc3, 0x01fc3, 9, 1},
+	{0x01fd0, 0x01fd1, 8, 1},
+	{0x01fe0, 0x01fe1, 8, 1},
+	{0x01fe5, 0x01fe5, 7, 1},
+	{0x01ff3, 0x01ff3, 9, 1},
+	{0x0214e, 0x0214e, -28, 1},
+	{0x02170, 0x0217f, -16, 1},
+	{0x02184, 0x02184, -1, 1},
+	{0x024d0, 0x024e9, -26, 1},
+	{0x02c30, 0x02c5f, -48, 1},
+	{0x02c61, 0x02c61, -1, 1},
+	{0x02c65, 0x02c65, -10795, 1},
+	{0x02c66, 0x02c66, -10792, 1},
+	{0x02c68, 0x02c6c, -1, 2},
+	{0x02c73, 0x02c73, -1, 1},
+	{0x02c76, 0x02c76, -1, 1},
+	{0x02c81, 0x02ce3, -1, 2},
+	{0x02cec, 0x02cee, -1, 2},
+	{0x02cf3, 0x02cf3, -1, 1},
+	{0x02d00, 0x02d25, -7264, 1},
+	{0x02d27, 0x02d27, -7264, 1},
+	{0x02d2d, 0x02d2d, -7264, 1},
+	{0x0a641, 0x0a66d, -1, 2},
+	{0x0a681, 0x0a69b, -1, 2},
+	{0x0a723, 0x0a72f, -1, 2},
+	{0x0a733, 0x0a76f, -1, 2},
+	{0x0a77a, 0x0a77c, -1, 2},
+	{0x0a77f, 0x0a787, -1, 2},
+	{0x0a78c, 0x0a78c, -1, 1},
+	{0x0a791, 0x0a793, -1, 2},
+	{0x0a794, 0x0a794, 48, 1},
+	{0x0a797, 0x0a7a9, -1, 2},
+	{0x0a7b5, 0x0a7c3, -1, 2},
+	{0x0a7c8, 0x0a7ca, -1, 2},
+	{0x0a7d1, 0x0a7d1, -1, 1},
+	{0x0a7d7, 0x0a7d9, -1, 2},
+	{0x0a7f6, 0x0a7f6, -1, 1},
+	{0x0ab53, 0x0ab53, -928, 1},
+	{0x0ab70, 0x0abbf, -38864, 1},
+	{0x0ff41, 0x0ff5a, -32, 1},
+	{0x10428, 0x1044f, -40, 1},
+	{0x104d8, 0x104fb, -40, 1},
+	{0x10597, 0x105a1, -39, 1},
+	{0x105a3, 0x105b1, -39, 1},
+	{0x105b3, 0x105b9, -39, 1},
+	{0x105bb, 0x105bc, -39, 1},
+	{0x10cc0, 0x10cf2, -64, 1},
+	{0x118c0, 0x118df, -32, 1},
+	{0x16e60, 0x16e7f, -32, 1},
+	{0x1e922, 0x1e943, -34, 1},
+};
+
+/** Non-ASCII code points that have a lower case mapping. */
+const CaseRange TO_LOWER[181] = {
+	{0x000c0, 0x000d6, 32, 1},
+	{0x000d8, 0x000de, 32, 1},
+	{0x00100, 0x0012e, 1, 2},
+	{0x00130, 0x00130, -199, 1},
+	{0x00132, 0x00136, 1, 2},
+	{0x00139, 0x00147, 1, 2},
+	{0x0014a, 0x00176, 1, 2},
+	{0x00178, 0x00178, -121, 1},
+	{0x00179, 0x0017d, 1, 2},
+	{0x00181, 0x00181, 210, 1},
+	{0x00182, 0x00184, 1, 2},
+	{0x00186, 0x00186, 206, 1},
+	{0x00187, 0x00187, 1, 1},
+	{0x00189, 0x0018a, 205, 1},
+	{0x0018b, 0x0018b, 1, 1},
+	{0x0018e, 0x0018e, 79, 1},
+	{0x0018f, 0x0018f, 202, 1},
+	{0x00190, 0x00190, 203, 1},
+	{0x00191, 0x00191, 1, 1},
+	{0x00193, 0x00193, 205, 1},
+	{0x00194, 0x00194, 207, 1},
+	{0x00196, 0x00196, 211, 1},
+	{0x00197, 0x00197, 209, 1},
+	{0x00198, 0x00198, 1, 1},
+	{0x0019c, 0x0019c, 211, 1},
+	{0x0019d, 0x0019d, 213, 1},
+	{0x0019f, 0x0019f, 214, 1},
+	{0x001a0, 0x001a4, 1, 2},
+	{0x001a6, 0x001a6, 218, 1},
+	{0x001a7, 0x001a7, 1, 1},
+	{0x001a9, 0x001a9, 218, 1},
+	{0x001ac, 0x001ac, 1, 1},
+	{0x001ae, 0x001ae, 218, 1},
+	{0x001af, 0x001af, 1, 1},
+	{0x001b1, 0x001b2, 217, 1},
+	{0x001b3, 0x001b5, 1, 2},
+	{0x001b7, 0x001b7, 219, 1},
+	{0x001b8, 0x001b8, 1, 1},
+	{0x001bc, 0x001bc, 1, 1},
+	{0x001c4, 0x001c4, 2, 1},
+	{0x001c5, 0x001c5, 1, 1},
+	{0x001c7, 0x001c7, 2, 1},
+	{0x001c8, 0x001c8, 1, 1},
+	{0x001ca, 0x001ca, 2, 1},
+	{0x001cb, 0x001db, 1, 2},
+	{0x001de, 0x001ee, 1, 2},
+	{0x001f1, 0x001f1, 2, 1},
+	{0x001f2, 0x001f4, 1, 2},
+	{0x001f6, 0x001f6, -97, 1},
+	{0x001f7, 0x001f7, -56, 1},
+	{0x001f8, 0x0021e, 1, 2},
+	{0x00220, 0x00220, -130, 1},
+	{0x00222, 0x00232, 1, 2},
+	{0x0023a, 0x0023a, 10795, 1},
+	{0x0023b, 0x0023b, 1, 1},
+	{0x0023d, 0x0023d, -163, 1},
+	{0x0023e, 0x0023e, 10792, 1},
+	{0x00241, 0x00241, 1, 1},
+	{0x00243, 0x00243, -195, 1},
+	{0x00244, 0x00244, 69, 1},
+	{0x00245, 0x00245, 71, 1},
+	{0x00246, 0x0024e, 1, 2},
+	{0x00370, 0x00372, 1, 2},
+	{0x00376, 0x00376, 1, 1},
+	{0x0037f, 0x0037f, 116, 1},
+	{0x00386, 0x00386, 38, 1},
+	{0x00388, 0x0038a, 37, 1},
+	{0x0038c, 0x0038c, 64, 1},
+	{0x0038e, 0x0038f, 63, 1},
+	{0x00391, 0x003a1, 32, 1},
+	{0x003a3, 0x003ab, 32, 1},
+	{0x003cf, 0x003cf, 8, 1},
+	{0x003d8, 0x003ee, 1, 2},
+	{0x003f4, 0x003f4, -60, 1},
+	{0x003f7, 0x003f7, 1, 1},
+	{0x003f9, 0x003f9, -7, 1},
+	{0x003fa, 0x003fa, 1, 1},
+	{0x003fd, 0x003ff, -130, 1},
+	{0x00400, 0x0040f, 80, 1},
+	{0x00410, 0x0042f, 32, 1},
+	{0x00460, 0x00480, 1, 2},
+	{0x0048a, 0x004be, 1, 2},
+	{0x004c0, 0x004c0, 15, 1},
+	{0x004c1, 0x004cd, 1, 2},
+	{0x004d0, 0x0052e, 1, 2},
+	{0x00531, 0x00556, 48, 1},
+	{0x010a0, 0x010c5, 7264, 1},
+	{0x010c7, 0x010c7, 7264, 1},
+	{0x010cd, 0x010cd, 7264, 1},
+	{0x013a0, 0x013ef, 38864, 1},
+	{0x013f0, 0x013f5, 8, 1},
+	{0x01c90, 0x01cba, -3008, 1},
+	{0x01cbd, 0x01cbf, -3008, 1},
+	{0x01e00, 0x01e94, 1, 2},
+	{0x01e9e, 0x01e9e, -7615, 1},
+	{0x01ea0, 0x01efe, 1, 2},
+	{0x01f08, 0x01f0f, -8, 1},
+	{0x01f18, 0x01f1d, -8, 1},
+	{0x01f28, 0x01f2f, -8, 1},
+	{0x01f38, 0x01f3f, -8, 1},
+	{0x01f48, 0x01f4d, -8, 1},
+	{0x01f59, 0x01f5f, -8, 2},
+	{0x01f68, 0x01f6f, -8, 1},
+	{0x01f88, 0x01f8f, -8, 1},
+	{0x01f98, 0x01f9f, -8, 1},
+	{0x01fa8, 0x01faf, -8, 1},
+	{0x01fb8, 0x01fb9, -8, 1},
+	{0x01fba, 0x01fbb, -74, 1},
+	{0x01fbc, 0x01fbc, -9, 1},
+	{0x01fc8, 0x01fcb, -86, 1},
+	{0x01fcc, 0x01fcc, -9, 1},
+	{0x01fd8, 0x01fd9, -8, 1},
+	{0x01fda, 0x01fdb, -100, 1},
+	{0x01fe8, 0x01fe9, -8, 1},
+	{0x01fea, 0x01feb, -112, 1},
+	{0x01fec, 0x01fec, -7, 1},
+	{0x01ff8, 0x01ff9, -128, 1},
+	{0x01ffa, 0x01ffb, -126, 1},
+	{0x01ffc, 0x01ffc, -9, 1},
+	{0x02126, 0x02126, -7517, 1},
+	{0x0212a, 0x0212a, -8383, 1},
+	{0x0212b, 0x0212b, -8262, 1},
+	{0x02132, 0x02132, 28, 1},
+	{0x02160, 0x0216f, 16, 1},
+	{0x02183, 0x02183, 1, 1},
+	{0x024b6, 0x024cf, 26, 1},
+	{0x02c00, 0x02c2f, 48, 1},
+	{0x02c60, 0x02c60, 1, 1},
+	{0x02c62, 0x02c62, -10743, 1},
+	{0x02c63, 0x02c63, -3814, 1},
+	{0x02c64, 0x02c64, -10727, 1},
+	{0x02c67, 0x02c6b, 1, 2},
+	{0x02c6d, 0x02c6d, -10780, 1},
+	{0x02c6e, 0x02c6e, -10749, 1},
+	{0x02c6f, 0x02c6f, -10783, 1},
+	{0x02c70, 0x02c70, -10782, 1},
+	{0x02c72, 0x02c72, 1, 1},
+	{0x02c75, 0x02c75, 1, 1},
+	{0x02c7e, 0x02c7f, -10815, 1},
+	{0x02c80, 0x02ce2, 1, 2},
+	{0x02ceb, 0x02ced, 1, 2},
+	{0x02cf2, 0x02cf2, 1, 1},
+	{0x0a640, 0x0a66c, 1, 2},
+	{0x0a680, 0x0a69a, 1, 2},
+	{0x0a722, 0x0a72e, 1, 2},
+	{0x0a732, 0x0a76e, 1, 2},
+	{0x0a779, 0x0a77b, 1, 2},
+	{0x0a77d, 0x0a77d, -35332, 1},
+	{0x0a77e, 0x0a786, 1, 2},
+	{0x0a78b, 0x0a78b, 1, 1},
+	{0x0a78d, 0x0a78d, -42280, 1},
+	{0x0a790, 0x0a792, 1, 2},
+	{0x0a796, 0x0a7a8, 1, 2},
+	{0x0a7aa, 0x0a7aa, -42308, 1},
+	{0x0a7ab, 0x0a7ab, -42319, 1},
+	{0x0a7ac, 0x0a7ac, -42315, 1},
+	{0x0a7ad, 0x0a7ad, -42305, 1},
+	{0x0a7ae, 0x0a7ae, -42308, 1},
+	{0x0a7b0, 0x0a7b0, -42258, 1},
+	{0x0a7b1, 0x0a7b1, -42282, 1},
+	{0x0a7b2, 0x0a7b2, -42261, 1},
+	{0x0a7b3, 0x0a7b3, 928, 1},
+	{0x0a7b4, 0x0a7c2, 1, 2},
+	{0x0a7c4, 0x0a7c4, -48, 1},
+	{0x0a7c5, 0x0a7c5, -42307, 1},
+	{0x0a7c6, 0x0a7c6, -35384, 1},
+	{0x0a7c7, 0x0a7c9, 1, 2},
+	{0x0a7d0, 0x0a7d0, 1, 1},
+	{0x0a7d6, 0x0a7d8, 1, 2},
+	{0x0a7f5, 0x0a7f5, 1, 1},
+	{0x0ff21, 0x0ff3a, 32, 1},
+	{0x10400, 0x10427, 40, 1},
+	{0x104b0, 0x104d3, 40, 1},
+	{0x10570, 0x1057a, 39, 1},
+	{0x1057c, 0x1058a, 39, 1},
+	{0x1058c, 0x10592, 39, 1},
+	{0x10594, 0x10595, 39, 1},
+	{0x10c80, 0x10cb2, 64, 1},
+	{0x118a0, 0x118bf, 32, 1},
+	{0x16e40, 0x16e5f, 32, 1},
+	{0x1e900, 0x1e921, 34, 1},
+};
+
+} // anonymous namespace
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_CASETABLES_H
@@ -0,0 +1,64 @@
+/** @file formatstring/util/Cpu.h
+ *
+ * Runtime detection of the x86 instruction set extensions used by the SIMD
+ * kernels. This header is private to the library.
+ */
+
+#ifndef FORMATSTRING_CPU_H
+#define FORMATSTRING_CPU_H
+
+// SIMD kernels are compiled with per-function target attributes, so the
+// library itself does not need to be built with -msse4 or -mavx2. They are
+// only selected at runtime if the executing CPU supports them.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FORMATSTRING_X86_SIMD 1
+#define FORMATSTRING_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#else
+#define FORMATSTRING_X86_SIMD 0
+#define FORMATSTRING_TARGET(isa)
+#endif
+
+
+namespace fs {
+namespace cpu {
+
+#if FORMATSTRING_X86_SIMD
+
+inline bool hasSse2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+inline bool hasSsse3()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+inline bool hasSse41()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+inline bool hasAvx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+inline bool hasSse2()  { return false; }
+inline bool hasSsse3() { return false; }
+inline bool hasSse41() { return false; }
+inline bool hasAvx2()  { return false; }
+
+#endif // FORMATSTRING_X86_SIMD
+
+} // namespace cpu
+} // namespace fs
+
+#endif //FORMATSTRING_CPU_H
@@ -0,0 +1,356 @@
+// formatstring/util/Escape.cpp
+//
+// Escaping of text for JSON, CSV, C and HTML
+
+#include "formatstring/util/Escape.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "formatstring/util/Cpu.h"
+#include "formatstring/util/Utf8.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+const size_t MAX_SPECIALS = 5;
+
+/** The bytes that have to be escaped in one of the modes. */
+struct EscapeSet {
+	char specials[MAX_SPECIALS];
+	size_t count;
+	bool controls;    // Bytes below 0x20
+	bool del;         // 0x7f
+	bool high;        // Bytes from 0x80, which are checked for valid UTF-8
+	bool table[256];  // All of them, for the scalar code
+};
+
+EscapeSet makeEscapeSet(const char* specials, bool controls, bool del, bool high)
+{
+	EscapeSet set{};
+	set.count = std::strlen(specials);
+	std::memcpy(set.specials, specials, set.count);
+	set.controls = controls;
+	set.del = del;
+	set.high = high;
+	for (unsigned c = 0; c < 256; ++c) {
+		set.table[c] = (controls && c < 0x20) || (del && c == 0x7f) || (high && c >= 0x80)
+				|| (c != 0 && std::memchr(specials, static_cast<int>(c), set.count) != nullptr);
+	}
+	return set;
+}
+
+const EscapeSet& escapeSet(char mode)
+{
+	static const EscapeSet JSON = makeEscapeSet("\"\\", true, false, false);
+	static const EscapeSet JSON_UTF8 = makeEscapeSet("\"\\", true, false, true);
+	static const EscapeSet C = makeEscapeSet("\"\\", true, true, false);
+	static const EscapeSet CSV = makeEscapeSet(",\"\r\n", false, false, false);
+	static const EscapeSet HTML = makeEscapeSet("&<>\"'", false, false, false);
+	
+	switch (mode) {
+	case 'j': return JSON;
+	case 'J': return JSON_UTF8;
+	case 'c': return CSV;
+	case 'C': return C;
+	default:  return HTML;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Kernels that return the index of the first byte to escape or the length
+
+size_t findScalar(const char* text, size_t length, const EscapeSet& set)
+{
+	for (size_t i = 0; i < length; ++i) {
+		if (set.table[static_cast<unsigned char>(text[i])])
+			return i;
+	}
+	return length;
+}
+
+#if FORMATSTRING_X86_SIMD
+
+FORMATSTRING_TARGET("sse2")
+size_t findSse2(const char* text, size_t length, const EscapeSet& set)
+{
+	__m128i specials[MAX_SPECIALS];
+	for (size_t k = 0; k < set.count; ++k)
+		specials[k] = _mm_set1_epi8(set.specials[k]);
+	const __m128i below_space = _mm_set1_epi8(0x1f);
+	const __m128i del = _mm_set1_epi8(0x7f);
+	
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		__m128i found = _mm_setzero_si128();
+		for (size_t k = 0; k < set.count; ++k)
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(x, specials[k]));
+		if (set.controls)
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(_mm_min_epu8(x, below_space), x));
+		if (set.del)
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(x, del));
+		if (set.high)
+			found = _mm_or_si128(found, x);
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+		if (mask != 0)
+			return i + static_cast<size_t>(__builtin_ctz(mask));
+	}
+	return i + findScalar(text + i, length - i, set);
+}
+
+FORMATSTRING_TARGET("avx2")
+size_t findAvx2(const char* text, size_t length, const EscapeSet& set)
+{
+	__m256i specials[MAX_SPECIALS];
+	for (size_t k = 0; k < set.count; ++k)
+		specials[k] = _mm256_set1_epi8(set.specials[k]);
+	const __m256i below_space = _mm256_set1_epi8(0x1f);
+	const __m256i del = _mm256_set1_epi8(0x7f);
+	
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+		__m256i found = _mm256_setzero_si256();
+		for (size_t k = 0; k < set.count; ++k)
+			found = _mm256_or_si256(found, _mm256_cmpeq_epi8(x, specials[k]));
+		if (set.controls)
+			found = _mm256_or_si256(found, _mm256_cmpeq_epi8(_mm256_min_epu8(x, below_space), x));
+		if (set.del)
+			found = _mm256_or_si256(found, _mm256_cmpeq_epi8(x, del));
+		if (set.high)
+			found = _mm256_or_si256(found, x);
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(found));
+		if (mask != 0)
+			return i + static_cast<size_t>(__builtin_ctz(mask));
+	}
+	return i + findScalar(text + i, length - i, set);
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using FindKernel = size_t (*)(const char*, size_t, const EscapeSet&);
+
+FindKernel selectFindKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return findAvx2;
+	if (cpu::hasSse2())
+		return findSse2;
+#endif
+	return findScalar;
+}
+
+//------------------------------------------------------------------------------
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+void appendJsonEscape(std::string& out, unsigned char c)
+{
+	switch (c) {
+	case '"':  out += "\\\""; break;
+	case '\\': out += "\\\\"; break;
+	case '\b': out += "\\b"; break;
+	case '\f': out += "\\f"; break;
+	case '\n': out += "\\n"; break;
+	case '\r': out += "\\r"; break;
+	case '\t': out += "\\t"; break;
+	default:
+		out += "\\u00";
+		out += HEX_DIGITS[c >> 4];
+		out += HEX_DIGITS[c & 0xf];
+	}
+}
+
+void appendCEscape(std::string& out, unsigned char c)
+{
+	switch (c) {
+	case '"':  out += "\\\""; break;
+	case '\\': out += "\\\\"; break;
+	case '\a': out += "\\a"; break;
+	case '\b': out += "\\b"; break;
+	case '\f': out += "\\f"; break;
+	case '\n': out += "\\n"; break;
+	case '\r': out += "\\r"; break;
+	case '\t': out += "\\t"; break;
+	case '\v': out += "\\v"; break;
+	default:
+		// Octal escapes end after three digits, unlike hex escapes, which
+		// would swallow following hex digits
+		out += '\\';
+		out += static_cast<char>('0' + (c >> 6));
+		out += static_cast<char>('0' + ((c >> 3) & 7));
+		out += static_cast<char>('0' + (c & 7));
+	}
+}
+
+void appendHtmlEscape(std::string& out, unsigned char c)
+{
+	switch (c) {
+	case '&': out += "&amp;"; break;
+	case '<': out += "&lt;"; break;
+	case '>': out += "&gt;"; break;
+	case '"': out += "&quot;"; break;
+	default:  out += "&#39;"; break;
+	}
+}
+
+void appendEscape(std::string& out, unsigned char c, char mode)
+{
+	if (mode == 'C')
+		appendCEscape(out, c);
+	else if (mode == 'h')
+		appendHtmlEscape(out, c);
+	else
+		appendJsonEscape(out, c);
+}
+
+/** Returns the lengths of the escape sequences of all bytes in the mode. */
+const unsigned char* escapeLengths(char mode)
+{
+	struct Lengths {
+		unsigned char of[256];
+	};
+	auto make = [](char mode) {
+		Lengths lengths{};
+		std::string sequence;
+		for (unsigned c = 0; c < 256; ++c) {
+			sequence.clear();
+			appendEscape(sequence, static_cast<unsigned char>(c), mode);
+			lengths.of[c] = static_cast<unsigned char>(sequence.length());
+		}
+		return lengths;
+	};
+	static const Lengths JSON = make('j');
+	static const Lengths C = make('C');
+	static const Lengths HTML = make('h');
+	
+	return mode == 'C' ? C.of : mode == 'h' ? HTML.of : JSON.of;
+}
+
+/** Appends the text with its quotes doubled, as they are within quotes. */
+void appendQuotesDoubled(std::string& out, const char* begin, const char* end)
+{
+	const char* run = begin;
+	while (const void* quote = std::memchr(run, '"', static_cast<size_t>(end - run))) {
+		const char* p = static_cast<const char*>(quote) + 1;
+		out.append(run, p);
+		out += '"';
+		run = p;
+	}
+	out.append(run, end);
+}
+
+/** Quotes the value if it contains a separator, quote or line break. */
+void appendCsv(std::string& out, const char* begin, const char* end, size_t first)
+{
+	size_t length = static_cast<size_t>(end - begin);
+	if (first == length) {
+		out.append(begin, end);
+		return;
+	}
+	
+	out += '"';
+	appendQuotesDoubled(out, begin, end);
+	out += '"';
+}
+
+} // anonymous namespace
+
+bool isEscapeMode(char mode)
+{
+	return mode == 'j' || mode == 'J' || mode == 'c' || mode == 'C' || mode == 'h';
+}
+
+void appendEscaped(std::string& out, const char* begin, const char* end, char mode)
+{
+	static const FindKernel find = selectFindKernel();
+	const EscapeSet& set = escapeSet(mode);
+	
+	if (mode == 'c') {
+		appendCsv(out, begin, end, find(begin, static_cast<size_t>(end - begin), set));
+		return;
+	}
+	
+	out.reserve(out.length() + static_cast<size_t>(end - begin));
+	const char* run = begin;
+	const char* p = begin;
+	for (;;) {
+		p += find(p, static_cast<size_t>(end - p), set);
+		if (p == end)
+			break;
+		
+		unsigned char c = static_cast<unsigned char>(*p);
+		if (c >= 0x80) {
+			// Valid UTF-8 stays in the run, each invalid byte is replaced
+			while (p != end && static_cast<unsigned char>(*p) >= 0x80) {
+				size_t valid = sequenceLength(p, static_cast<size_t>(end - p));
+				if (valid != 0) {
+					p += valid;
+				} else {
+					out.append(run, p);
+					out += "\\ufffd";
+					run = ++p;
+				}
+			}
+			continue;
+		}
+		
+		out.append(run, p);
+		appendEscape(out, c, mode);
+		run = ++p;
+	}
+	out.append(run, end);
+}
+
+void appendEscapedPiece(std::string& out, const char* begin, const char* end, char mode)
+{
+	if (mode == 'c')
+		appendQuotesDoubled(out, begin, end);
+	else
+		appendEscaped(out, begin, end, mode);
+}
+
+size_t escapedPieceLength(const char* begin, const char* end, char mode, bool& quote)
+{
+	static const FindKernel find = selectFindKernel();
+	const EscapeSet& set = escapeSet(mode);
+	const unsigned char* lengths = escapeLengths(mode);
+	
+	size_t length = static_cast<size_t>(end - begin);
+	const char* p = begin;
+	for (;;) {
+		p += find(p, static_cast<size_t>(end - p), set);
+		if (p == end)
+			return length;
+		
+		unsigned char c = static_cast<unsigned char>(*p);
+		if (mode == 'c') {
+			quote = true;
+			if (c == '"')
+				++length;
+		} else if (c >= 0x80) {
+			// Each byte of invalid UTF-8 becomes \ufffd
+			while (p != end && static_cast<unsigned char>(*p) >= 0x80) {
+				size_t valid = sequenceLength(p, static_cast<size_t>(end - p));
+				if (valid != 0) {
+					p += valid;
+				} else {
+					length += 5;
+					++p;
+				}
+			}
+			continue;
+		} else {
+			length += lengths[c] - 1u;
+		}
+		++p;
+	}
+}
+
+} // namespace detail
+} // namespace fs
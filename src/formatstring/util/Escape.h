@@ -0,0 +1,46 @@
+/** @file formatstring/util/Escape.h
+ *
+ * Escaping of text for JSON, CSV, C and HTML. This header is private to the
+ * library.
+ */
+
+#ifndef FORMATSTRING_ESCAPE_H
+#define FORMATSTRING_ESCAPE_H
+
+#include <cstddef>
+#include <string>
+
+
+namespace fs {
+namespace detail {
+
+/** Returns whether mode is one of the escape modes of appendEscaped(). */
+bool isEscapeMode(char mode);
+
+/**
+ * Appends the text between begin and end escaped according to mode to out:
+ * - 'j': the content of a JSON string
+ * - 'J': the same, with each byte of invalid UTF-8 escaped as U+FFFD
+ * - 'c': a CSV value, quoted if necessary
+ * - 'C': the content of a C string literal
+ * - 'h': HTML text or attribute values
+ */
+void appendEscaped(std::string& out, const char* begin, const char* end, char mode);
+
+/**
+ * Same as appendEscaped(), but for one piece of a text that is escaped piece by
+ * piece. Pieces must not cut UTF-8 sequences. CSV values aren't enclosed in
+ * quotes, whether they need them is found by escapedPieceLength().
+ */
+void appendEscapedPiece(std::string& out, const char* begin, const char* end, char mode);
+
+/**
+ * Returns the length that appendEscapedPiece() appends for the piece, without
+ * escaping it. Sets quote if the piece makes a CSV value require quotes.
+ */
+size_t escapedPieceLength(const char* begin, const char* end, char mode, bool& quote);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_ESCAPE_H
@@ -0,0 +1,549 @@
+// formatstring/util/Replacer.cpp
+//
+// Compiled replacement rules for the string format
+
+#include "formatstring/util/Replacer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include "formatstring/util/Cpu.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+const uint32_t NO_STATE = UINT32_MAX;
+
+/** Returns the first occurrence of term between begin and end or end. */
+const char* findTerm(const char* begin, const char* end, const std::string& term)
+{
+	size_t length = term.length();
+	while (static_cast<size_t>(end - begin) >= length) {
+		size_t starts = static_cast<size_t>(end - begin) - length + 1;
+		const void* first = std::memchr(begin, term[0], starts);
+		if (first == nullptr)
+			return end;
+		const char* candidate = static_cast<const char*>(first);
+		if (std::memcmp(candidate + 1, term.data() + 1, length - 1) == 0)
+			return candidate;
+		begin = candidate + 1;
+	}
+	return end;
+}
+
+/**
+ * Appends the text with all occurrences of find replaced to out. Unless the
+ * text is the last piece, its end is held back if it could be the beginning
+ * of a match. Returns the length of the processed text.
+ */
+size_t replaceTerm(const char* begin, const char* end, const Replacer::Rule& rule,
+		std::string& out, bool last = true)
+{
+	const std::string& find = rule.first;
+	const char* text = begin;
+	for (;;) {
+		const char* match = findTerm(text, end, find);
+		if (match == end) {
+			const char* stop = last ? end
+					: end - std::min(static_cast<size_t>(end - text), find.length() - 1);
+			out.append(text, stop);
+			return static_cast<size_t>(stop - begin);
+		}
+		out.append(text, match);
+		out += rule.second;
+		text = match + find.length();
+	}
+}
+
+/** Returns whether a match of a can overlap a match of b without one containing the other. */
+bool canOverlap(const std::string& a, const std::string& b)
+{
+	size_t shorter = std::min(a.length(), b.length());
+	for (size_t overlap = 1; overlap < shorter; ++overlap) {
+		if (a.compare(a.length() - overlap, overlap, b, 0, overlap) == 0)
+			return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Byte map kernels
+
+void translateScalar(char* data, size_t length, const ByteMap& map)
+{
+	for (size_t i = 0; i < length; ++i)
+		data[i] = static_cast<char>(map.translation[static_cast<unsigned char>(data[i])]);
+}
+
+void expandScalar(const char* begin, const char* end, const ByteMap& map, std::string& out)
+{
+	const char* run = begin;
+	for (const char* p = begin; p != end; ++p) {
+		unsigned char c = static_cast<unsigned char>(*p);
+		if (map.is_special[c]) {
+			out.append(run, p);
+			out += map.expansions[c];
+			run = p + 1;
+		}
+	}
+	out.append(run, end);
+}
+
+#if FORMATSTRING_X86_SIMD
+
+// The SIMD kernels compare each block with every special byte, which is only
+// faster than a table lookup for a few of them.
+const size_t MAX_SIMD_BYTES = 8;
+
+FORMATSTRING_TARGET("sse2")
+void translateSse2(char* data, size_t length, const ByteMap& map)
+{
+	size_t count = map.special.length();
+	if (count > MAX_SIMD_BYTES)
+		return translateScalar(data, length, map);
+	
+	__m128i find[MAX_SIMD_BYTES];
+	__m128i replace[MAX_SIMD_BYTES];
+	for (size_t k = 0; k < count; ++k) {
+		unsigned char c = static_cast<unsigned char>(map.special[k]);
+		find[k] = _mm_set1_epi8(static_cast<char>(c));
+		replace[k] = _mm_set1_epi8(static_cast<char>(map.translation[c]));
+	}
+	
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i* block = reinterpret_cast<__m128i*>(data + i);
+		__m128i text = _mm_loadu_si128(block);
+		__m128i result = text;
+		for (size_t k = 0; k < count; ++k) {
+			__m128i found = _mm_cmpeq_epi8(text, find[k]);
+			result = _mm_or_si128(_mm_andnot_si128(found, result),
+					_mm_and_si128(found, replace[k]));
+		}
+		_mm_storeu_si128(block, result);
+	}
+	translateScalar(data + i, length - i, map);
+}
+
+FORMATSTRING_TARGET("avx2")
+void translateAvx2(char* data, size_t length, const ByteMap& map)
+{
+	size_t count = map.special.length();
+	if (count > MAX_SIMD_BYTES)
+		return translateScalar(data, length, map);
+	
+	__m256i find[MAX_SIMD_BYTES];
+	__m256i replace[MAX_SIMD_BYTES];
+	for (size_t k = 0; k < count; ++k) {
+		unsigned char c = static_cast<unsigned char>(map.special[k]);
+		find[k] = _mm256_set1_epi8(static_cast<char>(c));
+		replace[k] = _mm256_set1_epi8(static_cast<char>(map.translation[c]));
+	}
+	
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i* block = reinterpret_cast<__m256i*>(data + i);
+		__m256i text = _mm256_loadu_si256(block);
+		__m256i result = text;
+		for (size_t k = 0; k < count; ++k)
+			result = _mm256_blendv_epi8(result, replace[k], _mm256_cmpeq_epi8(text, find[k]));
+		_mm256_storeu_si256(block, result);
+	}
+	translateScalar(data + i, length - i, map);
+}
+
+/**
+ * Appends the runs between the special bytes in a block of the given size and
+ * the expansions of the special bytes at the set bits of mask.
+ */
+inline void expandMatches(const char* block, uint32_t mask, const char*& run,
+		const ByteMap& map, std::string& out)
+{
+	while (mask != 0) {
+		const char* p = block + __builtin_ctz(mask);
+		out.append(run, p);
+		out += map.expansions[static_cast<unsigned char>(*p)];
+		run = p + 1;
+		mask &= mask - 1;
+	}
+}
+
+FORMATSTRING_TARGET("sse2")
+void expandSse2(const char* begin, const char* end, const ByteMap& map, std::string& out)
+{
+	size_t count = map.special.length();
+	if (count > MAX_SIMD_BYTES)
+		return expandScalar(begin, end, map, out);
+	
+	__m128i find[MAX_SIMD_BYTES];
+	for (size_t k = 0; k < count; ++k)
+		find[k] = _mm_set1_epi8(map.special[k]);
+	
+	const char* run = begin;
+	const char* p = begin;
+	for (; end - p >= 16; p += 16) {
+		__m128i text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i found = _mm_cmpeq_epi8(text, find[0]);
+		for (size_t k = 1; k < count; ++k)
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(text, find[k]));
+		expandMatches(p, static_cast<uint32_t>(_mm_movemask_epi8(found)), run, map, out);
+	}
+	// Copy the last run before the tail, so that it isn't copied twice
+	out.append(run, p);
+	expandScalar(p, end, map, out);
+}
+
+FORMATSTRING_TARGET("avx2")
+void expandAvx2(const char* begin, const char* end, const ByteMap& map, std::string& out)
+{
+	size_t count = map.special.length();
+	if (count > MAX_SIMD_BYTES)
+		return expandScalar(begin, end, map, out);
+	
+	__m256i find[MAX_SIMD_BYTES];
+	for (size_t k = 0; k < count; ++k)
+		find[k] = _mm256_set1_epi8(map.special[k]);
+	
+	const char* run = begin;
+	const char* p = begin;
+	for (; end - p >= 32; p += 32) {
+		__m256i text = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i found = _mm256_cmpeq_epi8(text, find[0]);
+		for (size_t k = 1; k < count; ++k)
+			found = _mm256_or_si256(found, _mm256_cmpeq_epi8(text, find[k]));
+		expandMatches(p, static_cast<uint32_t>(_mm256_movemask_epi8(found)), run, map, out);
+	}
+	out.append(run, p);
+	expandScalar(p, end, map, out);
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using TranslateKernel = void (*)(char*, size_t, const ByteMap&);
+using ExpandKernel = void (*)(const char*, const char*, const ByteMap&, std::string&);
+
+TranslateKernel selectTranslateKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return translateAvx2;
+	if (cpu::hasSse2())
+		return translateSse2;
+#endif
+	return translateScalar;
+}
+
+ExpandKernel selectExpandKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return expandAvx2;
+	if (cpu::hasSse2())
+		return expandSse2;
+#endif
+	return expandScalar;
+}
+
+} // anonymous namespace
+
+Replacer::Replacer(const std::vector<Rule>& rules, bool at_once)
+{
+	bool single_bytes = true;
+	for (const Rule& rule: rules) {
+		if (!rule.first.empty()) {
+			rules_.push_back(rule);
+			single_bytes = single_bytes && rule.first.length() == 1;
+		}
+	}
+	for (const Rule& rule: rules_) {
+		max_length_ = std::max(max_length_, rule.first.length());
+		can_grow_ = can_grow_ || rule.second.length() > rule.first.length();
+	}
+	single_pass_ = at_once || isEquivalentToSinglePass(rules_);
+	if (!rules_.empty() && single_bytes)
+		compileByteMap();
+	else if (single_pass_ && rules_.size() > 1)
+		compile();
+}
+
+/**
+ * Sequential rules give the same result as a single pass if the matches of
+ * the rules in the original text can't overlap and no rule can match text
+ * that an earlier rule has changed. The latter needs that no later search
+ * term contains a character of a replacement, or spans the gap left by a
+ * removal.
+ */
+bool Replacer::isEquivalentToSinglePass(const std::vector<Rule>& rules)
+{
+	for (size_t i = 0; i < rules.size(); ++i) {
+		const Rule& earlier = rules[i];
+		for (size_t j = i + 1; j < rules.size(); ++j) {
+			const Rule& later = rules[j];
+			if (earlier.first.find(later.first) != std::string::npos
+					|| later.first.find(earlier.first) != std::string::npos
+					|| canOverlap(earlier.first, later.first)
+					|| canOverlap(later.first, earlier.first))
+				return false;
+			if (later.first.find_first_of(earlier.second) != std::string::npos)
+				return false;
+			if (earlier.second.empty() && later.first.length() > 1)
+				return false;
+		}
+	}
+	return true;
+}
+
+void Replacer::compile()
+{
+	// Trie of the search terms
+	nodes_.push_back(Node{0, -1});
+	transitions_.assign(256, NO_STATE);
+	for (size_t r = 0; r < rules_.size(); ++r) {
+		uint32_t state = 0;
+		for (char c: rules_[r].first) {
+			uint32_t& next = transitions_[state * 256 + static_cast<unsigned char>(c)];
+			if (next == NO_STATE) {
+				next = static_cast<uint32_t>(nodes_.size());
+				nodes_.push_back(Node{nodes_[state].depth + 1, -1});
+				transitions_.resize(transitions_.size() + 256, NO_STATE);
+			}
+			state = next;
+		}
+		if (nodes_[state].match == -1)
+			nodes_[state].match = static_cast<int32_t>(r);
+		starts_[static_cast<unsigned char>(rules_[r].first[0])] = true;
+	}
+	
+	// Breadth first, the failure state of each state is already complete and
+	// the missing transitions are taken from it
+	std::vector<uint32_t> failure(nodes_.size(), 0);
+	std::deque<uint32_t> queue;
+	for (unsigned c = 0; c < 256; ++c) {
+		uint32_t& next = transitions_[c];
+		if (next == NO_STATE)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+	while (!queue.empty()) {
+		uint32_t state = queue.front();
+		queue.pop_front();
+		const uint32_t* fallback = &transitions_[failure[state] * 256];
+		for (unsigned c = 0; c < 256; ++c) {
+			uint32_t& next = transitions_[state * 256 + c];
+			if (next == NO_STATE) {
+				next = fallback[c];
+			} else {
+				failure[next] = fallback[c];
+				if (nodes_[next].match == -1)
+					nodes_[next].match = nodes_[fallback[c]].match;
+				queue.push_back(next);
+			}
+		}
+	}
+}
+
+/**
+ * Rules with single byte search terms replace each byte independently of its
+ * neighbours. Applied one after another, they are therefore equivalent to
+ * replacing each byte by the result of all rules applied to that byte alone.
+ */
+void Replacer::compileByteMap()
+{
+	byte_rules_ = true;
+	byte_map_.translate = true;
+	byte_map_.expansions.resize(256);
+	for (unsigned b = 0; b < 256; ++b) {
+		std::string& expansion = byte_map_.expansions[b];
+		expansion.assign(1, static_cast<char>(b));
+		for (const Rule& rule: rules_) {
+			if (single_pass_) {
+				if (rule.first[0] == expansion[0]) {
+					expansion = rule.second;
+					break;
+				}
+			} else {
+				std::string next;
+				replaceTerm(expansion.data(), expansion.data() + expansion.length(), rule, next);
+				expansion.swap(next);
+			}
+		}
+		
+		bool special = expansion.length() != 1 || expansion[0] != static_cast<char>(b);
+		byte_map_.is_special[b] = special;
+		if (special)
+			byte_map_.special += static_cast<char>(b);
+		if (expansion.length() == 1)
+			byte_map_.translation[b] = static_cast<unsigned char>(expansion[0]);
+		else
+			byte_map_.translate = false;
+	}
+	if (byte_map_.translate)
+		byte_map_.expansions.clear();
+}
+
+void Replacer::apply(const char* begin, const char* end, std::string& out) const
+{
+	static const TranslateKernel translate = selectTranslateKernel();
+	static const ExpandKernel expand = selectExpandKernel();
+	
+	if (rules_.empty() || (byte_rules_ && byte_map_.special.empty())) {
+		out.append(begin, end);
+	} else if (byte_rules_ && byte_map_.translate) {
+		// Copied as a whole and translated in place
+		size_t offset = out.length();
+		out.append(begin, end);
+		translate(&out[offset], out.length() - offset, byte_map_);
+	} else if (byte_rules_) {
+		expand(begin, end, byte_map_, out);
+	} else if (rules_.size() == 1) {
+		// memchr() finds a single search term faster than the automaton
+		replaceTerm(begin, end, rules_[0], out);
+	} else if (single_pass_) {
+		applySinglePass(begin, end, out, true);
+	} else {
+		std::string current;
+		replaceTerm(begin, end, rules_[0], current);
+		std::string next;
+		for (size_t r = 1; r + 1 < rules_.size(); ++r) {
+			next.clear();
+			replaceTerm(current.data(), current.data() + current.length(), rules_[r], next);
+			current.swap(next);
+		}
+		replaceTerm(current.data(), current.data() + current.length(), rules_.back(), out);
+	}
+}
+
+size_t Replacer::applyPass(size_t pass, const char* begin, const char* end,
+		std::string& out, bool last) const
+{
+	if (isMultiPass())
+		return replaceTerm(begin, end, rules_[pass], out, last);
+	if (!byte_rules_ && rules_.size() == 1)
+		return replaceTerm(begin, end, rules_[0], out, last);
+	if (!byte_rules_ && !rules_.empty())
+		return applySinglePass(begin, end, out, last);
+	
+	// Single bytes never span pieces
+	apply(begin, end, out);
+	return static_cast<size_t>(end - begin);
+}
+
+/**
+ * A match is only replaced once no match can start before or at the same
+ * position anymore, i.e. once the automaton state is shorter than the text
+ * since the start of the match. Text after the replaced match is read again.
+ *
+ * If this isn't the last piece, the text of the final automaton state is
+ * held back. No match can start before it, so reading the text again from
+ * there with a new automaton gives the same result.
+ */
+size_t Replacer::applySinglePass(const char* begin, const char* end, std::string& out,
+		bool last) const
+{
+	const unsigned char* text = reinterpret_cast<const unsigned char*>(begin);
+	size_t length = static_cast<size_t>(end - begin);
+	size_t pos = 0;
+	size_t emitted = 0;
+	uint32_t state = 0;
+	int32_t best = -1;
+	size_t best_start = 0;
+	
+	for (;;) {
+		if (best != -1 && ((last && pos == length) || pos - nodes_[state].depth > best_start)) {
+			out.append(begin + emitted, best_start - emitted);
+			out += rules_[static_cast<size_t>(best)].second;
+			pos = emitted = best_start + rules_[static_cast<size_t>(best)].first.length();
+			state = 0;
+			best = -1;
+		}
+		if (state == 0) {
+			while (pos < length && !starts_[text[pos]])
+				++pos;
+		}
+		if (pos == length)
+			break;
+		
+		state = transitions_[state * 256 + text[pos]];
+		++pos;
+		int32_t match = nodes_[state].match;
+		if (match != -1) {
+			size_t start = pos - rules_[static_cast<size_t>(match)].first.length();
+			if (best == -1 || start <= best_start) {
+				best = match;
+				best_start = start;
+			}
+		}
+	}
+	
+	size_t processed = last ? length : pos - nodes_[state].depth;
+	out.append(begin + emitted, processed - emitted);
+	return processed;
+}
+
+//------------------------------------------------------------------------------
+
+Replacer::Stream::Stream(const Replacer& replacer):
+		replacer_(replacer),
+		held_(replacer.isMultiPass() ? replacer.rules_.size() : 1),
+		results_(held_.size() - 1)
+{
+}
+
+void Replacer::Stream::write(const char* begin, const char* end, std::string& out)
+{
+	writePass(0, begin, end, out, false);
+}
+
+void Replacer::Stream::finish(std::string& out)
+{
+	const char* none = "";
+	writePass(0, none, none, out, true);
+}
+
+/**
+ * The text held back from the previous piece is joined with just enough of
+ * the new one to be processed, the rest of the piece is processed in place.
+ */
+void Replacer::Stream::writePass(size_t pass, const char* begin, const char* end,
+		std::string& out, bool last)
+{
+	bool final_pass = pass + 1 == held_.size();
+	std::string& result = final_pass ? out : results_[pass];
+	if (!final_pass)
+		result.clear();
+	
+	std::string& held = held_[pass];
+	const char* text = begin;
+	if (!held.empty()) {
+		size_t length = held.length();
+		size_t joined = std::min(static_cast<size_t>(end - begin), replacer_.max_length_);
+		held.append(begin, joined);
+		size_t processed = replacer_.applyPass(pass, held.data(), held.data() + held.length(),
+				result, last && begin + joined == end);
+		
+		// At most max_length_ - 1 bytes are held back, so the whole piece has
+		// been joined if less than the held text was processed
+		if (processed < length) {
+			held.erase(0, processed);
+			text = end;
+		} else {
+			held.clear();
+			text = begin + (processed - length);
+		}
+	}
+	if (text != end || last) {
+		size_t processed = replacer_.applyPass(pass, text, end, result, last);
+		held.assign(text + processed, end);
+	}
+	
+	if (!final_pass)
+		writePass(pass + 1, result.data(), result.data() + result.length(), out, last);
+}
+
+} // namespace detail
+} // namespace fs
@@ -0,0 +1,140 @@
+/** @file formatstring/util/Replacer.h
+ *
+ * Replacement rules of the string format, compiled into an Aho-Corasick
+ * automaton. This header is private to the library.
+ */
+
+#ifndef FORMATSTRING_REPLACER_H
+#define FORMATSTRING_REPLACER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace fs {
+namespace detail {
+
+/**
+ * The effect of rules whose search terms are all single bytes: each byte of
+ * the text is replaced by its expansion, independently of the others.
+ */
+struct ByteMap {
+	std::string special;                  // Bytes that don't stay the same
+	bool is_special[256];
+	bool translate;                       // Whether all expansions are single bytes
+	unsigned char translation[256];       // Replacement of each byte if translate
+	std::vector<std::string> expansions;  // Replacement of each byte otherwise
+};
+
+/**
+ * A list of replacement rules that is compiled once and can be applied to
+ * many strings.
+ *
+ * The rules can either be applied one after another, each to the result of
+ * the previous one, or all at once in a single pass over the text. In a single
+ * pass, the leftmost match is replaced, the longest one if several start at
+ * the same position, and replaced text isn't searched again. Sequential rules
+ * are applied in a single pass as well if that provably gives the same result,
+ * e.g. if no rule can match text that an earlier rule has replaced.
+ *
+ * If all search terms are single bytes, the rules are turned into a ByteMap
+ * instead, which is applied with SIMD kernels where available.
+ */
+class Replacer
+{
+public:
+	typedef std::pair<std::string, std::string> Rule;
+	
+	/** Creates a Replacer that doesn't change anything. */
+	Replacer() = default;
+	
+	/**
+	 * Compiles the rules, given as pairs of search and replacement terms.
+	 * Rules with an empty search term are ignored.
+	 */
+	Replacer(const std::vector<Rule>& rules, bool at_once);
+	
+	/** Returns whether there are no rules. */
+	bool empty() const { return rules_.empty(); }
+	
+	/** Returns whether the rules are applied in a single pass. */
+	bool isSinglePass() const { return single_pass_; }
+	
+	/** Returns whether the rules can make a text longer. */
+	bool canGrow() const { return can_grow_; }
+	
+	/** Appends the text between begin and end with all rules applied to out. */
+	void apply(const char* begin, const char* end, std::string& out) const;
+	
+	/**
+	 * Applies the rules to a text that is given piece by piece, so that it
+	 * never has to be held as a whole. Text at the end of a piece that could
+	 * be the beginning of a match is held back until the next piece.
+	 */
+	class Stream
+	{
+	public:
+		/** Creates a Stream, the replacer must outlive it. */
+		explicit Stream(const Replacer& replacer);
+		
+		/** Appends the replaced text to out as far as it is certain. */
+		void write(const char* begin, const char* end, std::string& out);
+		
+		/** Appends the rest of the replaced text to out. */
+		void finish(std::string& out);
+	
+	private:
+		void writePass(size_t pass, const char* begin, const char* end,
+				std::string& out, bool last);
+		
+		const Replacer& replacer_;
+		std::vector<std::string> held_;     // Text held back by each pass
+		std::vector<std::string> results_;  // Output of each pass but the last
+	};
+
+private:
+	/** State of the automaton. */
+	struct Node {
+		uint32_t depth;
+		int32_t match;  // Rule of the longest search term ending here or -1
+	};
+	
+	static bool isEquivalentToSinglePass(const std::vector<Rule>& rules);
+	
+	void compile();
+	
+	void compileByteMap();
+	
+	/** Returns whether each rule is applied in a pass of its own. */
+	bool isMultiPass() const { return !single_pass_ && !byte_rules_ && rules_.size() > 1; }
+	
+	/**
+	 * Applies the rule of the given pass if isMultiPass(), otherwise all of
+	 * them, to the text. Unless it is the last piece of the text, the part at
+	 * its end that could be the beginning of a match is left out. Returns the
+	 * length of the processed part.
+	 */
+	size_t applyPass(size_t pass, const char* begin, const char* end,
+			std::string& out, bool last) const;
+	
+	size_t applySinglePass(const char* begin, const char* end, std::string& out,
+			bool last) const;
+	
+	std::vector<Rule> rules_;
+	size_t max_length_ = 0;  // Of the search terms
+	bool single_pass_ = false;
+	bool byte_rules_ = false;
+	bool can_grow_ = false;  // Whether a replacement is longer than its search term
+	ByteMap byte_map_ {};
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> transitions_;  // 256 next states per state
+	bool starts_[256] = {};              // Whether a search term starts with the byte
+};
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_REPLACER_H
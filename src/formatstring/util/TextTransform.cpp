@@ -0,0 +1,266 @@
+// formatstring/util/TextTransform.cpp
+//
+// Case mapping and whitespace trimming of UTF-8 text
+
+#include "formatstring/util/TextTransform.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "formatstring/util/CaseTables.h"
+#include "formatstring/util/Cpu.h"
+#include "formatstring/util/Utf8.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Kernels that find the first and last byte which isn't ASCII whitespace
+
+bool isSpace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+void trimScalar(const char* text, size_t length, size_t& first, size_t& last)
+{
+	first = 0;
+	while (first < length && isSpace(text[first]))
+		++first;
+	last = length;
+	while (last > first && isSpace(text[last - 1]))
+		--last;
+}
+
+#if FORMATSTRING_X86_SIMD
+
+FORMATSTRING_TARGET("sse2")
+unsigned spaceMaskSse2(const char* text)
+{
+	__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+	// Bytes from 0x80 are negative and never in the range of the controls
+	__m128i controls = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('\t' - 1)),
+			_mm_cmpgt_epi8(_mm_set1_epi8('\r' + 1), x));
+	__m128i space = _mm_or_si128(controls, _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+	return static_cast<unsigned>(_mm_movemask_epi8(space));
+}
+
+FORMATSTRING_TARGET("sse2")
+void trimSse2(const char* text, size_t length, size_t& first, size_t& last)
+{
+	first = 0;
+	for (; first + 16 <= length; first += 16) {
+		unsigned mask = ~spaceMaskSse2(text + first) & 0xffffu;
+		if (mask != 0) {
+			first += static_cast<size_t>(__builtin_ctz(mask));
+			break;
+		}
+	}
+	while (first < length && isSpace(text[first]))
+		++first;
+	
+	last = length;
+	for (; last >= first + 16; last -= 16) {
+		unsigned mask = ~spaceMaskSse2(text + last - 16) & 0xffffu;
+		if (mask != 0) {
+			last -= static_cast<size_t>(__builtin_clz(mask)) - 16;
+			return;
+		}
+	}
+	while (last > first && isSpace(text[last - 1]))
+		--last;
+}
+
+FORMATSTRING_TARGET("avx2")
+uint32_t spaceMaskAvx2(const char* text)
+{
+	__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+	__m256i controls = _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8('\t' - 1)),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), x));
+	__m256i space = _mm256_or_si256(controls, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(space));
+}
+
+FORMATSTRING_TARGET("avx2")
+void trimAvx2(const char* text, size_t length, size_t& first, size_t& last)
+{
+	first = 0;
+	for (; first + 32 <= length; first += 32) {
+		uint32_t mask = ~spaceMaskAvx2(text + first);
+		if (mask != 0) {
+			first += static_cast<size_t>(__builtin_ctz(mask));
+			break;
+		}
+	}
+	while (first < length && isSpace(text[first]))
+		++first;
+	
+	last = length;
+	for (; last >= first + 32; last -= 32) {
+		uint32_t mask = ~spaceMaskAvx2(text + last - 32);
+		if (mask != 0) {
+			last -= static_cast<size_t>(__builtin_clz(mask));
+			return;
+		}
+	}
+	while (last > first && isSpace(text[last - 1]))
+		--last;
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using TrimKernel = void (*)(const char*, size_t, size_t&, size_t&);
+
+TrimKernel selectTrimKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return trimAvx2;
+	if (cpu::hasSse2())
+		return trimSse2;
+#endif
+	return trimScalar;
+}
+
+//------------------------------------------------------------------------------
+// Kernels that map the case of ASCII text until the first other byte and
+// return the number of bytes written
+
+size_t mapAsciiScalar(const char* text, size_t length, char* out, char first_letter)
+{
+	for (size_t i = 0; i < length; ++i) {
+		char c = text[i];
+		if (static_cast<unsigned char>(c) >= 0x80)
+			return i;
+		if (c >= first_letter && c <= first_letter + 25)
+			c = static_cast<char>(c ^ 0x20);
+		out[i] = c;
+	}
+	return length;
+}
+
+#if FORMATSTRING_X86_SIMD
+
+FORMATSTRING_TARGET("sse2")
+size_t mapAsciiSse2(const char* text, size_t length, char* out, char first_letter)
+{
+	const __m128i below_first = _mm_set1_epi8(static_cast<char>(first_letter - 1));
+	const __m128i after_last = _mm_set1_epi8(static_cast<char>(first_letter + 26));
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+	
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		if (_mm_movemask_epi8(x) != 0)
+			break;
+		__m128i letters = _mm_and_si128(_mm_cmpgt_epi8(x, below_first),
+				_mm_cmpgt_epi8(after_last, x));
+		x = _mm_xor_si128(x, _mm_and_si128(letters, case_bit));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+	}
+	return i + mapAsciiScalar(text + i, length - i, out + i, first_letter);
+}
+
+FORMATSTRING_TARGET("avx2")
+size_t mapAsciiAvx2(const char* text, size_t length, char* out, char first_letter)
+{
+	const __m256i below_first = _mm256_set1_epi8(static_cast<char>(first_letter - 1));
+	const __m256i after_last = _mm256_set1_epi8(static_cast<char>(first_letter + 26));
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+	
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+		if (_mm256_movemask_epi8(x) != 0)
+			break;
+		__m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(x, below_first),
+				_mm256_cmpgt_epi8(after_last, x));
+		x = _mm256_xor_si256(x, _mm256_and_si256(letters, case_bit));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+	}
+	return i + mapAsciiScalar(text + i, length - i, out + i, first_letter);
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using MapAsciiKernel = size_t (*)(const char*, size_t, char*, char);
+
+MapAsciiKernel selectMapAsciiKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return mapAsciiAvx2;
+	if (cpu::hasSse2())
+		return mapAsciiSse2;
+#endif
+	return mapAsciiScalar;
+}
+
+//------------------------------------------------------------------------------
+
+template <size_t N>
+uint32_t mapCodePoint(const CaseRange (&table)[N], uint32_t code_point)
+{
+	const CaseRange* range = std::lower_bound(table, table + N, code_point,
+			[](const CaseRange& r, uint32_t c) { return r.last < c; });
+	if (range == table + N || range->first > code_point
+			|| (code_point - range->first) % range->stride != 0)
+		return code_point;
+	return static_cast<uint32_t>(static_cast<int32_t>(code_point) + range->delta);
+}
+
+} // anonymous namespace
+
+void trimSpace(const char*& begin, const char*& end)
+{
+	static const TrimKernel kernel = selectTrimKernel();
+	size_t first;
+	size_t last;
+	kernel(begin, static_cast<size_t>(end - begin), first, last);
+	end = begin + last;
+	begin += first;
+}
+
+void appendCaseMapped(std::string& out, const char* begin, const char* end, char mode)
+{
+	static const MapAsciiKernel map_ascii = selectMapAsciiKernel();
+	const char first_letter = mode == 'u' ? 'a' : 'A';
+	
+	// The output has the length of the input unless a mapping changes the
+	// length of a UTF-8 sequence
+	size_t pos = out.length();
+	out.resize(pos + static_cast<size_t>(end - begin));
+	for (;;) {
+		size_t ascii = map_ascii(begin, static_cast<size_t>(end - begin), &out[pos], first_letter);
+		begin += ascii;
+		pos += ascii;
+		if (begin == end)
+			break;
+		
+		const char* sequence = begin;
+		uint32_t code_point = decodeCodePoint(begin, end);
+		char encoded[4];
+		size_t length;
+		if (code_point == INVALID_CODE_POINT) {
+			encoded[0] = *sequence;
+			length = 1;
+		} else {
+			code_point = mode == 'u' ? mapCodePoint(TO_UPPER, code_point)
+					: mapCodePoint(TO_LOWER, code_point);
+			length = encodeCodePoint(code_point, encoded);
+		}
+		
+		size_t needed = pos + length + static_cast<size_t>(end - begin);
+		if (needed > out.length())
+			out.resize(needed);
+		std::copy(encoded, encoded + length, &out[pos]);
+		pos += length;
+	}
+	out.resize(pos);
+}
+
+} // namespace detail
+} // namespace fs
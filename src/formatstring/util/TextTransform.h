@@ -0,0 +1,30 @@
+/** @file formatstring/util/TextTransform.h
+ *
+ * Case mapping and whitespace trimming of UTF-8 text. This header is private
+ * to the library.
+ */
+
+#ifndef FORMATSTRING_TEXTTRANSFORM_H
+#define FORMATSTRING_TEXTTRANSFORM_H
+
+#include <string>
+
+
+namespace fs {
+namespace detail {
+
+/** Moves begin and end past the ASCII whitespace around the text. */
+void trimSpace(const char*& begin, const char*& end);
+
+/**
+ * Appends the text between begin and end to out with all letters mapped to
+ * upper case for mode 'u' or to lower case for mode 'l'. Other characters
+ * than ASCII letters get the simple case mapping of Unicode, and bytes that
+ * aren't valid UTF-8 are copied unchanged.
+ */
+void appendCaseMapped(std::string& out, const char* begin, const char* end, char mode);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_TEXTTRANSFORM_H
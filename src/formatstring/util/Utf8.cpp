@@ -0,0 +1,259 @@
+// formatstring/util/Utf8.cpp
+//
+// Code point and display width handling of UTF-8 text
+
+#include "formatstring/util/Utf8.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "formatstring/util/Cpu.h"
+#include "formatstring/util/Utf8Tables.h"
+
+
+namespace fs {
+namespace detail {
+
+namespace {
+
+//------------------------------------------------------------------------------
+// ASCII detection kernels
+
+bool isAsciiScalar(const char* text, size_t length)
+{
+	const uint64_t high_bits = 0x8080808080808080ull;
+	size_t i = 0;
+	uint64_t any = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t block;
+		std::memcpy(&block, text + i, sizeof(block));
+		any |= block;
+	}
+	for (; i < length; ++i)
+		any |= static_cast<unsigned char>(text[i]);
+	return (any & high_bits) == 0;
+}
+
+#if FORMATSTRING_X86_SIMD
+
+FORMATSTRING_TARGET("sse2")
+bool isAsciiSse2(const char* text, size_t length)
+{
+	size_t i = 0;
+	__m128i any = _mm_setzero_si128();
+	for (; i + 16 <= length; i += 16)
+		any = _mm_or_si128(any, _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)));
+	return _mm_movemask_epi8(any) == 0 && isAsciiScalar(text + i, length - i);
+}
+
+FORMATSTRING_TARGET("avx2")
+bool isAsciiAvx2(const char* text, size_t length)
+{
+	size_t i = 0;
+	__m256i any = _mm256_setzero_si256();
+	for (; i + 32 <= length; i += 32)
+		any = _mm256_or_si256(any, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i)));
+	return _mm256_movemask_epi8(any) == 0 && isAsciiScalar(text + i, length - i);
+}
+
+#endif // FORMATSTRING_X86_SIMD
+
+using AsciiKernel = bool (*)(const char*, size_t);
+
+AsciiKernel selectAsciiKernel()
+{
+#if FORMATSTRING_X86_SIMD
+	if (cpu::hasAvx2())
+		return isAsciiAvx2;
+	if (cpu::hasSse2())
+		return isAsciiSse2;
+#endif
+	return isAsciiScalar;
+}
+
+//------------------------------------------------------------------------------
+// Decoding
+
+/** Decodes the code point at p and moves p behind it. */
+uint32_t decode(const unsigned char*& p, const unsigned char* end)
+{
+	unsigned char lead = *p++;
+	if (lead < 0x80)
+		return lead;
+	
+	size_t count;
+	uint32_t code_point;
+	uint32_t smallest;
+	if ((lead & 0xe0) == 0xc0) {
+		count = 1;
+		code_point = lead & 0x1f;
+		smallest = 0x80;
+	} else if ((lead & 0xf0) == 0xe0) {
+		count = 2;
+		code_point = lead & 0x0f;
+		smallest = 0x800;
+	} else if ((lead & 0xf8) == 0xf0) {
+		count = 3;
+		code_point = lead & 0x07;
+		smallest = 0x10000;
+	} else {
+		return INVALID_CODE_POINT;
+	}
+	
+	if (static_cast<size_t>(end - p) < count)
+		return INVALID_CODE_POINT;
+	for (size_t i = 0; i < count; ++i) {
+		if ((p[i] & 0xc0) != 0x80)
+			return INVALID_CODE_POINT;
+		code_point = (code_point << 6) | (p[i] & 0x3f);
+	}
+	// Overlong encodings, surrogates and values beyond Unicode
+	if (code_point < smallest || code_point > 0x10ffff
+			|| (code_point >= 0xd800 && code_point <= 0xdfff))
+		return INVALID_CODE_POINT;
+	
+	p += count;
+	return code_point;
+}
+
+template <size_t N>
+bool contains(const CodePointRange (&table)[N], uint32_t code_point)
+{
+	const CodePointRange* range = std::lower_bound(table, table + N, code_point,
+			[](const CodePointRange& r, uint32_t c) { return r.last < c; });
+	return range != table + N && range->first <= code_point;
+}
+
+size_t columns(uint32_t code_point)
+{
+	if (code_point < 0x300)
+		return 1;
+	if (contains(ZERO_WIDTH, code_point))
+		return 0;
+	if (code_point >= 0x1100 && contains(WIDE, code_point))
+		return 2;
+	return 1;
+}
+
+} // anonymous namespace
+
+bool isAscii(const char* text, size_t length)
+{
+	static const AsciiKernel kernel = selectAsciiKernel();
+	if (length < 16)
+		return isAsciiScalar(text, length);
+	return kernel(text, length);
+}
+
+size_t displayWidth(const char* text, size_t length)
+{
+	if (isAscii(text, length))
+		return length;
+	
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+	const unsigned char* end = p + length;
+	size_t width = 0;
+	while (p != end)
+		width += columns(decode(p, end));
+	return width;
+}
+
+size_t fitToWidth(const char* text, size_t length, size_t width)
+{
+	// An ASCII beginning fits byte by byte, unless a combining mark follows
+	if (width >= length && isAscii(text, length))
+		return length;
+	if (width < length && isAscii(text, width) && static_cast<unsigned char>(text[width]) < 0x80)
+		return width;
+	
+	const unsigned char* begin = reinterpret_cast<const unsigned char*>(text);
+	const unsigned char* end = begin + length;
+	const unsigned char* p = begin;
+	size_t used = 0;
+	while (p != end) {
+		const unsigned char* next = p;
+		size_t w = columns(decode(next, end));
+		if (used + w > width)
+			break;
+		used += w;
+		p = next;
+	}
+	return static_cast<size_t>(p - begin);
+}
+
+size_t sequenceLength(const char* text, size_t length)
+{
+	if (length == 0)
+		return 0;
+	
+	const unsigned char* begin = reinterpret_cast<const unsigned char*>(text);
+	const unsigned char* p = begin;
+	if (decode(p, begin + length) == INVALID_CODE_POINT)
+		return 0;
+	return static_cast<size_t>(p - begin);
+}
+
+size_t codePointOffset(const char* text, size_t length, size_t index)
+{
+	// There are never more code points than bytes
+	if (index >= length)
+		return length;
+	if (isAscii(text, index))
+		return index;
+	
+	const unsigned char* begin = reinterpret_cast<const unsigned char*>(text);
+	const unsigned char* end = begin + length;
+	const unsigned char* p = begin;
+	for (size_t i = 0; i < index && p != end; ++i)
+		decode(p, end);
+	return static_cast<size_t>(p - begin);
+}
+
+size_t completeLength(const char* text, size_t length)
+{
+	// A sequence has at most three continuation bytes
+	for (size_t back = 1; back <= 3 && back <= length; ++back) {
+		unsigned char c = static_cast<unsigned char>(text[length - back]);
+		if ((c & 0xc0) != 0x80) {
+			size_t expected = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+			return expected > back ? length - back : length;
+		}
+	}
+	return length;
+}
+
+uint32_t decodeCodePoint(const char*& text, const char* end)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+	uint32_t code_point = decode(p, reinterpret_cast<const unsigned char*>(end));
+	text = reinterpret_cast<const char*>(p);
+	return code_point;
+}
+
+size_t encodeCodePoint(uint32_t code_point, char* out)
+{
+	if (code_point < 0x80) {
+		out[0] = static_cast<char>(code_point);
+		return 1;
+	}
+	if (code_point < 0x800) {
+		out[0] = static_cast<char>(0xc0 | (code_point >> 6));
+		out[1] = static_cast<char>(0x80 | (code_point & 0x3f));
+		return 2;
+	}
+	if (code_point < 0x10000) {
+		out[0] = static_cast<char>(0xe0 | (code_point >> 12));
+		out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+		out[2] = static_cast<char>(0x80 | (code_point & 0x3f));
+		return 3;
+	}
+	out[0] = static_cast<char>(0xf0 | (code_point >> 18));
+	out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+	out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+	out[3] = static_cast<char>(0x80 | (code_point & 0x3f));
+	return 4;
+}
+
+} // namespace detail
+} // namespace fs
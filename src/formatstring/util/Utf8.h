@@ -0,0 +1,70 @@
+/** @file formatstring/util/Utf8.h
+ *
+ * Measuring and cutting UTF-8 text by code points and display columns. This
+ * header is private to the library.
+ */
+
+#ifndef FORMATSTRING_UTF8_H
+#define FORMATSTRING_UTF8_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+
+/** Returns whether the text only consists of ASCII characters. */
+bool isAscii(const char* text, size_t length);
+
+/**
+ * Returns the number of columns the text takes on a terminal. East Asian wide
+ * characters take two columns, combining marks none and all others one. Bytes
+ * that aren't valid UTF-8 take one column each.
+ */
+size_t displayWidth(const char* text, size_t length);
+
+/**
+ * Returns the length in bytes of the longest beginning of the text that takes
+ * at most width columns. Code points are never cut, and combining marks stay
+ * with the character before them.
+ */
+size_t fitToWidth(const char* text, size_t length, size_t width);
+
+/**
+ * Returns the length of the valid UTF-8 sequence at the beginning of the text,
+ * or 0 if it doesn't start with one.
+ */
+size_t sequenceLength(const char* text, size_t length);
+
+/**
+ * Returns the byte offset of the code point with the given index, or the
+ * length if the text has fewer code points.
+ */
+size_t codePointOffset(const char* text, size_t length, size_t index);
+
+/**
+ * Returns the length of the text without an incomplete UTF-8 sequence at its
+ * end, so that the text can be cut there without cutting a code point.
+ */
+size_t completeLength(const char* text, size_t length);
+
+/** Returned by decodeCodePoint() for each byte that isn't valid UTF-8. */
+const uint32_t INVALID_CODE_POINT = UINT32_MAX;
+
+/**
+ * Decodes the code point at text and moves text behind it, or returns
+ * INVALID_CODE_POINT and moves text by one byte if it isn't valid UTF-8.
+ */
+uint32_t decodeCodePoint(const char*& text, const char* end);
+
+/**
+ * Writes the UTF-8 sequence of the code point to out, which must have room for
+ * four bytes, and returns its length.
+ */
+size_t encodeCodePoint(uint32_t code_point, char* out);
+
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_UTF8_H
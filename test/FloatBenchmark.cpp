@@ -0,0 +1,208 @@
+// test/FloatBenchmark.cpp
+//
+// Compares the digit generators for doubles and floats on random values and
+// measures the whole conversion with toString() and formatDoubles(), fixed-point
+// decimals, and reading the output back with scan().
+
+#include "formatstring/Scan.h"
+#include "formatstring/ToString.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+/** Splits a finite double into significand and exponent like toString() does. */
+fs::detail::fp decompose(double value)
+{
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	
+	int32_t e_ieee = static_cast<int32_t>((bits >> 52) & 0x7ff);
+	uint64_t f_ieee = bits & ((1ull << 52) - 1);
+	if (e_ieee != 0)
+		f_ieee |= 1ull << 52;
+	else
+		f_ieee <<= 1;
+	return {f_ieee, e_ieee - 1023 - 52};
+}
+
+/** Splits a finite float into significand and exponent. */
+fs::detail::fp decompose(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	
+	int32_t e_ieee = static_cast<int32_t>((bits >> 23) & 0xff);
+	uint32_t f_ieee = bits & ((1u << 23) - 1);
+	if (e_ieee != 0)
+		f_ieee |= 1u << 23;
+	else
+		f_ieee <<= 1;
+	return {f_ieee, e_ieee - 127 - 23};
+}
+
+/** Runs f on all values and returns the time per value in nanoseconds. */
+template <typename T, typename F>
+double measure(const std::vector<T>& values, F f)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (T value: values)
+		f(value);
+	std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+	return time.count() / static_cast<double>(values.size());
+}
+
+} // anonymous namespace
+
+int main()
+{
+	// Random bit patterns cover all exponents evenly
+	std::mt19937_64 random(42);
+	std::vector<double> values;
+	while (values.size() < 1000000) {
+		uint64_t bits = random();
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		if (value == value && value - value == 0)
+			values.push_back(value);
+	}
+	
+	size_t checksum = 0;
+	size_t longer = 0;
+	for (double value: values) {
+		if (fs::detail::grisu2(decompose(value)).length
+				> fs::detail::ryu(decompose(value)).length)
+			++longer;
+	}
+	
+	double grisu2 = measure(values, [&](double value) {
+		checksum += static_cast<size_t>(fs::detail::grisu2(decompose(value)).length);
+	});
+	double ryu = measure(values, [&](double value) {
+		checksum += static_cast<size_t>(fs::detail::ryu(decompose(value)).length);
+	});
+	double to_string = measure(values, [&](double value) {
+		checksum += fs::toString(value).length();
+	});
+	
+	// A whole column at once, one value after the other or with all cores
+	size_t column_length = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (double value: values)
+		column_length += fs::toString(value).length() + 1;
+	std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+	double join = time.count() / static_cast<double>(values.size());
+	start = std::chrono::steady_clock::now();
+	column_length += fs::formatDoubles(values, "").length();
+	time = std::chrono::steady_clock::now() - start;
+	double batch = time.count() / static_cast<double>(values.size());
+	start = std::chrono::steady_clock::now();
+	column_length += fs::formatDoubles(values, "", ",", 0).length();
+	time = std::chrono::steady_clock::now() - start;
+	double batch_threads = time.count() / static_cast<double>(values.size());
+	checksum += column_length;
+	
+	// Reading the shortest output back, compared with strtod()
+	std::vector<std::string> texts;
+	for (double value: values)
+		texts.push_back(fs::toString(value));
+	double read = 0;
+	start = std::chrono::steady_clock::now();
+	for (const std::string& text: texts)
+		checksum += fs::scan(text, "{}", read) + (read > 0 ? 1 : 0);
+	time = std::chrono::steady_clock::now() - start;
+	double scan = time.count() / static_cast<double>(texts.size());
+	start = std::chrono::steady_clock::now();
+	for (const std::string& text: texts)
+		checksum += std::strtod(text.c_str(), nullptr) > 0 ? 1 : 0;
+	time = std::chrono::steady_clock::now() - start;
+	double strtod = time.count() / static_cast<double>(texts.size());
+	
+	// Floats from random bit patterns as well
+	std::vector<float> floats;
+	while (floats.size() < values.size()) {
+		uint32_t bits = static_cast<uint32_t>(random());
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		if (value == value && value - value == 0)
+			floats.push_back(value);
+	}
+	size_t longer_floats = 0;
+	for (float value: floats) {
+		if (fs::detail::grisu2(decompose(value)).length
+				> fs::detail::ryuFloat(decompose(value)).length)
+			++longer_floats;
+	}
+	double grisu2_float = measure(floats, [&](float value) {
+		checksum += static_cast<size_t>(fs::detail::grisu2(decompose(value)).length);
+	});
+	double ryu_float = measure(floats, [&](float value) {
+		checksum += static_cast<size_t>(fs::detail::ryuFloat(decompose(value)).length);
+	});
+	double to_string_float = measure(floats, [&](float value) {
+		checksum += fs::toString(value).length();
+	});
+	
+	// Fixed precision, where digits beyond the shortest ones have to be exact
+	fs::Numformat fixed3 = fs::detail::parseFloatformat(".3f");
+	fs::Numformat fixed30 = fs::detail::parseFloatformat(".30f");
+	std::vector<double> small;
+	for (double value: values) {
+		int exponent;
+		double fraction = std::frexp(value, &exponent);
+		small.push_back(std::ldexp(fraction, exponent % 20));
+	}
+	std::string out;
+	double precision3 = measure(small, [&](double value) {
+		out.clear();
+		fs::detail::appendFloat(out, value, fixed3);
+		checksum += out.length();
+	});
+	double precision30 = measure(small, [&](double value) {
+		out.clear();
+		fs::detail::appendFloat(out, value, fixed30);
+		checksum += out.length();
+	});
+	
+	// Scaled integers printed with two decimals, exactly or through a double
+	fs::Numformat decimal2 = fs::detail::parseDecimalformat(".2");
+	fs::Numformat fixed2 = fs::detail::parseFloatformat(".2f");
+	std::vector<int64_t> units;
+	for (size_t i = 0; i < values.size(); ++i)
+		units.push_back(static_cast<int64_t>(random() % 10000000000ull));
+	double decimal = measure(units, [&](int64_t value) {
+		out.clear();
+		fs::detail::appendDecimal(out, fs::ScaledDecimal(value, 4), decimal2);
+		checksum += out.length();
+	});
+	double scaled_double = measure(units, [&](int64_t value) {
+		out.clear();
+		fs::detail::appendFloat(out, static_cast<double>(value) * 1e-4, fixed2);
+		checksum += out.length();
+	});
+	
+	std::cout << "grisu2:     " << grisu2 << " ns/value, not shortest for "
+	          << longer << " of " << values.size() << " values\n"
+	          << "ryu:        " << ryu << " ns/value\n"
+	          << "toString(): " << to_string << " ns/value\n"
+	          << "\".3f\":      " << precision3 << " ns/value\n"
+	          << "\".30f\":     " << precision30 << " ns/value\n"
+	          << "Decimal<4> \".2\": " << decimal << " ns/value, as double \".2f\": "
+	          << scaled_double << " ns/value\n"
+	          << "joined toString(): " << join << " ns/value\n"
+	          << "formatDoubles():   " << batch << " ns/value, "
+	          << batch_threads << " ns/value on all cores\n"
+	          << "scan():      " << scan << " ns/value, strtod(): " << strtod << " ns/value\n"
+	          << "float grisu2:     " << grisu2_float << " ns/value, not shortest for "
+	          << longer_floats << " of " << floats.size() << " values\n"
+	          << "float ryu:        " << ryu_float << " ns/value\n"
+	          << "float toString(): " << to_string_float << " ns/value\n"
+	          << "(checksum " << checksum << ")\n";
+	return 0;
+}
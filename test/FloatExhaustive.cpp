@@ -0,0 +1,241 @@
+// test/FloatExhaustive.cpp
+//
+// Formats every float bit pattern in the shortest, "e" and "f" modes and checks
+// the output with strtof(): each text has to read back as the same float, and
+// the digits have to be the shortest ones that do, the closest of them if there
+// are several. All three modes must print the same digits. The formatting is
+// also timed on its own to report the throughput per core. The checks run at
+// about 2.5e5 floats/s per core, so all 2^32 patterns take about 5 hours on one
+// core, and it isn't part of the test suite.
+//
+// Usage: float_exhaustive [threads [first [count]]]
+// Without arguments, all 2^32 patterns are checked with one thread per core.
+
+#include "formatstring/ToString.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/** Number of patterns a thread takes at once. */
+const uint64_t CHUNK_SIZE = 1 << 20;
+
+const uint64_t PATTERN_COUNT = uint64_t(1) << 32;
+
+std::mutex output_mutex;
+
+struct Counters {
+	uint64_t checked = 0;
+	uint64_t failures = 0;
+	double format_time = 0;
+	size_t output_length = 0;
+};
+
+/** Returns the significant digits of a formatted number and their exponent. */
+std::string significantDigits(const std::string& text, int& exponent)
+{
+	std::string digits;
+	int point = -1;
+	size_t i = 0;
+	for (; i < text.length() && text[i] != 'e' && text[i] != 'E'; ++i) {
+		if (text[i] == '.')
+			point = static_cast<int>(digits.length());
+		else if (text[i] >= '0' && text[i] <= '9')
+			digits += text[i];
+	}
+	if (point == -1)
+		point = static_cast<int>(digits.length());
+	exponent = i < text.length() ? std::atoi(text.c_str() + i + 1) : 0;
+	
+	// Remove zeros at both ends, the value is 0.digits * 10^exponent
+	size_t leading = digits.find_first_not_of('0');
+	if (leading == std::string::npos)
+		return "0";
+	size_t trailing = digits.find_last_not_of('0');
+	exponent += point - static_cast<int>(leading);
+	return digits.substr(leading, trailing - leading + 1);
+}
+
+bool readsBack(const char* text, float value)
+{
+	float read = std::strtof(text, nullptr);
+	return std::memcmp(&read, &value, sizeof(value)) == 0;
+}
+
+/**
+ * Checks that no decimal with fewer digits reads back as the value, and that
+ * the correctly rounded decimal with the same number of digits is chosen if
+ * it reads back.
+ */
+bool isShortest(float value, const std::string& digits, int exponent)
+{
+	char text[64];
+	size_t length = digits.length();
+	if (length > 1) {
+		// The candidates with one digit less are around the rounded value
+		std::snprintf(text, sizeof(text), "%.*e", static_cast<int>(length) - 2,
+				static_cast<double>(std::fabs(value)));
+		int shorter_exponent;
+		std::string shorter = significantDigits(text, shorter_exponent);
+		long long mantissa = std::atoll(shorter.c_str());
+		int scale = shorter_exponent - static_cast<int>(shorter.length());
+		for (long long candidate: {mantissa - 1, mantissa, mantissa + 1}) {
+			std::snprintf(text, sizeof(text), "%s%llde%d", value < 0 ? "-" : "",
+					candidate, scale);
+			if (candidate > 0 && readsBack(text, value))
+				return false;
+		}
+	}
+	
+	std::snprintf(text, sizeof(text), "%.*e", static_cast<int>(length) - 1,
+			static_cast<double>(value));
+	int closest_exponent;
+	std::string closest = significantDigits(text, closest_exponent);
+	return !readsBack(text, value) || (closest == digits && closest_exponent == exponent);
+}
+
+void report(uint32_t bits, const char* mode, const std::string& text, const char* problem)
+{
+	std::lock_guard<std::mutex> lock(output_mutex);
+	std::printf("0x%08" PRIx32 " %s: \"%s\" %s\n", bits, mode, text.c_str(), problem);
+}
+
+void check(uint32_t bits, const fs::Numformat* formats, Counters& counters)
+{
+	static const char* const MODES[] = {"shortest", "e", "f"};
+	
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	if (std::isnan(value))
+		return;
+	
+	std::string text;
+	std::string digits[3];
+	int exponents[3];
+	bool ok = true;
+	for (int mode = 0; mode < 3; ++mode) {
+		text.clear();
+		fs::detail::appendFloat(text, value, formats[mode]);
+		if (std::isinf(value)) {
+			if (text != (value < 0 ? "-Inf" : "Inf")) {
+				report(bits, MODES[mode], text, "isn't infinity");
+				ok = false;
+			}
+			continue;
+		}
+		if (!readsBack(text.c_str(), value)) {
+			report(bits, MODES[mode], text, "doesn't read back");
+			ok = false;
+			continue;
+		}
+		digits[mode] = significantDigits(text, exponents[mode]);
+		if (mode == 0 && !isShortest(value, digits[0], exponents[0])) {
+			report(bits, MODES[mode], text, "isn't the shortest or closest");
+			ok = false;
+		} else if (mode != 0 && (digits[mode] != digits[0] || exponents[mode] != exponents[0])) {
+			report(bits, MODES[mode], text, "has other digits than the shortest mode");
+			ok = false;
+		}
+	}
+	
+	++counters.checked;
+	if (!ok)
+		++counters.failures;
+}
+
+/** Formats the patterns once without checking them, to time the formatting alone. */
+void format(uint64_t begin, uint64_t end, const fs::Numformat* formats, Counters& counters)
+{
+	std::string text;
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t bits = begin; bits < end; ++bits) {
+		float value;
+		uint32_t pattern = static_cast<uint32_t>(bits);
+		std::memcpy(&value, &pattern, sizeof(value));
+		if (std::isnan(value))
+			continue;
+		for (int mode = 0; mode < 3; ++mode) {
+			text.clear();
+			fs::detail::appendFloat(text, value, formats[mode]);
+			counters.output_length += text.length();
+		}
+	}
+	std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	counters.format_time += time.count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+	if (threads == 0)
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	uint64_t first = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 0;
+	uint64_t count = argc > 3 ? std::strtoull(argv[3], nullptr, 0) : PATTERN_COUNT - first;
+	uint64_t end = std::min(first + count, PATTERN_COUNT);
+	
+	const fs::Numformat formats[] = {
+		fs::detail::parseFloatformat(""),
+		fs::detail::parseFloatformat("e"),
+		fs::detail::parseFloatformat("f")
+	};
+	
+	// Threads take chunks of patterns until all are done
+	std::atomic<uint64_t> next(first);
+	std::vector<Counters> counters(threads);
+	std::vector<double> busy(threads);
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t]() {
+			auto thread_start = std::chrono::steady_clock::now();
+			for (;;) {
+				uint64_t begin = next.fetch_add(CHUNK_SIZE);
+				if (begin >= end)
+					break;
+				uint64_t chunk_end = std::min(begin + CHUNK_SIZE, end);
+				format(begin, chunk_end, formats, counters[t]);
+				for (uint64_t bits = begin; bits < chunk_end; ++bits)
+					check(static_cast<uint32_t>(bits), formats, counters[t]);
+			}
+			std::chrono::duration<double> time = std::chrono::steady_clock::now() - thread_start;
+			busy[t] = time.count();
+		});
+	}
+	for (std::thread& worker: workers)
+		worker.join();
+	std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+	
+	Counters total;
+	double busy_total = 0;
+	for (unsigned t = 0; t < threads; ++t) {
+		total.checked += counters[t].checked;
+		total.failures += counters[t].failures;
+		total.format_time += counters[t].format_time;
+		total.output_length += counters[t].output_length;
+		busy_total += busy[t];
+	}
+	double formatted = 3.0 * static_cast<double>(total.checked);
+	std::printf("%" PRIu64 " floats checked, %" PRIu64 " failures, %.1f s with %u threads\n",
+	            total.checked, total.failures, time.count(), threads);
+	if (total.checked > 0) {
+		std::printf("Formatting: %.1f ns per value, %.3g values/s per core, %.1f characters on average\n",
+		            1e9 * total.format_time / formatted, formatted / total.format_time,
+		            static_cast<double>(total.output_length) / formatted);
+		std::printf("Checking:   %.3g floats/s per core\n",
+		            static_cast<double>(total.checked) / (busy_total - total.format_time));
+	}
+	return total.failures == 0 ? 0 : 1;
+}
@@ -137,6 +137,19 @@ TEST_CASE("Formatstring basics w/ variables", "[Formatstring]")
 		CHECK(f1.str() == "2");
 	}
 	
+	SECTION("Strings are passed through") {
+		std::string text(1000, 'x');
+		const char* cstr = "cstr";
+		Formatstring f1("<{}|{}|{:>6}|{:s1-2}>");
+		f1.args(text, cstr, std::string("lit"), std::string("abc"));
+		CHECK(f1.str() == "<" + text + "|cstr|   lit|b>");
+#if __cplusplus >= 201703l
+		Formatstring f2("{} {:^5}");
+		f2.args(std::string_view("view", 2), std::string_view("xy"));
+		CHECK(f2.str() == "vi  xy  ");
+#endif
+	}
+	
 	SECTION("Wrapper") {
 		Formatstring f1("{}");
 		int a = 1;
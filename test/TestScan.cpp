@@ -0,0 +1,238 @@
+// test/TestScan.cpp
+//
+// Tests for reading formatted values back with scan()
+
+#include "catch2/catch.hpp"
+#include "formatstring/QuickFormat.h"
+#include "formatstring/Scan.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace fs;
+
+TEST_CASE("Scanning integers", "[Scan]")
+{
+	int a = 0;
+	unsigned b = 0;
+	long long c = 0;
+	CHECK(scan("12 -34", "{} {}", a, c) == 2);
+	CHECK(a == 12);
+	CHECK(c == -34);
+	
+	SECTION("Bases and prefixes") {
+		CHECK(scan("ff 0x1F 777 0b101", "{:x} {:#X} {:o} {:b}", a, b, c, a) == 4);
+		CHECK(b == 0x1f);
+		CHECK(c == 0777);
+		CHECK(a == 5);
+		CHECK(scan("0x", "{:x}x", a) == 1);
+		CHECK(a == 0);
+	}
+	
+	SECTION("Grouping, padding and signs") {
+		CHECK(scan("1,234,567", "{:,}", a) == 1);
+		CHECK(a == 1234567);
+		CHECK(scan("dead_beef", "{:_x}", b) == 1);
+		CHECK(b == 0xdeadbeef);
+		CHECK(scan("[   42]", "[{:5}]", a) == 1);
+		CHECK(a == 42);
+		CHECK(scan("[42...]", "[{:.<5}]", a) == 1);
+		CHECK(a == 42);
+		CHECK(scan("-0042 +7", "{:05} {:+}", a, c) == 2);
+		CHECK(a == -42);
+		CHECK(c == 7);
+		CHECK(scan("-**12", "{:*=5}", a) == 1);
+		CHECK(a == -12);
+		CHECK(scan("1,234", "{}", a) == 1);
+		CHECK(a == 1);
+	}
+	
+	SECTION("Range of the variable") {
+		int8_t small = 0;
+		uint8_t usmall = 0;
+		CHECK(scan("-128", "{}", small) == 1);
+		CHECK(small == -128);
+		CHECK(scan("128", "{}", small) == 0);
+		CHECK(scan("255", "{}", usmall) == 1);
+		CHECK(usmall == 255);
+		CHECK(scan("-1", "{}", usmall) == 0);
+		uint64_t big = 0;
+		CHECK(scan("18446744073709551615", "{}", big) == 1);
+		CHECK(big == UINT64_MAX);
+		CHECK(scan("18446744073709551616", "{}", big) == 0);
+		int64_t min = 0;
+		CHECK(scan("-9223372036854775808", "{}", min) == 1);
+		CHECK(min == INT64_MIN);
+	}
+	
+	SECTION("Round trip") {
+		std::mt19937_64 random(7);
+		const char* formats[] = {"", "x", "#b", ",", "_o", "+08", "*^30"};
+		for (int i = 0; i < 1000; ++i) {
+			long long value = static_cast<long long>(random()) >> (random() % 64);
+			const char* fmt = formats[i % 7];
+			std::string text = toString(value, fmt);
+			long long read = 0;
+			INFO(text << " " << fmt);
+			CHECK(scan(text, std::string("{:") + fmt + "}", read) == 1);
+			CHECK(read == value);
+		}
+	}
+}
+
+TEST_CASE("Scanning floats", "[Scan]")
+{
+	double d = 0;
+	float f = 0;
+	
+	SECTION("Notations") {
+		CHECK(scan("1.5 -2.5e-3 1e10 .5 7.", "{} {} {} {} {}", d, f, d, d, d) == 5);
+		CHECK(f == -2.5e-3f);
+		CHECK(d == 7.0);
+		CHECK(scan("1,234.5", "{:,}", d) == 1);
+		CHECK(d == 1234.5);
+		CHECK(scan("12.3k 4.5u", "{:si} {:si}", d, f) == 2);
+		CHECK(d == 12300.0);
+		CHECK(f == 4.5e-6f);
+		CHECK(scan("1.2E3", "{:E}", d) == 1);
+		CHECK(d == 1200.0);
+		CHECK(scan("-  1.5", "{:=6}", d) == 1);
+		CHECK(d == -1.5);
+	}
+	
+	SECTION("Special values") {
+		CHECK(scan("Inf -Inf NaN", "{} {} {}", d, f, d) == 3);
+		CHECK(std::isnan(d));
+		CHECK(f == -std::numeric_limits<float>::infinity());
+		CHECK(scan("infinity", "{}", d) == 1);
+		CHECK(d == std::numeric_limits<double>::infinity());
+		CHECK(scan("1e400 1e-400", "{} {}", d, f) == 2);
+		CHECK(d == std::numeric_limits<double>::infinity());
+		CHECK(f == 0);
+	}
+	
+	SECTION("Correct rounding") {
+		// Halfway cases, denormals and more digits than fit into 64 bits
+		const char* hard[] = {
+			"9007199254740993", "9007199254740993.0000000000000000001",
+			"2.2250738585072011e-308", "4.9406564584124654e-324",
+			"2.4703282292062327e-324", "2.4703282292062328e-324",
+			"1.7976931348623157e308", "1.7976931348623158e308",
+			"7.038531e-26", "1.00000005960464477550", "3.4028235677973366e38",
+			"0.1000000000000000055511151231257827021181583404541015625",
+			"123456789012345678901234567890e-10",
+			"2.47032822920623272088284396434110686182529901307162382212792841250337753635104375932649918180817996189898282347722858865463328355177969898199387398005390939063150356595155702263922908583924491051844359318028499365361525003193704576782492193656236698636584807570015857692699037063119282795585513329278343384093519780155312465972635795746227664652728272200563740064854999770965994704540208281662262378573934507363390079677619305775067401763246736009689513405355374585166611342237666786041621596804619144672918403005300575308490487653917113865916462395249126236538818796362393732804238910186723484976682350898633885879256283027559956575244555072551893136908362547791869486679949683240497058210285131854513962138377228261454376934125320985913276672363281255e-324"
+		};
+		for (const char* text: hard) {
+			INFO(text);
+			CHECK(scan(text, "{}", d) == 1);
+			CHECK(d == std::strtod(text, nullptr));
+			CHECK(scan(text, "{}", f) == 1);
+			CHECK(f == std::strtof(text, nullptr));
+		}
+	}
+	
+	SECTION("Round trip") {
+		std::mt19937_64 random(11);
+		const char* formats[] = {"", "e", "+E", ".3f", ".10", ".1-5e"};
+		for (int i = 0; i < 3000; ++i) {
+			uint64_t bits = random();
+			double value;
+			std::memcpy(&value, &bits, sizeof(value));
+			if (value != value || value - value != 0)
+				continue;
+			const char* fmt = formats[i % 6];
+			std::string text = toString(value, fmt);
+			double read = 0;
+			INFO(text << " " << fmt);
+			CHECK(scan(text, std::string("{:") + fmt + "}", read) == 1);
+			CHECK(read == std::strtod(text.c_str(), nullptr));
+			if (i % 6 < 3)
+				CHECK(read == value);
+		}
+	}
+	
+	if (std::numeric_limits<long double>::digits == 64) {
+		SECTION("Extended precision") {
+			long double l = 0;
+			CHECK(scan("1.18973149535723176502e4932", "{}", l) == 1);
+			CHECK(l == std::numeric_limits<long double>::max());
+			CHECK(scan("0.1", "{}", l) == 1);
+			CHECK(l == 0.1L);
+			CHECK(scan("3.64519953188247460253e-4951", "{}", l) == 1);
+			CHECK(l == std::numeric_limits<long double>::denorm_min());
+		}
+	}
+}
+
+TEST_CASE("Scanning text", "[Scan]")
+{
+	bool b = false;
+	char c = 0;
+	std::string s;
+	
+	CHECK(scan("true,false", "{},{}", b, b) == 2);
+	CHECK_FALSE(b);
+	CHECK(scan("yes", "{:n'yes' 'no'}", b) == 1);
+	CHECK(b);
+	CHECK(scan("x:A", "x:{}", c) == 1);
+	CHECK(c == 'A');
+	CHECK(scan("..Z..", "{:.^5}", c) == 1);
+	CHECK(c == 'Z');
+	CHECK(scan("65", "{:i}", c) == 1);
+	CHECK(c == 'A');
+	
+	CHECK(scan("name: John Doe, age: 42", "name: {}, age: {}", s, c) == 2);
+	CHECK(s == "John Doe");
+	CHECK(scan("one two", "{}{}", s, c) == 2);
+	CHECK(s == "one");
+	CHECK(c == ' ');
+	CHECK(scan("[  right]", "[{:>7}]", s) == 1);
+	CHECK(s == "right");
+	CHECK(scan("rest of line", "{}", s) == 1);
+	CHECK(s == "rest of line");
+}
+
+TEST_CASE("Scanning format strings", "[Scan]")
+{
+	int a = 0, b = 0;
+	
+	SECTION("Explicit IDs and escaped braces") {
+		CHECK(scan("{3} 4", "{{{2}}} {1}", a, b) == 2);
+		CHECK(a == 4);
+		CHECK(b == 3);
+	}
+	
+	SECTION("Mismatches stop scanning") {
+		a = b = 0;
+		CHECK(scan("1, x", "{}, {}", a, b) == 1);
+		CHECK(a == 1);
+		CHECK(b == 0);
+		CHECK(scan("a=1", "b={}", a) == 0);
+		CHECK(scan("1", "{} {}", a, b) == 1);
+		CHECK(scan("", "{}", a) == 0);
+	}
+	
+	SECTION("Round trip of a record") {
+		std::string name;
+		double value = 0;
+		unsigned id = 0;
+		std::string text = formats("{:>8}: {:#06x} = {:.2e}", "sensor", 0x2a, 1234.5).str();
+		CHECK(scan(text, "{:>8}: {:#06x} = {:.2e}", name, id, value) == 3);
+		CHECK(name == "sensor");
+		CHECK(id == 0x2a);
+		CHECK(value == 1200.0);
+	}
+	
+	SECTION("Exceptions") {
+		CHECK_THROWS_WITH(scan("1 2", "{} {}", a), Catch::Contains("Not enough variables provided"));
+		CHECK_THROWS_WITH(scan("x", "y{} {}", a), Catch::Contains("Not enough variables provided"));
+		CHECK_THROWS_WITH(scan("1", "{", a), Catch::Contains("EOF within variable specifier"));
+		CHECK_THROWS_WITH(scan("1", "{:q}", a), Catch::Contains("Unknown type parameter \"q\""));
+		CHECK_THROWS_WITH(scan("1k", "{:si}", a), Catch::Contains("Type \"si\" can't be scanned"));
+	}
+}
@@ -79,3 +79,16 @@ TEST_CASE("VariableFormat", "[Variable][VariableFormat]")
 	U<Variable> v2 = mkU<VariableFormat>(std::move(v1), "fmt123");
 	CHECK(v2->toString("myfmt") == "fmt123");
 }
+
+TEST_CASE("Variable appendTo", "[Variable]")
+{
+	std::string out = "> ";
+	std::string text = "text";
+	mkU<VariableRawReference<std::string>>(&text)->appendTo(out, {});
+	mkU<VariableCopy<const char*>>("|")->appendTo(out, {});
+	mkU<VariableCopy<int>>(42)->appendTo(out, "4");
+	mkU<VariableRawReference<std::string>>(nullptr)->appendTo(out, {});
+	U<Variable> v1 = mkU<VariableCopy<FmtReporter>>(FmtReporter());
+	mkU<VariableFormat>(std::move(v1), "fmt")->appendTo(out, "myfmt");
+	CHECK(out == "> text|  42nullptrfmt");
+}
@@ -0,0 +1,114 @@
+// test/stringify/TestBigIntToString.cpp
+//
+// Test toString() for integers of arbitrary size.
+
+#include "catch2/catch.hpp"
+#include "formatstring/ToString.h"
+
+
+using namespace fs;
+
+namespace {
+
+/** Multiplies the limbs by factor and adds summand. */
+void mulAdd(std::vector<uint64_t>& limbs, uint32_t factor, uint32_t summand)
+{
+	uint64_t carry = summand;
+	for (uint64_t& limb: limbs) {
+		uint64_t low = (limb & 0xffffffff) * factor + carry;
+		uint64_t high = (limb >> 32) * factor + (low >> 32);
+		limb = (high << 32) | (low & 0xffffffff);
+		carry = high >> 32;
+	}
+	if (carry != 0)
+		limbs.push_back(carry);
+}
+
+/** Parses a string of decimal digits into limbs. */
+std::vector<uint64_t> parseDecimal(const std::string& digits)
+{
+	std::vector<uint64_t> limbs;
+	for (char c: digits)
+		mulAdd(limbs, 10, static_cast<uint32_t>(c - '0'));
+	return limbs;
+}
+
+} // anonymous namespace
+
+TEST_CASE("BigIntToString", "[toString][BigIntToString]")
+{
+	std::vector<uint64_t> zero {};
+	std::vector<uint64_t> small {12345};
+	std::vector<uint64_t> pow64 {0, 1};
+	std::vector<uint64_t> max128 {~0ull, ~0ull};
+	
+	SECTION("Standard usage") {
+		CHECK(toString(BigIntView(zero)) == "0");
+		CHECK(toString(BigIntView(zero, true)) == "0");
+		CHECK(toString(BigIntView(small)) == "12345");
+		CHECK(toString(BigIntView(small, true)) == "-12345");
+		CHECK(toString(BigIntView(pow64)) == "18446744073709551616");
+		CHECK(toString(BigIntView(max128)) == "340282366920938463463374607431768211455");
+		
+		// Leading zero limbs are ignored
+		std::vector<uint64_t> padded {42, 0, 0};
+		CHECK(toString(BigIntView(padded)) == "42");
+		CHECK(toString(BigIntView(padded), "x") == "2a");
+	}
+	
+	SECTION("Bases") {
+		CHECK(toString(BigIntView(zero), "x") == "0");
+		CHECK(toString(BigIntView(pow64), "x") == "10000000000000000");
+		CHECK(toString(BigIntView(pow64), "#X") == "0x10000000000000000");
+		CHECK(toString(BigIntView(pow64), "b") == "1" + std::string(64, '0'));
+		CHECK(toString(BigIntView(pow64), "o") == "2" + std::string(21, '0'));
+		CHECK(toString(BigIntView(max128), "x") == std::string(32, 'f'));
+		CHECK(toString(BigIntView(max128), "o") == "3" + std::string(42, '7'));
+		CHECK(toString(BigIntView(max128, true), "#b") == "-0b" + std::string(128, '1'));
+	}
+	
+	SECTION("Formatting") {
+		CHECK(toString(BigIntView(small), "+08") == "+0012345");
+		CHECK(toString(BigIntView(small, true), "*<8") == "-12345**");
+		CHECK(toString(BigIntView(small), " #010x") == " 0x0003039");
+		CHECK(toString(BigIntView(max128), ",") == "340,282,366,920,938,463,463,374,607,431,768,211,455");
+		CHECK(toString(BigIntView(pow64), "_X") == "1_0000_0000_0000_0000");
+		CHECK(toString(BigIntView(small, true), ">10,") == "   -12,345");
+		CHECK(toString(BigIntView(small), "09,") == "0,012,345");
+	}
+	
+	SECTION("Large values") {
+		// Powers of ten and their predecessors in decimal
+		for (size_t digits: {100, 308, 309, 1000, 4321}) {
+			std::vector<uint64_t> power = parseDecimal("1" + std::string(digits, '0'));
+			CHECK(toString(BigIntView(power)) == "1" + std::string(digits, '0'));
+			std::vector<uint64_t> nines = parseDecimal(std::string(digits, '9'));
+			CHECK(toString(BigIntView(nines)) == std::string(digits, '9'));
+		}
+		
+		// Pseudo random digits survive the round trip
+		uint64_t x = 88172645463325252ull;
+		for (size_t length: {20, 500, 2000, 5000}) {
+			std::string digits;
+			for (size_t i = 0; i < length; ++i) {
+				x ^= x << 13;
+				x ^= x >> 7;
+				x ^= x << 17;
+				digits += static_cast<char>('0' + (i == 0 ? 1 + x % 9 : x % 10));
+			}
+			REQUIRE(toString(BigIntView(parseDecimal(digits))) == digits);
+		}
+		
+		// Hex digits map directly to the limbs
+		std::vector<uint64_t> limbs(40, 0x0123456789abcdefull);
+		std::string hex = "123456789abcdef";
+		for (int i = 1; i < 40; ++i)
+			hex += "0123456789abcdef";
+		CHECK(toString(BigIntView(limbs), "x") == hex);
+	}
+	
+	SECTION("Exceptions") {
+		CHECK_THROWS_WITH(toString(BigIntView(small), "f"), Catch::Contains("Unknown type parameter \"f\""));
+		CHECK_THROWS_WITH(toString(BigIntView(small), "si"), Catch::Contains("Unknown type parameter \"si\""));
+	}
+}
@@ -51,9 +51,40 @@ TEST_CASE("CollectionToString", "[toString][CollectionToString]")
 		CHECK(fs::toString(a, "d{ ; }:x") == "{a;b;c}");
 	}
 	
+	SECTION("Numeric values") {
+		std::vector<int> a {-1, 0, 255};
+		CHECK(fs::toString(a, "i:#x") == "[-0x1, 0x0, 0xff]");
+		CHECK(fs::toString(a, "i:+04") == "[-001, +000, +255]");
+		CHECK(fs::toString(a, "d< | >:^5") == "< -1  |  0  | 255 >");
+		
+		std::vector<unsigned long long> b {18446744073709551615ull, 1};
+		CHECK(fs::toString(b, "i:x") == "[ffffffffffffffff, 1]");
+		std::array<signed char, 2> c {{-128, 127}};
+		CHECK(fs::toString(c) == "[-128, 127]");
+		
+		std::vector<double> d {0.5, -2.75};
+		CHECK(fs::toString(d, "i:.1f") == "[0.5, -2.8]");
+		
+		// Characters and booleans are not formatted as numbers
+		std::vector<char> e {'a', 'b'};
+		CHECK(fs::toString(e) == "[a, b]");
+		std::deque<bool> f {true, false};
+		CHECK(fs::toString(f) == "[true, false]");
+		
+		std::vector<int> g(1000, 7);
+		std::string expected = "[7";
+		for (int i = 1; i < 1000; ++i)
+			expected += ", 7";
+		CHECK(fs::toString(g) == expected + "]");
+	}
+	
 	SECTION("Exception") {
 		std::list<int> a{};
 		CHECK_THROWS_WITH(fs::toString(a, "d<>"), Catch::Contains("Space expected"));
+		std::vector<int> b {1};
+		CHECK_THROWS_WITH(fs::toString(b, "i:f"), Catch::Contains("Unknown type parameter"));
+		std::vector<double> c {1.0};
+		CHECK_THROWS_WITH(fs::toString(c, "i:x"), Catch::Contains("Unknown type parameter"));
 	}
 }
 
@@ -0,0 +1,83 @@
+// test/stringify/TestDecimalToString.cpp
+//
+// Test toString() for fixed-point decimals.
+
+#include "catch2/catch.hpp"
+#include "formatstring/ToString.h"
+
+#include <cstdint>
+#include <random>
+
+
+using namespace fs;
+
+TEST_CASE("DecimalToString", "[toString][DecimalToString]")
+{
+	SECTION("Default precision is the scale") {
+		CHECK(toString(Decimal<2>(12345)) == "123.45");
+		CHECK(toString(Decimal<4>(-15000)) == "-1.5000");
+		CHECK(toString(Decimal<0>(42)) == "42");
+		CHECK(toString(Decimal<3>(5)) == "0.005");
+		CHECK(toString(Decimal<2>(0)) == "0.00");
+		CHECK(toString(ScaledDecimal(7, 1)) == "0.7");
+		CHECK(toString(Decimal<19>(INT64_MIN)) == "-0.9223372036854775808");
+		CHECK(toString(Decimal<0>(INT64_MIN)) == "-9223372036854775808");
+	}
+	
+	SECTION("Precision rounds ties to even") {
+		CHECK(toString(Decimal<4>(1234567), ".2") == "123.46");
+		CHECK(toString(Decimal<3>(125), ".2") == "0.12");
+		CHECK(toString(Decimal<3>(375), ".2f") == "0.38");
+		CHECK(toString(Decimal<3>(-125), ".2") == "-0.12");
+		CHECK(toString(Decimal<3>(-126), ".2") == "-0.13");
+		CHECK(toString(Decimal<2>(950), ".0") == "10");
+		CHECK(toString(Decimal<2>(999), ".1") == "10.0");
+		CHECK(toString(Decimal<19>(5000000000000000000), ".0") == "0");
+		CHECK(toString(Decimal<19>(5000000000000000001), ".0") == "1");
+		CHECK(toString(Decimal<19>(INT64_MAX), ".0") == "1");
+		CHECK(toString(Decimal<1>(5), ".4") == "0.5000");
+		CHECK(toString(Decimal<2>(100), "#.0") == "1.");
+	}
+	
+	SECTION("Precision ranges remove trailing zeros") {
+		CHECK(toString(Decimal<4>(15000), ".0-4") == "1.5");
+		CHECK(toString(Decimal<4>(10000), ".0-4") == "1");
+		CHECK(toString(Decimal<4>(10000), ".2-4") == "1.00");
+		CHECK(toString(Decimal<2>(150), ".1-6") == "1.5");
+		CHECK(toString(Decimal<4>(12345), ".1-2") == "1.23");
+	}
+	
+	SECTION("Sign, width and grouping") {
+		CHECK(toString(Decimal<2>(12345), "+") == "+123.45");
+		CHECK(toString(Decimal<2>(12345), " ") == " 123.45");
+		CHECK(toString(Decimal<2>(-12345), "10") == "   -123.45");
+		CHECK(toString(Decimal<2>(-12345), "*<10") == "-123.45***");
+		CHECK(toString(Decimal<2>(-12345), "=10") == "-   123.45");
+		CHECK(toString(Decimal<2>(-12345), "010") == "-000123.45");
+		CHECK(toString(Decimal<2>(123456789), ",") == "1,234,567.89");
+		CHECK(toString(Decimal<2>(123456789), "_4.1") == "123_4567.9");
+		CHECK(toString(Decimal<2>(1250), "010,") == "000,012.50");
+		CHECK(toString(Decimal<2>(-1250), "+010,.1") == "-000,012.5");
+	}
+	
+	SECTION("Matches the exact decimal expansion") {
+		std::mt19937_64 random(5);
+		for (int i = 0; i < 1000; ++i) {
+			int64_t units = static_cast<int64_t>(random()) >> (random() % 64);
+			unsigned scale = static_cast<unsigned>(random() % 20);
+			std::string digits = toString(units < 0 ? 0 - static_cast<uint64_t>(units)
+			                                        : static_cast<uint64_t>(units));
+			if (digits.length() <= scale)
+				digits.insert(0, scale + 1 - digits.length(), '0');
+			std::string expected = (units < 0 ? "-" : "") + digits.substr(0, digits.length() - scale);
+			if (scale > 0)
+				expected += "." + digits.substr(digits.length() - scale);
+			CHECK(toString(ScaledDecimal(units, scale)) == expected);
+		}
+	}
+	
+	SECTION("Errors") {
+		CHECK_THROWS_WITH(toString(Decimal<2>(1), "e"), Catch::Contains("Unknown type parameter \"e\""));
+		CHECK_THROWS_WITH(toString(ScaledDecimal(1, 20)), Catch::Contains("at most 19"));
+	}
+}
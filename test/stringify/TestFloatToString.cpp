@@ -5,6 +5,9 @@
 #include "catch2/catch.hpp"
 #include "formatstring/ToString.h"
 
+#include <limits>
+#include <stdexcept>
+
 
 using namespace fs;
 
@@ -21,6 +24,47 @@ TEST_CASE("FloatToString", "[toString][FloatToString]")
 		CHECK(toString(-0.) == "-0");
 	}
 	
+	SECTION("Shortest round trip") {
+		CHECK(toString(5.94577) == "5.94577");
+		CHECK(toString(26.06311) == "26.06311");
+		CHECK(toString(189.7255775) == "189.7255775");
+		CHECK(toString(4349.545633886009) == "4349.545633886009");
+		CHECK(toString(0.1 + 0.2) == "0.30000000000000004");
+		CHECK(toString(5e-324) == "5e-324");
+		CHECK(toString(2.2250738585072014e-308) == "2.2250738585072014e-308");
+		CHECK(toString(1.7976931348623157e308) == "1.7976931348623157e308");
+		CHECK(toString(9007199254740993.0) == "9.007199254740992e15");
+		CHECK(toString(1e23) == "1e23");
+		
+		CHECK(toString(0.3f) == "0.3");
+		CHECK(toString(1.4e-45f) == "1e-45");
+		CHECK(toString(4.06376555e-44f) == "4e-44");
+		CHECK(toString(1.1754944e-38f) == "1.1754944e-38");
+		CHECK(toString(3.4028235e38f) == "3.4028235e38");
+		CHECK(toString(16777216.f) == "16777216");
+	}
+	
+	SECTION("Extended precision") {
+		// 80-bit long doubles keep their 64-bit significand, other formats are
+		// printed like doubles
+		if (std::numeric_limits<long double>::digits == 64) {
+			CHECK(toString(0.1L) == "0.1");
+			CHECK(toString(0.1L, ".25f") == "0.1000000000000000000013553");
+			CHECK(toString(1.0L / 3) == "0.33333333333333333334");
+			CHECK(toString(1e4000L) == "1e4000");
+			CHECK(toString(1e4000L, ".22e") == "9.999999999999999999965e3999");
+			CHECK(toString(std::numeric_limits<long double>::max())
+					== "1.189731495357231765e4932");
+			CHECK(toString(std::numeric_limits<long double>::min())
+					== "3.3621031431120935063e-4932");
+			CHECK(toString(std::numeric_limits<long double>::denorm_min()) == "4e-4951");
+			CHECK(toString(-std::numeric_limits<long double>::infinity()) == "-Inf");
+			CHECK(toString(std::numeric_limits<long double>::quiet_NaN()) == "NaN");
+		}
+		CHECK(toString(0.5L) == "0.5");
+		CHECK(toString(-2.75L, ".1f") == "-2.8");
+	}
+	
 	SECTION("Special values") {
 		CHECK(toString(1.0 / 0.0) == "Inf");
 		CHECK(toString(-1.0 / 0.0) == "-Inf");
@@ -68,6 +112,20 @@ TEST_CASE("FloatToString", "[toString][FloatToString]")
 			CHECK(toString(12., "#") == "12.");
 		}
 		
+		SECTION("Grouping") {
+			CHECK(toString(1234567.25, ",") == "1,234,567.25");
+			CHECK(toString(1234567.75, "_.1f") == "1_234_567.8");
+			CHECK(toString(-123456., ",f") == "-123,456");
+			CHECK(toString(999.5, ",.0f") == "1,000");
+			CHECK(toString(12.5, ",") == "12.5");
+			CHECK(toString(1234567., ",4") == "123,4567");
+			CHECK(toString(1234.5, ">10,") == "   1,234.5");
+			CHECK(toString(1.5, "09,") == "000,001.5");
+			CHECK(toString(-1.5, "+#010,f") == "-000,001.5");
+			CHECK(toString(1.23e4, ",2ee") == "12.3e3");
+			CHECK(toString(1.23e5, ",2ee") == "1,23e3");
+		}
+		
 		SECTION("Precision") {
 			CHECK(toString(1.23456789) == "1.23456789");
 			CHECK(toString(1.23456789, ".5") == "1.2346");
@@ -85,6 +143,39 @@ TEST_CASE("FloatToString", "[toString][FloatToString]")
 			CHECK(toString(0.001, ".0-2f") == "0");
 			CHECK(toString(9.9, ".0f") == "10");
 			CHECK(toString(9.99, ".1-2e") == "1e1");
+			CHECK(toString(1299.053, ".3") == "1300");
+			CHECK(toString(99.7, ".1") == "100");
+			CHECK(toString(0.09, ".1f") == "0.1");
+			CHECK(toString(0.9, ".0f") == "1");
+			CHECK(toString(1e-200, ".3f") == "0.000");
+			CHECK(toString(-1e300, ".1f") ==
+					"-10000000000000000525047602552044202487044685811081591549158541155118024"
+					"579889081957863713750804478640437044438328838781769425232353604305756447"
+					"921847867069828483872009265758037378302337947880900593689532349707999450"
+					"811190389676408800746527427801424945792587888200568428381156694721963868"
+					"65459400540160.0");
+		}
+		
+		SECTION("Exact digits beyond the shortest ones") {
+			CHECK(toString(0.1, ".30f") == "0.100000000000000005551115123126");
+			CHECK(toString(0.3, ".20e") == "2.9999999999999998890e-1");
+			CHECK(toString(1734.465, ".2f") == "1734.46");
+			CHECK(toString(5e-324, ".4e") == "4.941e-324");
+			CHECK(toString(1.5f, ".20f") == "1.50000000000000000000");
+			CHECK(toString(0.1f, ".10f") == "0.1000000015");
+			
+			// Exact ties round to even
+			CHECK(toString(0.125, ".2f") == "0.12");
+			CHECK(toString(0.375, ".2f") == "0.38");
+			CHECK(toString(2.5, ".0f") == "2");
+			CHECK(toString(3.5, ".0f") == "4");
+			CHECK(toString(92.25, ".3") == "92.2");
+			
+			// Shortest digits rounded up to a power of ten
+			CHECK(toString(1e23, ".20e") == "9.9999999999999991611e22");
+			CHECK(toString(1e23, ".25f") == "99999999999999991611392.0000000000000000000000000");
+			CHECK(toString(1e23, ".3e") == "1.00e23");
+			CHECK(toString(9.9492191e-44f, ".4e") == "9.949e-44");
 		}
 		
 		SECTION("Formatting modes") {
@@ -104,6 +195,25 @@ TEST_CASE("FloatToString", "[toString][FloatToString]")
 			CHECK(toString(0.001) == "0.001");
 			CHECK(toString(0.00099999) == "9.9999e-4");
 		}
+		
+		SECTION("Width fit") {
+			CHECK(toString(3.14159265358979, "7w") == "3.14159");
+			CHECK(toString(3.14159265358979, "3w") == "3.1");
+			CHECK(toString(2.5, "8w") == "     2.5");
+			CHECK(toString(-0.000123, "<7w") == "-1.2e-4");
+			CHECK(toString(-0.000123, "10w") == " -0.000123");
+			CHECK(toString(123456789., "7w") == "1.235e8");
+			CHECK(toString(123456789., "7W") == "1.235E8");
+			CHECK(toString(1234567., "7w") == "1234567");
+			CHECK(toString(1234567., "9,w") == "1,234,567");
+			CHECK(toString(1234567., "7,w") == "1.235e6");
+			CHECK(toString(1.23e-7, "+8w") == "+1.23e-7");
+			CHECK(toString(1e100, "3w") == "1e100");
+			CHECK(toString(99.97, "3w") == "100");
+			CHECK(toString(9.96, "3w") == " 10");
+			CHECK(toString(0., "4w") == "   0");
+			CHECK(toString(3.25f, "3w") == "3.2");
+		}
 	}
 	
 	SECTION("Exceptions") {
@@ -112,5 +222,60 @@ TEST_CASE("FloatToString", "[toString][FloatToString]")
 		CHECK_THROWS_WITH(toString(0., "--<6"), Catch::Contains("Unknown type parameter \"-<6\""));
 		CHECK_THROWS_WITH(toString(0., ".-"), Catch::Contains("Maximum precision expected after '-'"));
 		CHECK_THROWS_WITH(toString(0., ".4-2"), Catch::Contains("Maximum precision less than minimum"));
+		CHECK_THROWS_WITH(toString(0., ",0"), Catch::Contains("Group size must be positive"));
+		CHECK_THROWS_WITH(toString(0., "_123f"), Catch::Contains("Group size must be at most 99"));
+		CHECK_THROWS_WITH(toString(0., "w"), Catch::Contains("Type \"w\" requires a width"));
+		CHECK_THROWS_WITH(toString(0., "8.3w"), Catch::Contains("Type \"w\" can't have a precision"));
+	}
+}
+
+TEST_CASE("formatDoubles", "[toString][FloatToString]")
+{
+	SECTION("Small arrays") {
+		std::vector<double> values {1.5, -0., 1.0 / 0.0, 0.0 / 0.0, 1e-7, 12345.678};
+		CHECK(formatDoubles(values, "") == "1.5,-0,Inf,NaN,1e-7,12345.678");
+		CHECK(formatDoubles(values, ".2f", "; ") == "1.50; -0.00; Inf; NaN; 0.00; 12345.68");
+		CHECK(formatDoubles(values, "+e", "\n") == "+1.5e+0\n-0e+0\n+Inf\nNaN\n+1e-7\n+1.2345678e+4");
+		CHECK(formatDoubles({}, "f") == "");
+		CHECK(formatDoubles({42.}, "f", ",", 4) == "42");
+	}
+	
+	SECTION("Large arrays in order") {
+		// Enough values for several segments per thread
+		std::vector<double> values;
+		std::string expected;
+		for (int i = 0; i < 300000; ++i) {
+			values.push_back(i % 1000 == 0 ? 0.0 / 0.0 : i * 1.25e-3 - 17);
+			expected += (i == 0 ? "" : "|") + toString(values.back(), "_.3f");
+		}
+		CHECK(formatDoubles(values, "_.3f", "|") == expected);
+		CHECK(formatDoubles(values, "_.3f", "|", 3) == expected);
+		CHECK(formatDoubles(values, "_.3f", "|", 0) == expected);
+		
+		// The sink gets pieces that join to the same text
+		size_t pieces = 0;
+		std::string joined;
+		formatDoubles(values.data(), values.size(), "_.3f", [&](const char* data, size_t length) {
+			joined.append(data, length);
+			++pieces;
+		}, "|", 2);
+		CHECK(joined == expected);
+		CHECK(pieces > 1);
+		
+		// Exceptions of the sink reach the caller while threads are running
+		pieces = 0;
+		CHECK_THROWS_WITH(formatDoubles(values.data(), values.size(), "_.3f", [&](const char*, size_t) {
+			if (++pieces == 2)
+				throw std::runtime_error("Sink failed");
+		}, "|", 3), "Sink failed");
+		CHECK(pieces == 2);
+	}
+	
+	SECTION("Exceptions") {
+		bool called = false;
+		CHECK_THROWS_WITH(formatDoubles(nullptr, 0, "x", [&](const char*, size_t) {
+			called = true;
+		}), Catch::Contains("Unknown type parameter \"x\""));
+		CHECK(!called);
 	}
 }
@@ -23,6 +23,8 @@ TEST_CASE("FormatHelper Numberformat", "[Helper][Numformat]")
 		CHECK(nf.max_precision == -1);
 		CHECK(nf.width == -1);
 		CHECK(nf.type.empty());
+		CHECK(nf.grouping == '\0');
+		CHECK(nf.group_size == -1);
 		CHECK(nf.parsed_until == 0);
 	}
 	
@@ -51,6 +53,20 @@ TEST_CASE("FormatHelper Numberformat", "[Helper][Numformat]")
 		CHECK_THROWS_WITH(parseNumformat(".3-"), Catch::Contains("Maximum precision expected"));
 		CHECK_THROWS_WITH(parseNumformat(".3-2"), Catch::Contains("Maximum precision less than minimum"));
 		
+		nf = parseNumformat("+12,.2f");
+		CHECK(nf.width == 12);
+		CHECK(nf.grouping == ',');
+		CHECK(nf.group_size == -1);
+		CHECK(nf.min_precision == 2);
+		CHECK(nf.type == "f");
+		
+		nf = parseNumformat("_4x");
+		CHECK(nf.grouping == '_');
+		CHECK(nf.group_size == 4);
+		CHECK(nf.type == "x");
+		
+		CHECK_THROWS_WITH(parseNumformat(",0"), Catch::Contains("Group size must be positive"));
+		
 		nf = parseNumformat("test:abc");
 		CHECK(nf.type == "test");
 		CHECK(nf.parsed_until == 4);
@@ -43,6 +43,28 @@ TEST_CASE("IntToString", "[toString][IntToString]")
 		CHECK(toString((uint64_t) 18446744073709551615ull) == "18446744073709551615");
 	}
 	
+	SECTION("Decimal digit counts") {
+		uint64_t power = 1;
+		for (int digits = 1; digits < 20; ++digits) {
+			CHECK(toString(power) == std::to_string(power));
+			CHECK(toString(power - 1) == std::to_string(power - 1));
+			CHECK(toString(power * 9 + power - 1) == std::to_string(power * 9 + power - 1));
+			power *= 10;
+		}
+		
+		// Compare a range of pseudo random values against the standard library
+		uint64_t x = 88172645463325252ull;
+		for (int i = 0; i < 1000; ++i) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			uint64_t value = x >> (i % 64);
+			REQUIRE(toString(value) == std::to_string(value));
+			REQUIRE(toString(static_cast<int64_t>(value)) ==
+					std::to_string(static_cast<int64_t>(value)));
+		}
+	}
+	
 	SECTION("Formatting") {
 		SECTION("Alignment") {
 			CHECK(toString(42, "5") ==  "   42");
@@ -106,10 +128,134 @@ TEST_CASE("IntToString", "[toString][IntToString]")
 			CHECK(toString(0, " #x") == " 0x0");
 		}
 		
+		SECTION("Grouping") {
+			CHECK(toString(1234567, ",") == "1,234,567");
+			CHECK(toString(-1234567, "_") == "-1_234_567");
+			CHECK(toString(123, ",") == "123");
+			CHECK(toString(1000, ",") == "1,000");
+			CHECK(toString(0, ",") == "0");
+			CHECK(toString(0xdeadbeef, "_x") == "dead_beef");
+			CHECK(toString(0xdeadbeef, "#_X") == "0xDEAD_BEEF");
+			CHECK(toString(255, "_b") == "1111_1111");
+			CHECK(toString(255, "_2b") == "11_11_11_11");
+			CHECK(toString(1234567, ",2") == "1,23,45,67");
+			CHECK(toString(1234567, ",99") == "1234567");
+			CHECK(toString(uint64_t(18446744073709551615ull), "_1b").length() == 127);
+			
+			CHECK(toString(1234, ">8,") == "   1,234");
+			CHECK(toString(1234, "^9,") == "  1,234  ");
+			CHECK(toString(1234, "09,") == "0,001,234");
+			CHECK(toString(1234, "08,") == "0,001,234");
+			CHECK(toString(1234, "+010,") == "+0,001,234");
+			CHECK(toString(5, "#010_x") == "0x000_0005");
+		}
+		
+		SECTION("Full width values") {
+			uint64_t max = 18446744073709551615ull;
+			CHECK(toString(max, "x") == "ffffffffffffffff");
+			CHECK(toString(max, "o") == "1777777777777777777777");
+			CHECK(toString(max, "b") == std::string(64, '1'));
+			CHECK(toString(0x0123456789abcdefull, "X") == "123456789ABCDEF");
+			CHECK(toString(0x8000000000000001ull, "b") ==
+					"1" + std::string(62, '0') + "1");
+			CHECK(toString(01234567012345670123ull, "o") == "1234567012345670123");
+			CHECK(toString((int64_t) -9223372036854775807 - 1, "#x") == "-0x8000000000000000");
+			CHECK(toString((uint8_t) 0xa5, "b") == "10100101");
+			CHECK(toString((int16_t) -0x7abc, "X") == "-7ABC");
+			
+			CHECK(toString(0xdeadbeefull, "#020x") == "0x0000000000deadbeef");
+			CHECK(toString(0x5ull, "^#9b") == "  0b101  ");
+		}
+		
+		SECTION("Magnitude prefixes") {
+			CHECK(toString(0, "si") == "0");
+			CHECK(toString(999, "si") == "999");
+			CHECK(toString(1000, "si") == "1k");
+			CHECK(toString(1024, "si") == "1.024k");
+			CHECK(toString(1234567, "si") == "1.234567M");
+			CHECK(toString(-4500, "si") == "-4.5k");
+			CHECK(toString(18446744073709551615ull, "si") == "18.446744073709551615E");
+			
+			CHECK(toString(12345678, ".3si") == "12.3M");
+			CHECK(toString(999499, ".3si") == "999k");
+			CHECK(toString(999500, ".3si") == "1.00M");
+			CHECK(toString(1000, ".3si") == "1.00k");
+			CHECK(toString(12, ".3si") == "12.0");
+			CHECK(toString(1234567, ".2-4si") == "1.235M");
+			CHECK(toString(1200000, ".2-4si") == "1.2M");
+			CHECK(toString(1000000, ".2-4si") == "1.0M");
+			
+			// Ties round to even
+			CHECK(toString(1250, ".2si") == "1.2k");
+			CHECK(toString(1350, ".2si") == "1.4k");
+			CHECK(toString(1251, ".2si") == "1.3k");
+			
+			CHECK(toString(1023, "bi") == "1023");
+			CHECK(toString(1024, "bi") == "1Ki");
+			CHECK(toString(1536, "bi") == "1.5Ki");
+			CHECK(toString(1000000, "bi") == "976.6Ki");
+			CHECK(toString(1048575, "bi") == "1Mi");
+			CHECK(toString(12897485, "bi") == "12.3Mi");
+			CHECK(toString(1ull << 60, "bi") == "1Ei");
+			CHECK(toString(18446744073709551615ull, "bi") == "16Ei");
+			CHECK(toString(1125498264136853ull, "bi") == "1Pi");
+			CHECK(toString(1073383081, ".4bi") == "1.000Gi");
+			CHECK(toString(1048063, "bi") == "1023Ki");
+			CHECK(toString(1048064, "bi") == "1Mi");
+			CHECK(toString(1048552, ".3-5bi") == "1.00Mi");
+			CHECK(toString(1048524, ".3-5bi") == "1023.9Ki");
+			CHECK(toString(999950, ".4si") == "1.000M");
+			CHECK(toString(1000000, ".6bi") == "976.562Ki");
+			CHECK(toString(1000000, ".7bi") == "976.5625Ki");
+			CHECK(toString(1536, ".3bi") == "1.50Ki");
+			
+			CHECK(toString(1500, ">8si") == "    1.5k");
+			CHECK(toString(1500, "+si") == "+1.5k");
+			CHECK(toString(-1500, "08si") == "-0001.5k");
+			CHECK(toString(2048, "#bi") == "2.Ki");
+		}
+
+#ifdef __SIZEOF_INT128__
+		SECTION("128-bit values") {
+			using U = unsigned __int128;
+			U max = ~U(0);
+			__int128 min = static_cast<__int128>(U(1) << 127);
+			U e19 = 10000000000000000000ull;
+			
+			CHECK(toString(max) == "340282366920938463463374607431768211455");
+			CHECK(toString(min) == "-170141183460469231731687303715884105728");
+			CHECK(toString(e19 * e19) == "100000000000000000000000000000000000000");
+			CHECK(toString(e19 * 10 + 7) == "100000000000000000007");
+			CHECK(toString(e19 - 1) == "9999999999999999999");
+			CHECK(toString((__int128) -42) == "-42");
+			CHECK(toString(U(0)) == "0");
+			
+			CHECK(toString(max, "x") == std::string(32, 'f'));
+			CHECK(toString(max, "o") == "3" + std::string(42, '7'));
+			CHECK(toString(max, "b") == std::string(128, '1'));
+			CHECK(toString(U(1) << 64, "#X") == "0x10000000000000000");
+			CHECK(toString(U(1) << 63, "o") == "1" + std::string(21, '0'));
+			CHECK(toString(U(5) << 64 | 3, "b") == "101" + std::string(62, '0') + "11");
+			
+			CHECK(toString((__int128) -255, "+#08x") == "-0x000ff");
+			CHECK(toString(e19 * 10, ">+24") == "  +100000000000000000000");
+			CHECK(toString(max, ",") == "340,282,366,920,938,463,463,374,607,431,768,211,455");
+			CHECK(toString(U(1) << 64, "_x") == "1_0000_0000_0000_0000");
+			
+			CHECK(toString(e19 * e19, "si") == "100000000000000Y");
+			CHECK(toString(e19 * 100000, "si") == "1Y");
+			CHECK(toString(U(1) << 100, ",.7bi") == "1,048,576Yi");
+			CHECK(toString(min, ".3bi") == "-141000000000000Yi");
+		}
+#endif
+		
 		SECTION("Exceptions") {
 			CHECK_THROWS_WITH(toString(0, "+0#"), Catch::Contains("Unknown type parameter \"#\""));
 			CHECK_THROWS_WITH(toString(0, "e"), Catch::Contains("Unknown type parameter \"e\""));
 			CHECK_THROWS_WITH(toString(0, "--<6"), Catch::Contains("Unknown type parameter \"-<6\""));
+			CHECK_THROWS_WITH(toString(0, ",0"), Catch::Contains("Group size must be positive"));
+			CHECK_THROWS_WITH(toString(0, ",100"), Catch::Contains("Group size must be at most 99"));
+			CHECK_THROWS_WITH(toString(0, ",99999999999"), Catch::Contains("Group size must be at most 99"));
 		}
 	}
 }
@@ -5,6 +5,10 @@
 #include "catch2/catch.hpp"
 #include "formatstring/ToString.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 
 using namespace fs;
 
@@ -33,6 +37,24 @@ TEST_CASE("StringToString", "[toString][StringToString]")
 		CHECK(toString("abcdef", "#3") == "abc");
 	}
 	
+	SECTION("UTF-8 width") {
+		CHECK(toString("äöü", "5") == "äöü  ");
+		CHECK(toString("aé", "^4") == " aé ");
+		CHECK(toString("日本", "6") == "日本  ");
+		CHECK(toString("😀", ">3") == " 😀");
+		CHECK(toString("e\u0301", "3") == "e\u0301  ");
+		CHECK(toString("\xff\xfe", "3") == "\xff\xfe ");
+		CHECK(toString("äöü", "#2") == "äö");
+		CHECK(toString("日本語", ">5") == " 日本");
+		CHECK(toString("e\u0301x", "#1") == "e\u0301");
+		CHECK(toString("ab\xc3", "#3") == "ab\xc3");
+		CHECK(toString(std::string(100, 'x') + "ä", "#99") == std::string(99, 'x'));
+		CHECK(toString("Grüße", "s2-4") == "üß");
+		CHECK(toString("日本語", "s1-") == "本語");
+		CHECK(toString("日本語", "s-2") == "日本");
+		CHECK(toString("Grüße", "s5-") == "");
+	}
+	
 	SECTION("Substringing") {
 		CHECK(toString("Hello World", "s3-8") == "lo Wo");
 		CHECK(toString("Hello World", "s-5") == "Hello");
@@ -50,9 +72,245 @@ TEST_CASE("StringToString", "[toString][StringToString]")
 		CHECK(toString("multi replace", "r'multi'-'really' r'replace'-'cool'") == "really cool");
 		CHECK(toString("abc", "ra-b r'bb'-'cc'") == "ccc");
 		CHECK(toString("foo bar baz", "r' '-''") == "foobarbaz");
+		CHECK(toString("a b", "r' '-'' r'ab'-x") == "x");
+		CHECK(toString("ab", "ra-b rb-a") == "aa");
+		CHECK(toString("a", "r'abc'-x") == "a");
+		CHECK(toString("abc", "r''-x") == "abc");
+		CHECK(toString("Hello World", "s6- ro-0 rW-w") == "w0rld");
+	}
+	
+	SECTION("Replacements at once") {
+		CHECK(toString("ab", "m ra-b rb-a") == "ba");
+		CHECK(toString("abc", "mra-b r'bb'-'cc'") == "bbc");
+		CHECK(toString("abcd abd", "m rb-x r'abc'-y r'bcd'-z") == "yd axd");
+		CHECK(toString("aaaa", "m r'aa'-b ra-c") == "bb");
+		CHECK(toString("aab", "m r'ab'-x ra-y") == "yx");
+		CHECK(toString("a\xff\xfe" "b", "m r'\xff\xfe'-x") == "axb");
+	}
+	
+	SECTION("Replacements match sequential rules") {
+		// Random rules over a small alphabet, compared with applying them one
+		// after another
+		std::mt19937 random(3);
+		auto randomText = [&](size_t max_length) {
+			std::string text(random() % (max_length + 1), ' ');
+			for (char& c: text)
+				c = "abc"[random() % 3];
+			return text;
+		};
+		for (int i = 0; i < 2000; ++i) {
+			std::string format;
+			std::string value = randomText(20);
+			std::string expected = value;
+			int rules = 1 + static_cast<int>(random() % 3);
+			for (int r = 0; r < rules; ++r) {
+				std::string find = randomText(3);
+				if (find.empty())
+					find = "c";
+				std::string replace = randomText(2);
+				format += "r'" + find + "'-'" + replace + "' ";
+				std::string next;
+				size_t pos = 0;
+				for (size_t match; (match = expected.find(find, pos)) != std::string::npos; pos = match + find.length())
+					next += expected.substr(pos, match - pos) + replace;
+				expected = next + expected.substr(pos);
+			}
+			INFO(value << " " << format);
+			CHECK(toString(value, format) == expected);
+		}
+	}
+	
+	SECTION("Single byte replacements") {
+		// Long enough for the SIMD kernels, with tails that don't fill a block
+		std::string text = "Line one\tand\ttabs\nline two <b>&amp;</b> \"quoted\"\n";
+		REQUIRE(text.length() == 49);
+		CHECK(toString(text, "r'\n'-' ' r'\t'-' '")
+				== "Line one and tabs line two <b>&amp;</b> \"quoted\" ");
+		CHECK(toString(text, "r&-'&amp;' r<-'&lt;' r>-'&gt;' r'\"'-'&quot;'")
+				== "Line one\tand\ttabs\nline two &lt;b&gt;&amp;amp;&lt;/b&gt; &quot;quoted&quot;\n");
+		CHECK(toString(text, "r' '-'' r'\n'-'' r'\t'-''")
+				== "Lineoneandtabslinetwo<b>&amp;</b>\"quoted\"");
+		CHECK(toString(text + text, "r'\n'-'\r\n' rL-l") == "line one\tand\ttabs\r\nline two"
+				" <b>&amp;</b> \"quoted\"\r\nline one\tand\ttabs\r\nline two <b>&amp;</b> \"quoted\"\r\n");
+		
+		// More than 8 changed bytes fall back to a table lookup
+		std::string digits = "0123456789 9876543210 0123456789 9876543210 0123456789";
+		CHECK(toString(digits, "r0-a r1-b r2-c r3-d r4-e r5-f r6-g r7-h r8-i r9-j")
+				== "abcdefghij jihgfedcba abcdefghij jihgfedcba abcdefghij");
+		CHECK(toString(digits, "r0-'' r1-'' r2-'' r3-'' r4-'' r5-'' r6-'' r7-'' r8-'' r9-'xy'")
+				== "xy xy xy xy xy");
+		
+		// Sequential rules apply to the result of the previous ones
+		std::string ab(99, 'a');
+		ab[40] = 'b';
+		CHECK(toString(ab, "ra-b rb-c") == std::string(99, 'c'));
+		CHECK(toString(ab, "m ra-b rb-c") == std::string(40, 'b') + "c" + std::string(58, 'b'));
+		CHECK(toString(ab, "ra-'' rb-'xyz'") == "xyz");
+		CHECK(toString(ab, "m ra-'' rb-'xyz'") == "xyz");
+		
+		// Random rules over all text lengths from 32 to 131 bytes
+		std::mt19937 random(5);
+		const char alphabet[] = "abcdefghijkl\n";
+		auto randomText = [&](size_t length) {
+			std::string result(length, ' ');
+			for (char& c: result)
+				c = alphabet[random() % 13];
+			return result;
+		};
+		for (int i = 0; i < 1000; ++i) {
+			std::string value = randomText(32 + static_cast<size_t>(i % 100));
+			bool translate = i % 3 == 0;
+			bool at_once = i % 2 == 0;
+			int rule_count = 1 + static_cast<int>(random() % 12);
+			
+			std::string format = at_once ? "m " : "";
+			std::vector<std::pair<char, std::string>> rules;
+			for (int r = 0; r < rule_count; ++r) {
+				char find = alphabet[random() % 13];
+				std::string replace = randomText(translate ? 1 : random() % 4);
+				rules.emplace_back(find, replace);
+				format += "r'" + std::string(1, find) + "'-'" + replace + "' ";
+			}
+			
+			std::string expected = value;
+			if (at_once) {
+				expected.clear();
+				for (char c: value) {
+					auto rule = std::find_if(rules.begin(), rules.end(),
+							[&](const std::pair<char, std::string>& r) { return r.first == c; });
+					expected += rule != rules.end() ? rule->second : std::string(1, c);
+				}
+			} else {
+				for (const auto& rule: rules) {
+					std::string next;
+					for (char c: expected)
+						next += c == rule.first ? rule.second : std::string(1, c);
+					expected.swap(next);
+				}
+			}
+			INFO(value << " " << format);
+			CHECK(toString(value, format) == expected);
+		}
+	}
+	
+	SECTION("Transforms") {
+		CHECK(toString("  Order Id \t\n", "tl r' '-_") == "order_id");
+		CHECK(toString(" abc ", "t") == "abc");
+		CHECK(toString(" \r\n\v\f ", "t") == "");
+		CHECK(toString(" a\xa0", "t") == "a\xa0");
+		CHECK(toString("Hello, World!", "u") == "HELLO, WORLD!");
+		CHECK(toString("Hello, World!", "l") == "hello, world!");
+		CHECK(toString("Hello", "u l") == "hello");
+		CHECK(toString("  abcdef  ", "s1-5 t u") == "ABC");
+		CHECK(toString(" ab ", ".>5tu") == "...AB");
+		CHECK(toString("abcdef", "#3u") == "ABC");
+		CHECK(toString("ra", "u ra-b") == "RB");
+		CHECK(toString("a\"b", "uej") == "A\\\"B");
+		
+		CHECK(toString("Grüße ÉTÉ ǅ Ωμέγα", "u") == "GRÜßE ÉTÉ Ǆ ΩΜΈΓΑ");
+		CHECK(toString("Grüße ÉTÉ ǅ Ωμέγα", "l") == "grüße été ǆ ωμέγα");
+		CHECK(toString("ıſ\xff\xc3", "u") == "IS\xff\xc3");
+		CHECK(toString("\xe2\x84\xaa", "l") == "k");
+		CHECK(toString("Ꙋ𐐀", "l") == "ꙋ𐐨");
+		
+		// Simple mappings of characters whose full mapping has several
+		CHECK(toString("ᾀᾗῳ", "u") == "ᾈᾟῼ");
+		CHECK(toString("İ", "l") == "i");
+		
+		// Long text with non-ASCII characters between the SIMD blocks
+		std::string text;
+		std::string upper;
+		for (int i = 0; i < 200; ++i) {
+			text += i % 7 == 0 ? "ä" : i % 3 == 0 ? " " : "xY";
+			upper += i % 7 == 0 ? "Ä" : i % 3 == 0 ? " " : "XY";
+		}
+		CHECK(toString(text, "u") == upper);
+		CHECK(toString("   " + text + std::string(40, ' '), "t") == text);
+	}
+	
+	SECTION("Escaping") {
+		CHECK(toString("say \"hi\"\\\n\t\x01", "ej") == "say \\\"hi\\\"\\\\\\n\\t\\u0001");
+		CHECK(toString("grüße\x7f", "ej") == "grüße\x7f");
+		CHECK(toString("ok\xff\xc3", "eJ") == "ok\\ufffd\\ufffd");
+		CHECK(toString("日本\xed\xa0\x80", "eJ") == "日本\\ufffd\\ufffd\\ufffd");
+		CHECK(toString("plain", "ec") == "plain");
+		CHECK(toString("a,b", "ec") == "\"a,b\"");
+		CHECK(toString("say \"hi\"", "ec") == "\"say \"\"hi\"\"\"");
+		CHECK(toString("line\nbreak", "ec") == "\"line\nbreak\"");
+		CHECK(toString("a\"b\\\n\x1b" "1\x7f", "eC") == "a\\\"b\\\\\\n\\0331\\177");
+		CHECK(toString("<a href='x'>&</a>", "eh") == "&lt;a href=&#39;x&#39;&gt;&amp;&lt;/a&gt;");
+		CHECK(toString("a\"b", "10ej") == "a\\\"b      ");
+		CHECK(toString("a\"b", "#2ej") == "a\\\"");
+		CHECK(toString("x<y", "r'<'-'<=' eh") == "x&lt;=y");
+		
+		std::string clean(1000, 'x');
+		CHECK(toString(clean, "ej") == clean);
+		std::string text = clean + "\"" + clean;
+		CHECK(toString(text, "ej") == clean + "\\\"" + clean);
+	}
+	
+	SECTION("Appending") {
+		std::string out = "[";
+		appendToString(out, std::string("abc"), {});
+		appendToString(out, "def", "^5");
+		char buffer[8] = "ghi";
+		appendToString(out, buffer, "s1");
+		appendToString(out, 'j', {});
+		appendToString(out, 12, "3");
+		CHECK(out == "[abc def gj 12");
+		
+		std::string large(100000, 'x');
+		out.clear();
+		appendToString(out, large, {});
+		CHECK(out == large);
+		appendString(out, "a\"b", 3, "3 r\"-''");
+		CHECK(out == large + "ab ");
+	}
+
+#if __cplusplus >= 201703l
+	SECTION("std::string_view") {
+		std::string_view view("abcdef", 4);
+		CHECK(toString(view) == "abcd");
+		CHECK(toString(view, ">6") == "  abcd");
+		CHECK(toString(view.substr(1), "ra-x rb-y") == "ycd");
+		std::string out;
+		appendToString(out, view, "#2");
+		CHECK(out == "ab");
+	}
+#endif
+	
+	SECTION("Long strings") {
+		// Formatted in pieces of 64 KiB, matches and characters on the
+		// boundaries must come out as in one piece
+		std::string text;
+		std::string expected;
+		for (int i = 0; i < 30000; ++i) {
+			text += "ab, äx\"";
+			expected += "XY, ÄX\"\"";
+		}
+		CHECK(toString(text, "u r'ab'-'xy' ec") == "\"" + expected + "\"");
+		CHECK(toString(text, "ra-'aa' r'aa'-b") == toString(toString(text, "ra-'aa'"), "r'aa'-b"));
+		CHECK(toString(text, "m r'bx'-- r', '-''") == toString(text, "r', '-''"));
+		
+		// Whether a CSV value needs quotes is known before the first piece
+		std::string late(100000, 'x');
+		late += ',';
+		CHECK(toString(late, "ec") == "\"" + late + "\"");
+		CHECK(toString(late, ">100004ec") == " \"" + late + "\"");
+		CHECK(toString(late, "#100000ec") == std::string(100000, 'x'));
+		CHECK(toString(late, "r,-'\"' ec") == "\"" + std::string(100000, 'x') + "\"\"\"");
+		std::string wide;
+		std::string truncated;
+		for (int i = 0; i < 50000; ++i) {
+			wide += "日本";
+			truncated += i == 0 ? "本" : "本本";
+		}
+		CHECK(toString(wide, "#199999 r'日'-'本'") == truncated + " ");
+		CHECK(toString(wide, "s2- r'本'-x").length() == 49999 * 4);
 	}
 	
 	SECTION("Exceptions") {
+		CHECK_THROWS_WITH(toString("", "ex"), Catch::Contains("Unknown escape mode"));
 		CHECK_THROWS_WITH(toString("", "ra"), Catch::Contains("'-' expected in replace expression"));
 		CHECK_THROWS_WITH(toString("", "s4-2"), Catch::Contains("substring end less than begin"));
 	}
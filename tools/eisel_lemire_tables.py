@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Generates src/formatstring/scan/EiselLemireTables.h.
+
+The table holds 5^q for -342 <= q <= 308 as 128-bit values with the most
+significant bit set, as used by the Eisel-Lemire algorithm for parsing
+decimal numbers. Positive powers are truncated, negative ones are 2^b / 5^-q
+rounded up, with extra bits for the smallest powers before truncation.
+"""
+
+import os
+
+SMALLEST_POWER = -342
+LARGEST_POWER = 308
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src",
+                      "formatstring", "scan", "EiselLemireTables.h")
+
+
+def power_of_five(q):
+    if q >= 0:
+        power = 5**q
+        while power < 1 << 127:
+            power *= 2
+        while power >= 1 << 128:
+            power //= 2
+        return power
+    
+    power = 5**-q
+    z = power.bit_length()
+    if q >= -27:
+        return 2**(z + 127) // power + 1
+    value = 2**(2 * z + 2 * 64) // power + 1
+    while value >= 1 << 128:
+        value //= 2
+    return value
+
+
+def main():
+    lines = []
+    for q in range(SMALLEST_POWER, LARGEST_POWER + 1):
+        value = power_of_five(q)
+        lines.append("\t0x%016xull, 0x%016xull, // 5^%d" % (value >> 64, value & (2**64 - 1), q))
+    
+    with open(OUTPUT, "w") as out:
+        out.write("""/** @file formatstring/scan/EiselLemireTables.h
+ *
+ * Lookup table of the Eisel-Lemire algorithm, generated by
+ * tools/eisel_lemire_tables.py. This header is private to the library and must
+ * only be included by FloatParser.cpp.
+ */
+
+#ifndef FORMATSTRING_EISELLEMIRETABLES_H
+#define FORMATSTRING_EISELLEMIRETABLES_H
+
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+namespace {
+
+const int SMALLEST_POWER_OF_FIVE = %d;
+const int LARGEST_POWER_OF_FIVE = %d;
+
+/** 5^q with 128 significant bits, high half first. */
+const uint64_t POWERS_OF_FIVE[%d] = {
+%s
+};
+
+} // anonymous namespace
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_EISELLEMIRETABLES_H
+""" % (SMALLEST_POWER, LARGEST_POWER, 2 * (LARGEST_POWER - SMALLEST_POWER + 1), "\n".join(lines)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Generates src/formatstring/stringify/RyuTables.h.
+
+The tables hold 5^i and 2^j / 5^i with 125 significant bits, split into two
+64-bit halves, as used by the Ryu algorithm for doubles, and smaller tables
+with 61 and 59 bits in a single 64-bit word for floats.
+"""
+
+import os
+
+POW5_BITCOUNT = 125
+POW5_INV_BITCOUNT = 125
+POW5_TABLE_SIZE = 326
+POW5_INV_TABLE_SIZE = 342
+FLOAT_POW5_BITCOUNT = 61
+FLOAT_POW5_INV_BITCOUNT = 59
+FLOAT_POW5_TABLE_SIZE = 48
+FLOAT_POW5_INV_TABLE_SIZE = 31
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src",
+                      "formatstring", "stringify", "RyuTables.h")
+
+
+def split(value):
+    return value & (2**64 - 1), value >> 64
+
+
+def pow5_split(i, bitcount=POW5_BITCOUNT):
+    power = 5**i
+    shift = power.bit_length() - bitcount
+    return power >> shift if shift >= 0 else power << -shift
+
+
+def pow5_inv_split(i, bitcount=POW5_INV_BITCOUNT):
+    power = 5**i
+    shift = power.bit_length() - 1 + bitcount
+    return (1 << shift) // power + 1
+
+
+def table(name, size, entry):
+    lines = ["const uint64_t %s[%d][2] = {" % (name, size)]
+    for i in range(size):
+        lines.append("\t{0x%016xull, 0x%016xull}," % split(entry(i)))
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def float_table(name, size, entry):
+    lines = ["const uint64_t %s[%d] = {" % (name, size)]
+    for i in range(size):
+        lines.append("\t0x%016xull," % entry(i))
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    with open(OUTPUT, "w") as out:
+        out.write("""/** @file formatstring/stringify/RyuTables.h
+ *
+ * Lookup tables of the Ryu algorithm, generated by tools/ryu_tables.py. This
+ * header is private to the library and must only be included by Ryu.cpp.
+ */
+
+#ifndef FORMATSTRING_RYUTABLES_H
+#define FORMATSTRING_RYUTABLES_H
+
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+namespace {
+
+const int POW5_BITCOUNT = %d;
+const int POW5_INV_BITCOUNT = %d;
+
+/** 5^i with the %d most significant bits, low half first. */
+%s
+
+/** 2^(bitlength(5^i) - 1 + %d) / 5^i, rounded up, low half first. */
+%s
+
+const int FLOAT_POW5_BITCOUNT = %d;
+const int FLOAT_POW5_INV_BITCOUNT = %d;
+
+/** 5^i with the %d most significant bits. */
+%s
+
+/** 2^(bitlength(5^i) - 1 + %d) / 5^i, rounded up. */
+%s
+
+} // anonymous namespace
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_RYUTABLES_H
+""" % (POW5_BITCOUNT, POW5_INV_BITCOUNT,
+       POW5_BITCOUNT, table("POW5_SPLIT", POW5_TABLE_SIZE, pow5_split),
+       POW5_INV_BITCOUNT, table("POW5_INV_SPLIT", POW5_INV_TABLE_SIZE, pow5_inv_split),
+       FLOAT_POW5_BITCOUNT, FLOAT_POW5_INV_BITCOUNT,
+       FLOAT_POW5_BITCOUNT, float_table("FLOAT_POW5_SPLIT", FLOAT_POW5_TABLE_SIZE,
+                                        lambda i: pow5_split(i, FLOAT_POW5_BITCOUNT)),
+       FLOAT_POW5_INV_BITCOUNT, float_table("FLOAT_POW5_INV_SPLIT", FLOAT_POW5_INV_TABLE_SIZE,
+                                            lambda i: pow5_inv_split(i, FLOAT_POW5_INV_BITCOUNT))))
+
+
+if __name__ == "__main__":
+    main()
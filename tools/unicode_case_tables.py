@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Generates src/formatstring/util/CaseTables.h.
+
+The tables hold the simple case mappings of all non-ASCII code points, i.e.
+the ones that map a single code point to a single other one. Full mappings like
+the German sharp s to "SS" are left out. They are read from fields 12 and 13 of
+UnicodeData.txt, since str.upper() and str.lower() apply the full mappings and
+miss the simple ones of e.g. U+1F80 and U+0130:
+
+    tools/unicode_case_tables.py path/to/UnicodeData.txt [version]
+
+The version defaults to the one of the Python running this script.
+"""
+
+import os
+import sys
+import unicodedata
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src",
+                      "formatstring", "util", "CaseTables.h")
+
+
+def mappings(path, field):
+    """Returns the pairs of code points and the ones they are mapped to by the
+    given field of UnicodeData.txt."""
+    out = []
+    with open(path) as data:
+        for line in data:
+            fields = line.split(";")
+            c = int(fields[0], 16)
+            if c >= 0x80 and fields[field]:
+                out.append((c, int(fields[field], 16)))
+    return out
+
+
+def ranges(pairs):
+    """Combines runs of code points with the same distance to their mapping,
+    which are either consecutive or every second one, into ranges."""
+    out = []
+    for c, mapped in pairs:
+        delta = mapped - c
+        if out:
+            last = out[-1]
+            if last[2] == delta:
+                if last[0] == last[1] and c - last[1] in (1, 2):
+                    last[3] = c - last[1]
+                if c - last[1] == last[3]:
+                    last[1] = c
+                    continue
+        out.append([c, c, delta, 1])
+    return out
+
+
+def format_ranges(table):
+    return "\n".join("\t{0x%05x, 0x%05x, %d, %d}," % tuple(r) for r in table)
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit("usage: unicode_case_tables.py UnicodeData.txt [version]")
+    version = sys.argv[2] if len(sys.argv) == 3 else unicodedata.unidata_version
+    upper = ranges(mappings(sys.argv[1], 12))
+    lower = ranges(mappings(sys.argv[1], 13))
+    
+    with open(OUTPUT, "w") as out:
+        out.write("""/** @file formatstring/util/CaseTables.h
+ *
+ * Simple case mapping tables for Unicode %s, generated by
+ * tools/unicode_case_tables.py. This header is private to the library and
+ * must only be included by TextTransform.cpp.
+ */
+
+#ifndef FORMATSTRING_CASETABLES_H
+#define FORMATSTRING_CASETABLES_H
+
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+namespace {
+
+/**
+ * Code points from first to last, every stride one, which are mapped to the
+ * code point delta away.
+ */
+struct CaseRange {
+	uint32_t first;
+	uint32_t last;
+	int32_t delta;
+	uint32_t stride;
+};
+
+/** Non-ASCII code points that have an upper case mapping. */
+const CaseRange TO_UPPER[%d] = {
+%s
+};
+
+/** Non-ASCII code points that have a lower case mapping. */
+const CaseRange TO_LOWER[%d] = {
+%s
+};
+
+} // anonymous namespace
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_CASETABLES_H
+""" % (version, len(upper), format_ranges(upper), len(lower), format_ranges(lower)))
+
+
+if __name__ == "__main__":
+    main()
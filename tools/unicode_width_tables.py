@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Generates src/formatstring/util/Utf8Tables.h.
+
+The tables hold the ranges of code points that take two columns on a terminal,
+i.e. the East Asian Wide and Fullwidth characters, and of the ones that take
+none, i.e. combining marks, format characters except the soft hyphen and the
+medial Hangul Jamo. They are taken from the Unicode database of the Python
+version running this script.
+"""
+
+import os
+import sys
+import unicodedata
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src",
+                      "formatstring", "util", "Utf8Tables.h")
+
+
+def is_zero_width(c):
+    category = unicodedata.category(chr(c))
+    if category in ("Mn", "Me"):
+        return True
+    if category == "Cf" and c != 0xad:
+        return True
+    return 0x1160 <= c <= 0x11ff or c == 0x200b
+
+
+def is_wide(c):
+    return unicodedata.east_asian_width(chr(c)) in ("W", "F")
+
+
+def is_unassigned(c):
+    return unicodedata.category(chr(c)) == "Cn"
+
+
+def ranges(predicate):
+    """Returns the ranges of the matching code points. Gaps of unassigned code
+    points between two ranges are closed to keep the table short."""
+    out = []
+    for c in range(0x300, sys.maxunicode + 1):
+        if not predicate(c):
+            continue
+        if out and all(is_unassigned(gap) for gap in range(out[-1][1] + 1, c)):
+            out[-1][1] = c
+        else:
+            out.append([c, c])
+    return out
+
+
+def format_ranges(table):
+    return "\n".join("\t{0x%05x, 0x%05x}," % (first, last) for first, last in table)
+
+
+def main():
+    zero = ranges(is_zero_width)
+    wide = ranges(lambda c: is_wide(c) and not is_zero_width(c))
+    
+    with open(OUTPUT, "w") as out:
+        out.write("""/** @file formatstring/util/Utf8Tables.h
+ *
+ * Display width tables for Unicode %s, generated by
+ * tools/unicode_width_tables.py. This header is private to the library and
+ * must only be included by Utf8.cpp.
+ */
+
+#ifndef FORMATSTRING_UTF8TABLES_H
+#define FORMATSTRING_UTF8TABLES_H
+
+#include <cstdint>
+
+
+namespace fs {
+namespace detail {
+namespace {
+
+/** First and last code point of a range. */
+struct CodePointRange {
+	uint32_t first;
+	uint32_t last;
+};
+
+/** Code points that take no column, e.g. combining marks. */
+const CodePointRange ZERO_WIDTH[%d] = {
+%s
+};
+
+/** Code points that take two columns, e.g. CJK ideographs. */
+const CodePointRange WIDE[%d] = {
+%s
+};
+
+} // anonymous namespace
+} // namespace detail
+} // namespace fs
+
+#endif //FORMATSTRING_UTF8TABLES_H
+""" % (unicodedata.unidata_version, len(zero), format_ranges(zero), len(wide), format_ranges(wide)))
+
+
+if __name__ == "__main__":
+    main()